@@ -0,0 +1,223 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#pragma once
+
+#include "Element.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <stdint.h>
+
+
+// Consumes decoded PCM as fast as it arrives.  Counts samples and,
+// when given a path, writes them as a 16-bit WAV file.
+class AudioBenchSinkElement : public Element
+{
+	InPinSPTR pin;
+	std::string wavPath;
+	FILE* wavFile = nullptr;
+	int sampleRate = 0;
+	int channels = 0;
+	uint32_t wavDataBytes = 0;
+	std::vector<int16_t> wavSamples;
+	std::atomic<uint64_t> samples;
+
+
+	static int16_t ToInt16(PcmFormat format, void* plane, int index)
+	{
+		switch (format)
+		{
+			case PcmFormat::Int16:
+			case PcmFormat::Int16Planes:
+				return ((int16_t*)plane)[index];
+
+			case PcmFormat::Int32:
+			case PcmFormat::Int32Planes:
+				return (int16_t)(((int32_t*)plane)[index] >> 16);
+
+			case PcmFormat::Float32:
+			case PcmFormat::Float32Planes:
+			{
+				float value = ((float*)plane)[index];
+				if (value > 1.0f) value = 1.0f;
+				if (value < -1.0f) value = -1.0f;
+
+				return (int16_t)(value * 32767.0f);
+			}
+
+			default:
+				throw NotSupportedException();
+		}
+	}
+
+	static void WriteUInt32(FILE* file, uint32_t value)
+	{
+		uint8_t bytes[4] = { (uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24) };
+		fwrite(bytes, 1, 4, file);
+	}
+
+	static void WriteUInt16(FILE* file, uint16_t value)
+	{
+		uint8_t bytes[2] = { (uint8_t)value, (uint8_t)(value >> 8) };
+		fwrite(bytes, 1, 2, file);
+	}
+
+	void WriteWavHeader()
+	{
+		fseek(wavFile, 0, SEEK_SET);
+
+		fwrite("RIFF", 1, 4, wavFile);
+		WriteUInt32(wavFile, 36 + wavDataBytes);
+		fwrite("WAVEfmt ", 1, 8, wavFile);
+		WriteUInt32(wavFile, 16);
+		WriteUInt16(wavFile, 1);	// PCM
+		WriteUInt16(wavFile, (uint16_t)channels);
+		WriteUInt32(wavFile, (uint32_t)sampleRate);
+		WriteUInt32(wavFile, (uint32_t)(sampleRate * channels * 2));
+		WriteUInt16(wavFile, (uint16_t)(channels * 2));
+		WriteUInt16(wavFile, 16);
+		fwrite("data", 1, 4, wavFile);
+		WriteUInt32(wavFile, wavDataBytes);
+
+		fseek(wavFile, 0, SEEK_END);
+	}
+
+	void WritePcm(PcmData* pcmData)
+	{
+		bool isInterleaved = (pcmData->Format == PcmFormat::Int16 ||
+			pcmData->Format == PcmFormat::Int32 ||
+			pcmData->Format == PcmFormat::Float32);
+
+		wavSamples.resize(pcmData->Samples * pcmData->Channels);
+
+		for (int i = 0; i < pcmData->Samples; ++i)
+		{
+			for (int c = 0; c < pcmData->Channels; ++c)
+			{
+				int16_t value = isInterleaved ?
+					ToInt16(pcmData->Format, pcmData->Channel[0], i * pcmData->Channels + c) :
+					ToInt16(pcmData->Format, pcmData->Channel[c], i);
+
+				wavSamples[i * pcmData->Channels + c] = value;
+			}
+		}
+
+		size_t length = wavSamples.size() * sizeof(int16_t);
+		fwrite(wavSamples.data(), 1, length, wavFile);
+		wavDataBytes += (uint32_t)length;
+	}
+
+
+public:
+
+	// Decoded audio in seconds
+	double Seconds() const
+	{
+		return (sampleRate > 0) ? samples.load() / (double)sampleRate : 0;
+	}
+
+
+
+	AudioBenchSinkElement(std::string wavPath)
+		: wavPath(wavPath), samples(0)
+	{
+	}
+
+
+
+	virtual void Initialize() override
+	{
+		ClearOutputPins();
+		ClearInputPins();
+
+		PinInfoSPTR info = std::make_shared<AudioPinInfo>();
+
+		ElementWPTR weakPtr = shared_from_this();
+		pin = std::make_shared<InPin>(weakPtr, info);
+		AddInputPin(pin);
+	}
+
+	virtual void DoWork() override
+	{
+		BufferSPTR buffer;
+		while (pin->TryGetFilledBuffer(&buffer))
+		{
+			if (sampleRate == 0 && pin->Source())
+			{
+				AudioPinInfoSPTR info = std::static_pointer_cast<AudioPinInfo>(pin->Source()->Info());
+				sampleRate = info->SampleRate;
+				channels = info->Channels;
+			}
+
+			switch (buffer->Type())
+			{
+				case BufferTypeEnum::Marker:
+					if (std::static_pointer_cast<MarkerBuffer>(buffer)->Marker() == MarkerEnum::EndOfStream)
+					{
+						SetState(MediaState::Pause);
+					}
+					break;
+
+				case BufferTypeEnum::PcmData:
+				{
+					PcmData* pcmData = std::static_pointer_cast<PcmDataBuffer>(buffer)->GetPcmData();
+					samples.fetch_add(pcmData->Samples);
+
+					if (!wavPath.empty() && !wavFile && sampleRate > 0)
+					{
+						wavFile = fopen(wavPath.c_str(), "wb");
+						if (!wavFile)
+						{
+							throw Exception("AudioBenchSinkElement: could not open the WAV file.");
+						}
+
+						channels = pcmData->Channels;
+						WriteWavHeader();
+					}
+
+					if (wavFile)
+					{
+						WritePcm(pcmData);
+					}
+					break;
+				}
+
+				default:
+					break;
+			}
+
+			pin->PushProcessedBuffer(buffer);
+		}
+
+		pin->ReturnProcessedBuffers();
+	}
+
+	virtual void Terminating() override
+	{
+		if (wavFile)
+		{
+			WriteWavHeader();
+			fclose(wavFile);
+
+			wavFile = nullptr;
+		}
+	}
+};
+
+typedef std::shared_ptr<AudioBenchSinkElement> AudioBenchSinkElementSPTR;
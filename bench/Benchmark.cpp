@@ -0,0 +1,82 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#include "Benchmark.h"
+
+
+
+std::vector<BenchmarkResult> BenchmarkReport::results;
+
+
+
+void BenchmarkReport::Add(const char* name, uint64_t operations, uint64_t nanoseconds, uint64_t bytes)
+{
+	BenchmarkResult result;
+	result.Name = name;
+	result.Operations = operations;
+	result.Nanoseconds = nanoseconds;
+	result.Bytes = bytes;
+
+	results.push_back(result);
+}
+
+// Element and pin diagnostics go to stdout, so the document is
+// written to its own file
+bool BenchmarkReport::WriteJson(const char* path, int iterations)
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+	{
+		printf("BenchmarkReport: could not open %s.\n", path);
+		return false;
+	}
+
+	fprintf(file, "{\n");
+	fprintf(file, "  \"version\": 1,\n");
+	fprintf(file, "  \"iterations\": %d,\n", iterations);
+	fprintf(file, "  \"results\": [");
+
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const BenchmarkResult& result = results[i];
+
+		double nsPerOp = result.Nanoseconds / (double)result.Operations;
+		double opsPerSec = result.Operations / (result.Nanoseconds / 1e9);
+
+		// Names are fixed ASCII identifiers and need no escaping
+		fprintf(file, "%s\n    { \"name\": \"%s\", \"ops\": %llu, \"ns_per_op\": %.1f, \"ops_per_sec\": %.0f",
+			(i == 0) ? "" : ",",
+			result.Name.c_str(),
+			(unsigned long long)result.Operations,
+			nsPerOp,
+			opsPerSec);
+
+		if (result.Bytes > 0)
+		{
+			fprintf(file, ", \"mb_per_sec\": %.1f",
+				result.Bytes / (result.Nanoseconds / 1e9) / (1024.0 * 1024.0));
+		}
+
+		fprintf(file, " }");
+	}
+
+	fprintf(file, "\n  ]\n");
+	fprintf(file, "}\n");
+
+	fclose(file);
+
+	return true;
+}
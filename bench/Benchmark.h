@@ -0,0 +1,128 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#pragma once
+
+#include <time.h>
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+
+class Stopwatch
+{
+	timespec start;
+
+
+public:
+
+	static uint64_t Now()
+	{
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+
+		return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	}
+
+
+	Stopwatch()
+	{
+		Restart();
+	}
+
+
+	void Restart()
+	{
+		clock_gettime(CLOCK_MONOTONIC, &start);
+	}
+
+	uint64_t ElapsedNanoseconds() const
+	{
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+
+		return (uint64_t)(now.tv_sec - start.tv_sec) * 1000000000ULL +
+			(now.tv_nsec - start.tv_nsec);
+	}
+};
+
+
+// Every result is kept so the run can be written out as JSON at the
+// end.  The document only contains the benchmark names, the operation
+// count and the derived rates, always in the order the benchmarks ran,
+// so two runs can be compared with diff.
+struct BenchmarkResult
+{
+	std::string Name;
+	uint64_t Operations;
+	uint64_t Nanoseconds;
+	uint64_t Bytes;		// 0 unless the benchmark measures throughput
+};
+
+
+class BenchmarkReport
+{
+	static std::vector<BenchmarkResult> results;
+
+
+public:
+
+	static void Add(const char* name, uint64_t operations, uint64_t nanoseconds, uint64_t bytes = 0);
+	static bool WriteJson(const char* path, int iterations);
+};
+
+
+// Records one result and prints it as a table line
+inline void ReportResult(const char* name, uint64_t operations, uint64_t nanoseconds)
+{
+	BenchmarkReport::Add(name, operations, nanoseconds);
+
+	double nsPerOp = nanoseconds / (double)operations;
+	double opsPerSec = operations / (nanoseconds / 1e9);
+
+	printf("%-40s %12llu ops %10.1f ns/op %14.0f ops/s\n",
+		name,
+		(unsigned long long)operations,
+		nsPerOp,
+		opsPerSec);
+}
+
+
+// Records one result with the bytes processed and prints MB/s
+inline void ReportThroughput(const char* name, uint64_t operations, uint64_t bytes, uint64_t nanoseconds)
+{
+	BenchmarkReport::Add(name, operations, nanoseconds, bytes);
+
+	double nsPerOp = nanoseconds / (double)operations;
+	double mbPerSec = bytes / (nanoseconds / 1e9) / (1024.0 * 1024.0);
+
+	printf("%-40s %12llu ops %10.1f ns/op %12.1f MB/s\n",
+		name,
+		(unsigned long long)operations,
+		nsPerOp,
+		mbPerSec);
+}
+
+
+// Benchmarks
+void RunQueueBenchmarks(int iterations);
+void RunEventBenchmarks(int iterations);
+void RunElementBenchmarks(int iterations);
+void RunPacketBenchmarks(int iterations);
+void RunBitstreamBenchmarks(int iterations);
+void RunTeeBenchmarks(int iterations);
@@ -0,0 +1,207 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#include "Benchmark.h"
+
+#include "Bitstream.h"
+#include "Exception.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+
+// A synthetic elementary stream: slices of typical sizes with random
+// payloads, so zero bytes (and start code candidates) are as rare as
+// in compressed video.
+static const int STREAM_SIZE = 4 * 1024 * 1024;
+static const int MIN_UNIT = 512;
+static const int MAX_UNIT = 24 * 1024;
+
+
+static void BuildStreams(std::vector<unsigned char>* annexB, std::vector<unsigned char>* lengthPrefixed)
+{
+	srand(1);
+
+	while ((int)annexB->size() < STREAM_SIZE)
+	{
+		int length = MIN_UNIT + rand() % (MAX_UNIT - MIN_UNIT);
+
+		std::vector<unsigned char> unit(length);
+		unit[0] = 0x41;		// non-IDR slice
+		for (int i = 1; i < length; ++i)
+		{
+			unit[i] = rand() & 0xff;
+
+			// Emulation prevention keeps start codes out of the payload
+			if (i >= 2 && unit[i - 2] == 0 && unit[i - 1] == 0 && unit[i] <= 3)
+			{
+				unit[i] = 0x03;
+			}
+		}
+
+		unit[length - 1] |= 0x80;	// rbsp_stop_one_bit
+
+		static const unsigned char startCode[] = { 0, 0, 0, 1 };
+		annexB->insert(annexB->end(), startCode, startCode + 4);
+		annexB->insert(annexB->end(), unit.begin(), unit.end());
+
+		unsigned char prefix[] = {
+			(unsigned char)(length >> 24), (unsigned char)(length >> 16),
+			(unsigned char)(length >> 8), (unsigned char)length };
+		lengthPrefixed->insert(lengthPrefixed->end(), prefix, prefix + 4);
+		lengthPrefixed->insert(lengthPrefixed->end(), unit.begin(), unit.end());
+	}
+}
+
+template <typename TFind>
+static void Scan(const char* name, const std::vector<unsigned char>& stream, int passes, TFind find)
+{
+	int count = 0;
+
+	Stopwatch stopwatch;
+
+	for (int pass = 0; pass < passes; ++pass)
+	{
+		int offset = find(stream.data(), stream.size(), 0);
+		while (offset < (int)stream.size())
+		{
+			++count;
+			offset = find(stream.data(), stream.size(), offset + 3);
+		}
+	}
+
+	uint64_t elapsed = stopwatch.ElapsedNanoseconds();
+
+	if (count == 0)
+		throw Exception("No start codes found.");
+
+	ReportThroughput(name, passes, (uint64_t)stream.size() * passes, elapsed);
+}
+
+
+void RunBitstreamBenchmarks(int iterations)
+{
+	std::vector<unsigned char> annexB;
+	std::vector<unsigned char> lengthPrefixed;
+	BuildStreams(&annexB, &lengthPrefixed);
+
+	// 10 passes over the stream at the default iteration count
+	int passes = iterations / 100000;
+	if (passes < 1)
+	{
+		passes = 1;
+	}
+
+
+	Scan("Bitstream/FindStartCode", annexB, passes,
+		[](const unsigned char* data, int length, int offset) { return Bitstream::FindStartCode(data, length, offset); });
+
+	Scan("Bitstream/FindStartCodeScalar", annexB, passes,
+		[](const unsigned char* data, int length, int offset) { return Bitstream::FindStartCodeScalar(data, length, offset); });
+
+
+	std::vector<NalUnit> units;
+	{
+		Stopwatch stopwatch;
+
+		for (int pass = 0; pass < passes; ++pass)
+		{
+			units.clear();
+			Bitstream::SplitAnnexB(annexB.data(), annexB.size(), &units);
+		}
+
+		ReportThroughput("Bitstream/SplitAnnexB", passes, (uint64_t)annexB.size() * passes, stopwatch.ElapsedNanoseconds());
+	}
+
+	{
+		Stopwatch stopwatch;
+
+		for (int pass = 0; pass < passes; ++pass)
+		{
+			units.clear();
+			if (!Bitstream::SplitLengthPrefixed(lengthPrefixed.data(), lengthPrefixed.size(), 4, &units))
+				throw Exception("Invalid length prefixed stream.");
+		}
+
+		ReportThroughput("Bitstream/SplitLengthPrefixed", passes, (uint64_t)lengthPrefixed.size() * passes, stopwatch.ElapsedNanoseconds());
+	}
+
+	{
+		// Converting in place is destructive, so every pass gets a
+		// fresh copy outside the timed region
+		std::vector<unsigned char> copy;
+		uint64_t elapsed = 0;
+
+		for (int pass = 0; pass < passes; ++pass)
+		{
+			copy = lengthPrefixed;
+			units.clear();
+
+			Stopwatch stopwatch;
+			Bitstream::LengthPrefixedToAnnexB(copy.data(), copy.size(), 4, &units);
+			elapsed += stopwatch.ElapsedNanoseconds();
+		}
+
+		if (copy != annexB)
+			throw Exception("LengthPrefixedToAnnexB produced a different stream.");
+
+		ReportThroughput("Bitstream/LengthPrefixedToAnnexB", passes, (uint64_t)lengthPrefixed.size() * passes, elapsed);
+	}
+
+	{
+		std::vector<unsigned char> output;
+		output.reserve(lengthPrefixed.size());
+
+		Stopwatch stopwatch;
+
+		for (int pass = 0; pass < passes; ++pass)
+		{
+			output.clear();
+			Bitstream::AnnexBToLengthPrefixed(annexB.data(), annexB.size(), 4, &output);
+		}
+
+		uint64_t elapsed = stopwatch.ElapsedNanoseconds();
+
+		if (output != lengthPrefixed)
+			throw Exception("AnnexBToLengthPrefixed produced a different stream.");
+
+		ReportThroughput("Bitstream/AnnexBToLengthPrefixed", passes, (uint64_t)annexB.size() * passes, elapsed);
+	}
+
+
+	// 1080p High profile SPS with VUI timing
+	static const unsigned char sps[] =
+	{
+		0x67, 0x64, 0x00, 0x28, 0xac, 0xd9, 0x40, 0x78, 0x02, 0x27, 0xe5, 0xc0, 0x44, 0x00,
+		0x00, 0x03, 0x00, 0x04, 0x00, 0x00, 0x03, 0x00, 0xf0, 0x3c, 0x60, 0xc6, 0x58
+	};
+
+	{
+		int count = iterations / 10;
+		SequenceInfo info;
+
+		Stopwatch stopwatch;
+
+		for (int i = 0; i < count; ++i)
+		{
+			if (!Bitstream::ParseSequenceHeader(VideoFormatEnum::Avc, sps, sizeof(sps), &info))
+				throw Exception("ParseSequenceHeader failed.");
+		}
+
+		ReportResult("Bitstream/ParseSequenceHeader", count, stopwatch.ElapsedNanoseconds());
+	}
+}
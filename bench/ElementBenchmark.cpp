@@ -0,0 +1,210 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#include "Benchmark.h"
+
+#include "Element.h"
+#include "NullSinkElement.h"
+#include "WaitCondition.h"
+
+#include <atomic>
+#include <memory>
+
+
+// Counts DoWork passes and signals the benchmark thread after each
+class WakeBenchElement : public Element
+{
+	std::atomic<int> workCount;
+	WaitCondition workDone;
+
+
+protected:
+
+	virtual void DoWork() override
+	{
+		workCount.fetch_add(1, std::memory_order_release);
+		workDone.Signal();
+	}
+
+
+public:
+
+	WakeBenchElement(ExecutionModeEnum mode)
+		: workCount(0)
+	{
+		SetName("WakeBench");
+		SetExecutionMode(mode);
+	}
+
+
+	// Wakes the element and waits until it has run DoWork
+	void RoundTrip()
+	{
+		int target = workCount.load(std::memory_order_acquire) + 1;
+
+		Wake();
+
+		while (workCount.load(std::memory_order_acquire) < target)
+		{
+			workDone.WaitForSignal();
+		}
+	}
+};
+
+typedef std::shared_ptr<WakeBenchElement> WakeBenchElementSPTR;
+
+
+// Bounces a single buffer off a NullSinkElement.  Each pass is two
+// pin hand-offs: SendBuffer to the sink and the sink returning the
+// buffer, which wakes this element to send it again.
+class HandoffSourceElement : public Element
+{
+	OutPinSPTR pin;
+	std::atomic<int> sent;
+	int total = 0;
+	WaitCondition finished;
+
+
+protected:
+
+	virtual void Initialize() override
+	{
+		ClearOutputPins();
+
+		PinInfoSPTR info = std::make_shared<PinInfo>(MediaCategoryEnum::Unknown);
+		pin = std::make_shared<OutPin>(shared_from_this(), info);
+		AddOutputPin(pin);
+
+		pin->AcceptProcessedBuffer(std::make_shared<ClockDataBuffer>(shared_from_this()));
+	}
+
+	virtual void DoWork() override
+	{
+		BufferSPTR buffer;
+		if (!pin->TryPeekAvailableBuffer(&buffer))
+			return;
+
+		if (sent.load(std::memory_order_relaxed) < total)
+		{
+			pin->TryGetAvailableBuffer(&buffer);
+			sent.fetch_add(1, std::memory_order_relaxed);
+
+			pin->SendBuffer(buffer);
+		}
+		else
+		{
+			finished.Signal();
+		}
+	}
+
+
+public:
+
+	HandoffSourceElement(ExecutionModeEnum mode, int total)
+		: sent(0), total(total)
+	{
+		SetName("HandoffSource");
+		SetExecutionMode(mode);
+	}
+
+
+	void WaitForFinished()
+	{
+		finished.WaitForSignal();
+	}
+};
+
+typedef std::shared_ptr<HandoffSourceElement> HandoffSourceElementSPTR;
+
+
+class HandoffSinkElement : public NullSinkElement
+{
+public:
+
+	HandoffSinkElement(ExecutionModeEnum mode)
+	{
+		SetName("HandoffSink");
+		SetExecutionMode(mode);
+	}
+};
+
+
+
+static void WakeRoundTrip(const char* name, ExecutionModeEnum mode, int iterations)
+{
+	WakeBenchElementSPTR element = std::make_shared<WakeBenchElement>(mode);
+
+	element->Execute();
+	element->WaitForExecutionState(ExecutionStateEnum::Idle);
+	element->SetState(MediaState::Play);
+
+	// Settle any work queued by the state change
+	element->RoundTrip();
+
+
+	Stopwatch stopwatch;
+
+	for (int i = 0; i < iterations; ++i)
+	{
+		element->RoundTrip();
+	}
+
+	uint64_t elapsed = stopwatch.ElapsedNanoseconds();
+
+
+	element->Terminate();
+
+	ReportResult(name, iterations, elapsed);
+}
+
+static void PinHandoff(const char* name, ExecutionModeEnum mode, int iterations)
+{
+	HandoffSourceElementSPTR source = std::make_shared<HandoffSourceElement>(mode, iterations);
+	ElementSPTR sink = std::make_shared<HandoffSinkElement>(mode);
+
+	source->Execute();
+	sink->Execute();
+
+	source->WaitForExecutionState(ExecutionStateEnum::Idle);
+	sink->WaitForExecutionState(ExecutionStateEnum::Idle);
+
+	source->Outputs()->Item(0)->Connect(sink->Inputs()->Item(0));
+	sink->SetState(MediaState::Play);
+
+
+	Stopwatch stopwatch;
+
+	source->SetState(MediaState::Play);
+	source->WaitForFinished();
+
+	uint64_t elapsed = stopwatch.ElapsedNanoseconds();
+
+
+	source->Terminate();
+	sink->Terminate();
+
+	ReportResult(name, iterations, elapsed);
+}
+
+
+void RunElementBenchmarks(int iterations)
+{
+	WakeRoundTrip("Element/WakeRoundTrip/Shared", ExecutionModeEnum::Shared, iterations / 10);
+	WakeRoundTrip("Element/WakeRoundTrip/Dedicated", ExecutionModeEnum::Dedicated, iterations / 10);
+
+	PinHandoff("Pin/HandoffRoundTrip/Shared", ExecutionModeEnum::Shared, iterations / 10);
+	PinHandoff("Pin/HandoffRoundTrip/Dedicated", ExecutionModeEnum::Dedicated, iterations / 10);
+}
@@ -0,0 +1,72 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#include "Benchmark.h"
+
+#include "Event.h"
+#include "EventArgs.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+
+// Invokes an Event with a fixed number of listeners that each do a
+// trivial amount of work.  Measures the dispatch cost per Invoke.
+static void Invoke(int listenerCount, int iterations)
+{
+	Event<EventArgs> event;
+	std::vector<EventListenerSPTR<EventArgs>> listeners;
+	volatile int counter = 0;
+
+	for (int i = 0; i < listenerCount; ++i)
+	{
+		auto listener = std::make_shared<EventListener<EventArgs>>(
+			[&counter](void* sender, const EventArgs& args)
+		{
+			counter = counter + 1;
+		});
+
+		event.AddListener(listener);
+		listeners.push_back(listener);
+	}
+
+
+	EventArgs args;
+
+	Stopwatch stopwatch;
+
+	for (int i = 0; i < iterations; ++i)
+	{
+		event.Invoke(&event, args);
+	}
+
+	uint64_t elapsed = stopwatch.ElapsedNanoseconds();
+
+
+	std::string name = "Event/Invoke" + std::to_string(listenerCount);
+	ReportResult(name.c_str(), iterations, elapsed);
+}
+
+
+void RunEventBenchmarks(int iterations)
+{
+	Invoke(0, iterations);
+	Invoke(1, iterations);
+	Invoke(4, iterations);
+	Invoke(16, iterations / 4);
+	Invoke(64, iterations / 16);
+}
@@ -0,0 +1,72 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#include "Benchmark.h"
+
+#include <cstdlib>
+#include <cstring>
+
+
+
+static void PrintUsage()
+{
+	printf("Usage: c2play-microbench [--json file] [iterations]\n");
+}
+
+
+int main(int argc, char** argv)
+{
+	int iterations = 1000000;
+	const char* jsonPath = nullptr;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--json") == 0)
+		{
+			if (i + 1 >= argc)
+			{
+				PrintUsage();
+				return EXIT_FAILURE;
+			}
+
+			jsonPath = argv[++i];
+		}
+		else
+		{
+			iterations = atoi(argv[i]);
+			if (iterations < 10)
+			{
+				PrintUsage();
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+
+	RunQueueBenchmarks(iterations);
+	RunEventBenchmarks(iterations);
+	RunElementBenchmarks(iterations);
+	RunPacketBenchmarks(iterations);
+	RunBitstreamBenchmarks(iterations);
+	RunTeeBenchmarks(iterations);
+
+	if (jsonPath && !BenchmarkReport::WriteJson(jsonPath, iterations))
+	{
+		return EXIT_FAILURE;
+	}
+
+	return 0;
+}
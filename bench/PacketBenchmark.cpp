@@ -0,0 +1,91 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#include "Benchmark.h"
+
+#include "Buffer.h"
+#include "NullSinkElement.h"
+#include "PacketBufferPool.h"
+
+#include <memory>
+#include <vector>
+
+
+// Typical compressed video packet
+static const int PACKET_SIZE = 16 * 1024;
+
+
+// MediaSourceElement recycles its AVPacketBuffers: Reset() releases
+// the previous payload and the demuxer fills in a new one.  With a
+// pool the payload comes from PacketBufferPool::NewPacket, as the
+// packets BitstreamFilterElement builds do.
+static void Reuse(const char* name, ElementSPTR owner, PacketBufferPool* pool, int iterations)
+{
+	AVPacketBufferSPTR buffer = std::make_shared<AVPacketBuffer>(owner);
+
+	Stopwatch stopwatch;
+
+	for (int i = 0; i < iterations; ++i)
+	{
+		buffer->Reset();
+
+		AVPacket* pkt = buffer->GetAVPacket();
+		if (pool)
+		{
+			pool->NewPacket(pkt, PACKET_SIZE);
+		}
+		else if (av_new_packet(pkt, PACKET_SIZE) < 0)
+		{
+			throw Exception("av_new_packet failed.");
+		}
+	}
+
+	uint64_t elapsed = stopwatch.ElapsedNanoseconds();
+
+	ReportResult(name, iterations, elapsed);
+}
+
+// The alternative to reuse: a fresh buffer for every packet
+static void Allocate(const char* name, ElementSPTR owner, int iterations)
+{
+	Stopwatch stopwatch;
+
+	for (int i = 0; i < iterations; ++i)
+	{
+		AVPacketBufferSPTR buffer = std::make_shared<AVPacketBuffer>(owner);
+
+		AVPacket* pkt = buffer->GetAVPacket();
+		if (av_new_packet(pkt, PACKET_SIZE) < 0)
+			throw Exception("av_new_packet failed.");
+	}
+
+	uint64_t elapsed = stopwatch.ElapsedNanoseconds();
+
+	ReportResult(name, iterations, elapsed);
+}
+
+
+void RunPacketBenchmarks(int iterations)
+{
+	// Buffers only need an owner; it is never executed
+	ElementSPTR owner = std::make_shared<NullSinkElement>();
+
+	PacketBufferPool pool;
+
+	Reuse("AVPacketBuffer/Reset", owner, nullptr, iterations / 10);
+	Reuse("AVPacketBuffer/ResetPooled", owner, &pool, iterations / 10);
+	Allocate("AVPacketBuffer/Allocate", owner, iterations / 10);
+}
@@ -0,0 +1,352 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+// c2play-bench: runs the core pipeline headless and unthrottled.
+//
+//   MediaSource -> AudioCodec -> AudioBenchSink (null or WAV)
+//              \-> NullSink (video packets)
+//
+// With --codec-emulator the video packets go through BitstreamFilter
+// to AmlVideoSink instead, writing into the emulated amstream decoder
+// (AmlEmulatorDevice).
+
+#include "Benchmark.h"
+#include "AudioBenchSinkElement.h"
+
+#include "MediaSourceElement.h"
+#include "AudioCodec.h"
+#include "NullSinkElement.h"
+#include "AmlVideoSink.h"
+#include "BitstreamFilterElement.h"
+#include "AmlEmulator.h"
+#include "Metrics.h"
+
+#include <getopt.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <vector>
+
+
+
+static double CpuSeconds(const rusage& usage)
+{
+	return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1000000.0 +
+		usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1000000.0;
+}
+
+static void DisplayHelp()
+{
+	printf("Usage: c2play-bench [OPTIONS] FILE\n");
+	printf("Decode FILE as fast as possible without audio or video output\n\n");
+
+	printf("      --wav file\tWrite the decoded audio to a 16-bit WAV file\n");
+	printf("      --video n\t\tIndex of video stream\n");
+	printf("      --audio n\t\tIndex of audio stream\n");
+	printf("      --timeout n\tStop after n seconds\n");
+	printf("      --codec-emulator file\tSend video to an emulated decoder, logging its input to file\n");
+	printf("      --codec-speed n\tRun the emulated decoder n times faster than real time\n");
+}
+
+struct option longopts[] = {
+	{ "help",			no_argument,        NULL,          'h' },
+	{ "wav",			required_argument,  NULL,          'w' },
+	{ "video",			required_argument,  NULL,          'v' },
+	{ "audio",			required_argument,  NULL,          'a' },
+	{ "timeout",		required_argument,  NULL,          't' },
+	{ "codec-emulator",	required_argument,  NULL,          'E' },
+	{ "codec-speed",	required_argument,  NULL,          'S' },
+	{ 0, 0, 0, 0 }
+};
+
+
+
+int main(int argc, char** argv)
+{
+	std::string wavPath;
+	int videoIndex = 0;
+	int audioIndex = 0;
+	double timeout = 0;
+	const char* emulatorPath = nullptr;
+	double emulatorSpeed = 1.0;
+
+	int c;
+	while ((c = getopt_long(argc, argv, "", longopts, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 'w':
+				wavPath = optarg;
+				break;
+
+			case 'v':
+				videoIndex = atoi(optarg);
+				break;
+
+			case 'a':
+				audioIndex = atoi(optarg);
+				break;
+
+			case 't':
+				timeout = atof(optarg);
+				break;
+
+			case 'E':
+				emulatorPath = optarg;
+				break;
+
+			case 'S':
+				emulatorSpeed = atof(optarg);
+				break;
+
+			case 'h':
+			default:
+				DisplayHelp();
+				exit(EXIT_FAILURE);
+		}
+	}
+
+	if (optind >= argc)
+	{
+		DisplayHelp();
+		exit(EXIT_FAILURE);
+	}
+
+	const char* url = argv[optind];
+
+
+	av_register_all();
+	avformat_network_init();
+
+	ElementMetrics::SetCpuTimeEnabled(true);
+
+	AmlEmulatorDeviceSPTR emulator;
+	if (emulatorPath)
+	{
+		emulator = std::make_shared<AmlEmulatorDevice>(emulatorPath, emulatorSpeed);
+		AmlDevice::SetDefault(emulator);
+	}
+
+
+	// Build the pipeline
+	MediaSourceElementSPTR source = std::make_shared<MediaSourceElement>(url, std::string());
+	source->SetName("Source");
+	source->Execute();
+	source->WaitForExecutionState(ExecutionStateEnum::Idle);
+
+	std::vector<ElementSPTR> sinks;
+	std::vector<ElementSPTR> elements;
+	elements.push_back(source);
+
+	AmlVideoSinkElementSPTR amlVideoSink;
+	BitstreamFilterElementSPTR videoFilter;
+	OutPinSPTR sourceVideoPin = source->Outputs()->Find(MediaCategoryEnum::Video, videoIndex);
+	if (sourceVideoPin)
+	{
+		ElementSPTR videoSink;
+		if (emulator)
+		{
+			amlVideoSink = std::make_shared<AmlVideoSinkElement>();
+			videoSink = amlVideoSink;
+		}
+		else
+		{
+			videoSink = std::make_shared<NullSinkElement>();
+		}
+
+		videoSink->SetName("VideoSink");
+		videoSink->Execute();
+		videoSink->WaitForExecutionState(ExecutionStateEnum::Idle);
+
+		if (amlVideoSink)
+		{
+			videoFilter = std::make_shared<BitstreamFilterElement>();
+			videoFilter->SetName("VideoFilter");
+			videoFilter->Execute();
+			videoFilter->WaitForExecutionState(ExecutionStateEnum::Idle);
+
+			sourceVideoPin->Connect(videoFilter->Inputs()->Item(0));
+			videoFilter->Outputs()->Item(0)->Connect(videoSink->Inputs()->Item(0));
+
+			elements.push_back(videoFilter);
+		}
+		else
+		{
+			sourceVideoPin->Connect(videoSink->Inputs()->Item(0));
+		}
+
+		sinks.push_back(videoSink);
+		elements.push_back(videoSink);
+	}
+
+	AudioBenchSinkElementSPTR audioSink;
+	OutPinSPTR sourceAudioPin = source->Outputs()->Find(MediaCategoryEnum::Audio, audioIndex);
+	if (sourceAudioPin)
+	{
+		ElementSPTR audioCodec = std::make_shared<AudioCodecElement>();
+		audioCodec->SetName("AudioCodec");
+		audioCodec->Execute();
+		audioCodec->WaitForExecutionState(ExecutionStateEnum::Idle);
+
+		audioSink = std::make_shared<AudioBenchSinkElement>(wavPath);
+		audioSink->SetName("AudioSink");
+		audioSink->Execute();
+		audioSink->WaitForExecutionState(ExecutionStateEnum::Idle);
+
+		sourceAudioPin->Connect(audioCodec->Inputs()->Item(0));
+		audioCodec->Outputs()->Item(0)->Connect(audioSink->Inputs()->Item(0));
+
+		sinks.push_back(audioSink);
+		elements.push_back(audioCodec);
+		elements.push_back(audioSink);
+	}
+
+	if (sinks.size() < 1)
+	{
+		printf("c2play-bench: no audio or video stream found.\n");
+		return EXIT_FAILURE;
+	}
+
+
+	// Run until every sink has seen the end of the stream
+	rusage usageStart;
+	getrusage(RUSAGE_SELF, &usageStart);
+
+	Stopwatch stopwatch;
+
+	for (int i = (int)elements.size() - 1; i >= 0; --i)
+	{
+		elements[i]->SetState(MediaState::Play);
+	}
+
+	bool isTimedOut = false;
+	while (true)
+	{
+		bool isFinished = true;
+		for (auto& sink : sinks)
+		{
+			if (sink->State() != MediaState::Pause)
+			{
+				isFinished = false;
+			}
+		}
+
+		if (isFinished)
+			break;
+
+		if (timeout > 0 && stopwatch.ElapsedNanoseconds() / 1e9 >= timeout)
+		{
+			isTimedOut = true;
+			break;
+		}
+
+		usleep(1000);
+	}
+
+	double wallSeconds = stopwatch.ElapsedNanoseconds() / 1e9;
+
+	rusage usageEnd;
+	getrusage(RUSAGE_SELF, &usageEnd);
+
+
+	// Report
+	MetricsSnapshot snapshot = MetricsRegistry::Snapshot();
+
+	uint64_t packets = 0;
+	uint64_t packetBytes = 0;
+	for (auto& element : snapshot.Elements)
+	{
+		if (element.Name == "Source")
+		{
+			for (auto& pin : element.Pins)
+			{
+				packets += pin.Buffers;
+				packetBytes += pin.Bytes;
+			}
+
+			// Each pin also sent an end of stream marker
+			if (!isTimedOut && packets >= element.Pins.size())
+			{
+				packets -= element.Pins.size();
+			}
+		}
+	}
+
+	double audioSeconds = audioSink ? audioSink->Seconds() : 0;
+
+	printf("\n");
+	printf("c2play-bench: %s%s\n", url, isTimedOut ? " (timed out)" : "");
+	printf("  wall time         %10.3f s\n", wallSeconds);
+	printf("  process cpu       %10.3f s\n", CpuSeconds(usageEnd) - CpuSeconds(usageStart));
+	printf("  packets           %10llu (%.1f/s, %.1f MB/s)\n",
+		(unsigned long long)packets,
+		packets / wallSeconds,
+		packetBytes / wallSeconds / (1024.0 * 1024.0));
+	printf("  audio decoded     %10.3f s (%.1f s per wall second)\n", audioSeconds, audioSeconds / wallSeconds);
+	printf("  peak rss          %10ld KB\n", usageEnd.ru_maxrss);
+
+	if (emulator)
+	{
+		AmlEmulatorStats stats = emulator->Stats();
+		printf("  emulated frames   %10lu (%lu underruns)\n", stats.FramesDecoded, stats.Underruns);
+		printf("  codec writes      %10lu (%lu blocked, %.3f s; %lu full)\n", stats.Writes, stats.BlockedWrites, stats.BlockedSeconds, stats.FullWrites);
+		printf("  codec polls       %10lu\n", stats.Polls);
+		printf("  codec bytes       %10llu\n", stats.BytesWritten);
+	}
+
+	if (amlVideoSink)
+	{
+		CodecWriteStats writes = amlVideoSink->WriteStats();
+		printf("  writes per frame  %10.2f (max %lu)\n",
+			writes.Frames > 0 ? writes.Writes / (double)writes.Frames : 0.0,
+			writes.MaxWritesPerFrame);
+		printf("  write stalls      %10lu (%.3f s, max %.3f s, %lu resets)\n",
+			writes.Stalls, writes.StallSeconds, writes.MaxStallSeconds, writes.Resets);
+
+		EndOfStreamStats eos = amlVideoSink->EosStats();
+		printf("  eos latency       %10.3f s (%lu drain checks)\n", eos.LastLatency, eos.Checks);
+	}
+
+	if (videoFilter)
+	{
+		BitstreamFilterStats filterStats = videoFilter->Stats();
+		printf("  filter copied     %10llu bytes (%lu of %lu packets passed through)\n",
+			filterStats.BytesCopied, filterStats.PassedThrough, filterStats.Packets);
+	}
+
+	printf("\n");
+	printf("  %-12s %10s %10s %10s %10s\n", "stage", "DoWork", "cpu s", "wall s", "p99 s");
+
+	for (auto& element : snapshot.Elements)
+	{
+		printf("  %-12s %10llu %10.3f %10.3f %10.6f\n",
+			element.Name.c_str(),
+			(unsigned long long)element.WorkCount,
+			element.WorkCpuSeconds,
+			element.WorkSeconds,
+			element.WorkPercentile(0.99));
+	}
+
+
+	// Tear down, sinks first
+	for (int i = (int)elements.size() - 1; i >= 0; --i)
+	{
+		elements[i]->Terminate();
+		elements[i]->WaitForExecutionState(ExecutionStateEnum::WaitingForExecute);
+	}
+
+	return isTimedOut ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,219 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#include "Benchmark.h"
+
+#include "LockedQueue.h"
+#include "SpscQueue.h"
+#include "Thread.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <sched.h>
+
+
+typedef std::shared_ptr<int> ItemSPTR;
+
+
+// One producer thread streams a pool of recycled items to one
+// consumer, which hands them straight back.  This is the shape of
+// an OutPin -> InPin link.
+template <typename TQueue>
+static void Streaming(const char* name, int iterations, int poolSize)
+{
+	TQueue forward;
+	TQueue backward;
+
+	for (int i = 0; i < poolSize; ++i)
+	{
+		backward.Push(std::make_shared<int>(i));
+	}
+
+
+	Thread consumer([&]()
+	{
+		int received = 0;
+		ItemSPTR item;
+
+		while (received < iterations)
+		{
+			if (forward.TryPop(&item))
+			{
+				backward.Push(item);
+				++received;
+			}
+			else
+			{
+				sched_yield();
+			}
+		}
+	});
+
+
+	Stopwatch stopwatch;
+	consumer.Start();
+
+	int sent = 0;
+	ItemSPTR item;
+	while (sent < iterations)
+	{
+		if (backward.TryPop(&item))
+		{
+			forward.Push(item);
+			++sent;
+		}
+		else
+		{
+			sched_yield();
+		}
+	}
+
+	consumer.Join();
+
+	ReportResult(name, iterations, stopwatch.ElapsedNanoseconds());
+}
+
+// A single item bounces between two threads, measuring the
+// round-trip hand-off latency.
+template <typename TQueue>
+static void PingPong(const char* name, int iterations)
+{
+	TQueue ping;
+	TQueue pong;
+
+
+	Thread responder([&]()
+	{
+		ItemSPTR item;
+		int count = 0;
+
+		while (count < iterations)
+		{
+			if (ping.TryPop(&item))
+			{
+				pong.Push(item);
+				++count;
+			}
+			else
+			{
+				sched_yield();
+			}
+		}
+	});
+
+
+	Stopwatch stopwatch;
+	responder.Start();
+
+	ItemSPTR item = std::make_shared<int>(0);
+	for (int i = 0; i < iterations; ++i)
+	{
+		ping.Push(item);
+
+		while (!pong.TryPop(&item))
+		{
+			sched_yield();
+		}
+	}
+
+	responder.Join();
+
+	ReportResult(name, iterations, stopwatch.ElapsedNanoseconds());
+}
+
+
+// Several producers and consumers share one queue.  Every push and
+// pop competes for the same lock, as on a pin that is fed from more
+// than one thread.
+template <typename TQueue>
+static void Contended(const char* name, int iterations, int threadCount)
+{
+	TQueue queue;
+	std::atomic<int> received(0);
+	int perProducer = iterations / threadCount;
+	int total = perProducer * threadCount;
+
+	std::vector<ThreadSPTR> threads;
+
+	for (int i = 0; i < threadCount; ++i)
+	{
+		threads.push_back(std::make_shared<Thread>([&, i]()
+		{
+			ItemSPTR item = std::make_shared<int>(i);
+
+			for (int j = 0; j < perProducer; ++j)
+			{
+				queue.Push(item);
+
+				if ((j & 63) == 63)
+				{
+					sched_yield();
+				}
+			}
+		}));
+
+		threads.push_back(std::make_shared<Thread>([&]()
+		{
+			ItemSPTR item;
+
+			while (received.load(std::memory_order_relaxed) < total)
+			{
+				if (queue.TryPop(&item))
+				{
+					received.fetch_add(1, std::memory_order_relaxed);
+				}
+				else
+				{
+					sched_yield();
+				}
+			}
+		}));
+	}
+
+
+	Stopwatch stopwatch;
+
+	for (auto& thread : threads)
+	{
+		thread->Start();
+	}
+
+	for (auto& thread : threads)
+	{
+		thread->Join();
+	}
+
+	ReportResult(name, total, stopwatch.ElapsedNanoseconds());
+}
+
+
+void RunQueueBenchmarks(int iterations)
+{
+	// MediaSourceElement keeps 64 packets in flight
+	const int POOL_SIZE = 64;
+
+	Streaming<ThreadSafeQueue<ItemSPTR>>("ThreadSafeQueue/Streaming", iterations, POOL_SIZE);
+	Streaming<SpscQueue<ItemSPTR>>("SpscQueue/Streaming", iterations, POOL_SIZE);
+	Streaming<LockedQueue<ItemSPTR>>("LockedQueue/Streaming", iterations, POOL_SIZE);
+
+	PingPong<ThreadSafeQueue<ItemSPTR>>("ThreadSafeQueue/PingPong", iterations / 10);
+	PingPong<SpscQueue<ItemSPTR>>("SpscQueue/PingPong", iterations / 10);
+	PingPong<LockedQueue<ItemSPTR>>("LockedQueue/PingPong", iterations / 10);
+
+	Contended<ThreadSafeQueue<ItemSPTR>>("ThreadSafeQueue/Contended4x4", iterations, 4);
+	Contended<LockedQueue<ItemSPTR>>("LockedQueue/Contended4x4", iterations, 4);
+}
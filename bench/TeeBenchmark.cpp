@@ -0,0 +1,316 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#include "Benchmark.h"
+
+#include "Element.h"
+#include "Exception.h"
+#include "NullSinkElement.h"
+#include "TeeElement.h"
+#include "WaitCondition.h"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+
+// Upstream buffers the tee has to share between its branches
+static const int POOL_SIZE = 32;
+
+
+// Sends 'total' buffers from a small pool and signals once every
+// buffer has come back, so all branches are done with them.
+class TeeSourceElement : public Element
+{
+	OutPinSPTR pin;
+	int total;
+	int sent = 0;
+	WaitCondition finished;
+
+
+protected:
+
+	virtual void Initialize() override
+	{
+		ClearOutputPins();
+
+		PinInfoSPTR info = std::make_shared<PinInfo>(MediaCategoryEnum::Unknown);
+		pin = std::make_shared<OutPin>(shared_from_this(), info);
+		AddOutputPin(pin);
+
+		for (int i = 0; i < POOL_SIZE; ++i)
+		{
+			pin->AcceptProcessedBuffer(std::make_shared<ClockDataBuffer>(shared_from_this()));
+		}
+	}
+
+	virtual void DoWork() override
+	{
+		BufferSPTR buffer;
+		while (sent < total && pin->TryGetAvailableBuffer(&buffer))
+		{
+			++sent;
+			pin->SendBuffer(buffer);
+		}
+
+		if (sent == total &&
+			pin->SnapshotMetrics().AvailableCount == POOL_SIZE)
+		{
+			finished.Signal();
+		}
+	}
+
+
+public:
+
+	TeeSourceElement(int total)
+		: total(total)
+	{
+		SetName("TeeSource");
+		SetExecutionMode(ExecutionModeEnum::Dedicated);
+	}
+
+
+	void WaitForFinished()
+	{
+		finished.WaitForSignal();
+	}
+
+	// Only valid once finished
+	int ReadOnlyReturned()
+	{
+		int result = 0;
+
+		BufferSPTR buffer;
+		while (pin->TryGetAvailableBuffer(&buffer))
+		{
+			if (buffer->IsReadOnly())
+			{
+				++result;
+			}
+		}
+
+		return result;
+	}
+};
+
+typedef std::shared_ptr<TeeSourceElement> TeeSourceElementSPTR;
+
+
+// Counts what a branch receives; a delay makes it fall behind
+class TeeSinkElement : public NullSinkElement
+{
+	int delayMicroseconds;
+	std::atomic<int> received;
+	std::atomic<int> readOnly;
+
+
+public:
+
+	TeeSinkElement(int delayMicroseconds)
+		: delayMicroseconds(delayMicroseconds), received(0), readOnly(0)
+	{
+		SetName("TeeSink");
+		SetExecutionMode(ExecutionModeEnum::Dedicated);
+	}
+
+
+	int Received() const
+	{
+		return received.load();
+	}
+
+	int ReadOnly() const
+	{
+		return readOnly.load();
+	}
+
+
+	virtual void DoWork() override
+	{
+		InPinSPTR pin = Inputs()->Item(0);
+
+		BufferSPTR buffer;
+		while (pin->TryGetFilledBuffer(&buffer))
+		{
+			received.fetch_add(1);
+
+			if (buffer->IsReadOnly())
+			{
+				readOnly.fetch_add(1);
+			}
+
+			if (delayMicroseconds > 0)
+			{
+				usleep(delayMicroseconds);
+			}
+
+			pin->PushProcessedBuffer(buffer);
+			pin->ReturnProcessedBuffers();
+		}
+	}
+};
+
+typedef std::shared_ptr<TeeSinkElement> TeeSinkElementSPTR;
+
+
+struct TeeRun
+{
+	std::vector<TeeSinkElementSPTR> Sinks;
+	std::vector<uint64_t> Dropped;
+	int ReadOnlyReturned = 0;
+	uint64_t Nanoseconds = 0;
+};
+
+static TeeRun RunTee(const std::vector<TeeBranchOptions>& options, const std::vector<int>& delays, int total)
+{
+	TeeRun result;
+
+	TeeSourceElementSPTR source = std::make_shared<TeeSourceElement>(total);
+
+	TeeElementSPTR tee = std::make_shared<TeeElement>(
+		std::make_shared<PinInfo>(MediaCategoryEnum::Unknown), (int)options.size());
+
+	for (size_t i = 0; i < options.size(); ++i)
+	{
+		tee->SetBranchOptions((int)i, options[i]);
+		result.Sinks.push_back(std::make_shared<TeeSinkElement>(delays[i]));
+	}
+
+
+	source->Execute();
+	tee->Execute();
+	for (auto& sink : result.Sinks)
+	{
+		sink->Execute();
+	}
+
+	source->WaitForExecutionState(ExecutionStateEnum::Idle);
+	tee->WaitForExecutionState(ExecutionStateEnum::Idle);
+	for (auto& sink : result.Sinks)
+	{
+		sink->WaitForExecutionState(ExecutionStateEnum::Idle);
+	}
+
+	source->Outputs()->Item(0)->Connect(tee->Inputs()->Item(0));
+	for (size_t i = 0; i < result.Sinks.size(); ++i)
+	{
+		tee->Outputs()->Item(i)->Connect(result.Sinks[i]->Inputs()->Item(0));
+		result.Sinks[i]->SetState(MediaState::Play);
+	}
+
+	tee->SetState(MediaState::Play);
+
+
+	Stopwatch stopwatch;
+
+	source->SetState(MediaState::Play);
+	source->WaitForFinished();
+
+	result.Nanoseconds = stopwatch.ElapsedNanoseconds();
+
+
+	for (int i = 0; i < tee->Outputs()->Count(); ++i)
+	{
+		result.Dropped.push_back(tee->Outputs()->Item(i)->SnapshotMetrics().Dropped);
+	}
+
+	result.ReadOnlyReturned = source->ReadOnlyReturned();
+
+	source->Terminate();
+	tee->Terminate();
+	for (auto& sink : result.Sinks)
+	{
+		sink->Terminate();
+	}
+
+	return result;
+}
+
+
+// Every branch gets every buffer, marked read-only while it is
+// shared, and each buffer goes upstream writable once all branches
+// have returned it.
+static void FanOut(const char* name, int branchCount, int iterations)
+{
+	std::vector<TeeBranchOptions> options(branchCount);
+	std::vector<int> delays(branchCount, 0);
+
+	TeeRun run = RunTee(options, delays, iterations);
+
+	// A single branch does not share the buffer
+	int expectedReadOnly = (branchCount > 1) ? iterations : 0;
+
+	for (auto& sink : run.Sinks)
+	{
+		if (sink->Received() != iterations)
+			throw Exception("TeeElement: a branch missed buffers.");
+
+		if (sink->ReadOnly() != expectedReadOnly)
+			throw Exception("TeeElement: a shared buffer was writable.");
+	}
+
+	if (run.ReadOnlyReturned != 0)
+		throw Exception("TeeElement: a buffer went upstream read-only.");
+
+	ReportResult(name, iterations, run.Nanoseconds);
+}
+
+// A slow branch sheds what it cannot keep up with while the Block
+// branch next to it still receives every buffer.
+static void Overflow(const char* name, TeePolicyEnum policy, int iterations)
+{
+	std::vector<TeeBranchOptions> options(2);
+	options[1].Policy = policy;
+	options[1].Capacity = 4;
+
+	std::vector<int> delays;
+	delays.push_back(0);
+	delays.push_back(100);
+
+	TeeRun run = RunTee(options, delays, iterations);
+
+	if (run.Sinks[0]->Received() != iterations ||
+		run.Dropped[0] != 0)
+	{
+		throw Exception("TeeElement: the Block branch missed buffers.");
+	}
+
+	if (run.Sinks[1]->Received() + (int)run.Dropped[1] != iterations)
+		throw Exception("TeeElement: the dropping branch lost count of buffers.");
+
+	if (run.Dropped[1] == 0)
+		throw Exception("TeeElement: the slow branch never dropped.");
+
+	printf("%-40s %12d received %10llu dropped\n",
+		name,
+		run.Sinks[1]->Received(),
+		(unsigned long long)run.Dropped[1]);
+
+	ReportResult(name, iterations, run.Nanoseconds);
+}
+
+
+void RunTeeBenchmarks(int iterations)
+{
+	FanOut("Tee/FanOut/1", 1, iterations / 100);
+	FanOut("Tee/FanOut/3", 3, iterations / 100);
+
+	Overflow("Tee/Overflow/DropOldest", TeePolicyEnum::DropOldest, iterations / 1000);
+	Overflow("Tee/Overflow/DropNew", TeePolicyEnum::DropNew, iterations / 1000);
+}
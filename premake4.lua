@@ -1,6 +1,16 @@
 #!lua
 local output = "./build/" .. _ACTION
 
+newoption {
+   trigger = "trace",
+   description = "Compile in the binary event trace (--trace file)"
+}
+
+newoption {
+   trigger = "fuzz",
+   description = "Add the libFuzzer targets (build them with CXX=clang++)"
+}
+
 solution "c2play_solution"
    configurations { "Debug", "Release" }
 
@@ -14,6 +24,10 @@ project "c2play"
    buildoptions { "-std=c++11" }
    linkoptions { "-lavformat -lavcodec -lavutil -lpthread -lasound -lrt -lEGL -lGLESv2 -lass" }
 
+   if _OPTIONS["trace"] then
+      defines { "C2PLAY_TRACE" }
+   end
+
    configuration "Debug"
       flags { "Symbols" }
       defines { "DEBUG" }
@@ -33,6 +47,10 @@ project "c2play-x11"
    linkoptions { "-lavformat -lavcodec -lavutil -lpthread -lasound -lrt -lX11 -lEGL -lGLESv2 -lass" }
    defines { "X11" }
 
+   if _OPTIONS["trace"] then
+      defines { "C2PLAY_TRACE" }
+   end
+
    configuration "Debug"
       flags { "Symbols" }
       defines { "DEBUG" }
@@ -40,3 +58,139 @@ project "c2play-x11"
    configuration "Release"
       flags { "Optimize" }
       defines { "" }
+
+project "c2play-microbench"
+   location (output)
+   kind "ConsoleApp"
+   language "C++"
+   includedirs { "src/Media" }
+   files {
+      "bench/Benchmark.h",
+      "bench/Benchmark.cpp",
+      "bench/BitstreamBenchmark.cpp",
+      "bench/ElementBenchmark.cpp",
+      "bench/EventBenchmark.cpp",
+      "bench/MicroBenchmark.cpp",
+      "bench/PacketBenchmark.cpp",
+      "bench/QueueBenchmark.cpp",
+      "bench/TeeBenchmark.cpp",
+      "src/Media/Bitstream.cpp",
+      "src/Media/Buffer.cpp",
+      "src/Media/Element.cpp",
+      "src/Media/Exception.cpp",
+      "src/Media/Executor.cpp",
+      "src/Media/InPin.cpp",
+      "src/Media/LockedQueue.cpp",
+      "src/Media/Metrics.cpp",
+      "src/Media/Mutex.cpp",
+      "src/Media/OutPin.cpp",
+      "src/Media/PacketBufferPool.cpp",
+      "src/Media/Pin.cpp",
+      "src/Media/TeeElement.cpp",
+      "src/Media/Thread.cpp",
+      "src/Media/Trace.cpp"
+   }
+   buildoptions { "-std=c++11 -Wall" }
+   linkoptions { "-lavformat -lavcodec -lavutil -lpthread -lrt" }
+
+   configuration "Debug"
+      flags { "Symbols" }
+      defines { "DEBUG" }
+
+   configuration "Release"
+      flags { "Optimize" }
+      defines { "NDEBUG" }
+
+project "c2play-bench"
+   location (output)
+   kind "ConsoleApp"
+   language "C++"
+   includedirs { "src/Media", "src/UI", "bench" }
+   files {
+      "bench/Benchmark.h",
+      "bench/AudioBenchSinkElement.h",
+      "bench/PipelineBenchmark.cpp",
+      "src/Media/AmlCodec.cpp",
+      "src/Media/AmlDevice.cpp",
+      "src/Media/AmlEmulator.cpp",
+      "src/Media/AmlVideoSink.cpp",
+      "src/Media/AudioCodec.cpp",
+      "src/Media/Bitstream.cpp",
+      "src/Media/BitstreamFilterElement.cpp",
+      "src/Media/Buffer.cpp",
+      "src/Media/Codec.cpp",
+      "src/Media/Element.cpp",
+      "src/Media/Exception.cpp",
+      "src/Media/Executor.cpp",
+      "src/Media/InPin.cpp",
+      "src/Media/LockedQueue.cpp",
+      "src/Media/MediaClock.cpp",
+      "src/Media/MediaSourceElement.cpp",
+      "src/Media/Metrics.cpp",
+      "src/Media/Mutex.cpp",
+      "src/Media/OutPin.cpp",
+      "src/Media/PacketBufferPool.cpp",
+      "src/Media/Pin.cpp",
+      "src/Media/PublishedClock.cpp",
+      "src/Media/Thread.cpp",
+      "src/Media/TimerService.cpp",
+      "src/Media/Trace.cpp",
+      "src/Media/VptsSampler.cpp"
+   }
+   buildoptions { "-std=c++11 -Wall" }
+   linkoptions { "-lavformat -lavcodec -lavutil -lpthread -lrt" }
+
+   if _OPTIONS["trace"] then
+      defines { "C2PLAY_TRACE" }
+   end
+
+   configuration "Debug"
+      flags { "Symbols" }
+      defines { "DEBUG" }
+
+   configuration "Release"
+      flags { "Optimize" }
+      defines { "NDEBUG" }
+
+project "c2play-bitstream-test"
+   location (output)
+   kind "ConsoleApp"
+   language "C++"
+   includedirs { "src/Media" }
+   files {
+      "test/BitstreamTest.cpp",
+      "src/Media/Bitstream.cpp",
+      "src/Media/Exception.cpp"
+   }
+   buildoptions { "-std=c++11 -Wall" }
+
+   configuration "Debug"
+      flags { "Symbols" }
+      defines { "DEBUG" }
+
+   configuration "Release"
+      flags { "Optimize" }
+      defines { "NDEBUG" }
+
+if _OPTIONS["fuzz"] then
+   project "c2play-bitstream-fuzzer"
+      location (output)
+      kind "ConsoleApp"
+      language "C++"
+      includedirs { "src/Media" }
+      files {
+         "test/BitstreamFuzzer.cpp",
+         "src/Media/Bitstream.cpp",
+         "src/Media/Exception.cpp"
+      }
+      buildoptions { "-std=c++11 -Wall -fsanitize=fuzzer,address,undefined" }
+      linkoptions { "-fsanitize=fuzzer,address,undefined" }
+
+      configuration "Debug"
+         flags { "Symbols" }
+         defines { "DEBUG" }
+
+      configuration "Release"
+         flags { "Optimize" }
+         defines { "NDEBUG" }
+end
@@ -83,7 +83,11 @@ void AlsaAudioSinkElement::ProcessBuffer(PcmDataBufferSPTR pcmBuffer)
 
 	if (isFirstBuffer)
 	{
-		SetupAlsa(pcmData->Samples);
+		if (!mediaClock->IsVirtual())
+		{
+			SetupAlsa(pcmData->Samples);
+		}
+
 		isFirstBuffer = false;
 	}
 
@@ -314,7 +318,11 @@ void AlsaAudioSinkElement::ProcessBuffer(PcmDataBufferSPTR pcmBuffer)
 	//printf("snd_pcm_delay: handle=%p, &delay=%p\n", handle, &delay);
 	double adjust = 0;
 
-	if (snd_pcm_delay(handle, &delay) != 0)
+	if (mediaClock->IsVirtual())
+	{
+		// Consumed immediately, nothing is queued
+	}
+	else if (snd_pcm_delay(handle, &delay) != 0)
 	{
 		printf("snd_pcm_delay failed.\n");
 	}
@@ -332,37 +340,21 @@ void AlsaAudioSinkElement::ProcessBuffer(PcmDataBufferSPTR pcmBuffer)
 	if (pcmBuffer->TimeStamp() > 0)
 	{
 		double time = pcmBuffer->TimeStamp() + adjust + audioAdjustSeconds;
-		clock = time;
-
-		BufferSPTR clockPinBuffer;
-		if (clockOutPin->TryGetAvailableBuffer(&clockPinBuffer))
-		{
-			ClockDataBufferSPTR clockDataBuffer = std::static_pointer_cast<ClockDataBuffer>(clockPinBuffer);
-			clockDataBuffer->SetTimeStamp(time);
-
-			clockOutPin->SendBuffer(clockDataBuffer);
-
-			//printf("AmlAudioSinkElement: clock=%f\n", pcmBuffer->TimeStamp());
-		}
+		audioClock->Publish(time);
+	}
 
 
-		// New clock interface
-		for (IClockSinkSPTR sink : clockSinks)
-		{
-			//printf("AmlAudioSinkElement: IClockSinkSPTR sink=%p\n", sink.get());
 
-			if (sink)
-			{
-				sink->SetTimeStamp(time);
-			}
-		}
+	if (mediaClock->IsVirtual())
+	{
+		// Stands in for the time snd_pcm_writei would have blocked
+		mediaClock->Advance(pcmData->Samples / (double)sampleRate);
 	}
 
 
-
 	// Send data to ALSA
 	int totalFramesWritten = 0;
-	while (totalFramesWritten < pcmData->Samples)
+	while (handle && totalFramesWritten < pcmData->Samples)
 	{
 		/*
 		From ALSA docs:
@@ -421,6 +413,15 @@ void AlsaAudioSinkElement::ProcessBuffer(PcmDataBufferSPTR pcmBuffer)
 
 
 
+AlsaAudioSinkElement::AlsaAudioSinkElement()
+	: mediaClock(MediaClock::Default()),
+	audioClock(std::make_shared<PublishedClock>(mediaClock))
+{
+	// snd_pcm_writei blocks and the audio clock is latency critical
+	SetExecutionMode(ExecutionModeEnum::Dedicated);
+}
+
+
 double AlsaAudioSinkElement::AudioAdjustSeconds() const
 {
 	return audioAdjustSeconds;
@@ -432,7 +433,7 @@ void AlsaAudioSinkElement::SetAudioAdjustSeconds(double value)
 
 double AlsaAudioSinkElement::Clock() const
 {
-	return clock;
+	return audioClock->Time();
 }
 
 
@@ -467,23 +468,6 @@ void AlsaAudioSinkElement::Initialize()
 		audioPin = std::make_shared<InPin>(weakPtr, info);
 		AddInputPin(audioPin);
 	}
-
-	{
-		// Create the clock pin
-		PinInfoSPTR clockInfo = std::make_shared<PinInfo>(MediaCategoryEnum::Clock);
-
-		ElementWPTR weakPtr = shared_from_this();
-		clockOutPin = std::make_shared<OutPin>(weakPtr, clockInfo);
-		AddOutputPin(clockOutPin);
-
-
-		// Create a buffer
-		for (int i = 0; i < 1; ++i)
-		{
-			ClockDataBufferSPTR clockBuffer = std::make_shared<ClockDataBuffer>(shared_from_this());
-			clockOutPin->AcceptProcessedBuffer(clockBuffer);
-		}
-	}
 }
 
 void AlsaAudioSinkElement::DoWork()
@@ -563,6 +547,10 @@ void AlsaAudioSinkElement::DoWork()
 
 void AlsaAudioSinkElement::Terminating()
 {
+	PublishedClockStats stats = audioClock->Stats();
+	printf("AlsaAudioSinkElement: clock publishes=%lu read retries=%lu\n",
+		stats.Publishes, stats.Retries);
+
 	if (handle)
 	{
 		snd_pcm_drop(handle);
@@ -576,6 +564,12 @@ void AlsaAudioSinkElement::ChangeState(MediaState oldState, MediaState newState)
 {
 	Element::ChangeState(oldState, newState);
 
+	// Readers stop extrapolating; the next buffer publishes again
+	if (newState == MediaState::Pause)
+	{
+		audioClock->Freeze();
+	}
+
 	if (handle)
 	{
 		switch (newState)
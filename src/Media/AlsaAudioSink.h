@@ -28,14 +28,14 @@
 #include "Codec.h"
 #include "Element.h"
 #include "InPin.h"
-#include "IClock.h"
+#include "MediaClock.h"
+#include "PublishedClock.h"
 
 
 
 class AlsaAudioSinkElement : public Element
 {
 	InPinSPTR audioPin;
-	OutPinSPTR clockOutPin;
 
 	const int AUDIO_FRAME_BUFFERCOUNT = 8;
 	const char* device = "default"; //default   //plughw                     /* playback device */
@@ -48,7 +48,7 @@ class AlsaAudioSinkElement : public Element
 	//IClockSinkPtr clockSink;
 	double lastTimeStamp = -1;
 	bool canPause = true;
-	LockedQueue<PcmDataBufferPtr> pcmBuffers = LockedQueue<PcmDataBufferPtr>(128);
+	LockedQueue<PcmDataBufferPtr> pcmBuffers{ 128 };
 
 	bool isFirstData = true;
 	AudioFormatEnum audioFormat = AudioFormatEnum::Unknown;
@@ -58,14 +58,13 @@ class AlsaAudioSinkElement : public Element
 	snd_pcm_uframes_t period_size;
 	snd_pcm_uframes_t buffer_size;
 	double audioAdjustSeconds = 0.0;
-	double clock = 0.0;
 
 	int FRAME_SIZE = 0;
 	bool doResumeFlag = false;
 	bool doPauseFlag = false;
 	Mutex playPauseMutex;
-	//std::vector<IClockSinkSPTR> 
-	ClockList clockSinks;
+	IMediaClockSPTR mediaClock;	// virtual: no ALSA device, playback is paced by the clock
+	PublishedClockSPTR audioClock;
 
 	void SetupAlsa(int frameSize);
 
@@ -73,17 +72,21 @@ class AlsaAudioSinkElement : public Element
 
 public:
 
+	AlsaAudioSinkElement();
+
+
 	double AudioAdjustSeconds() const;
 	void SetAudioAdjustSeconds(double value);
 
 	double Clock() const;
 
-	ClockList* ClockSinks()
+	// The playing position, published from the audio thread.
+	// Readers poll it; nothing is called back.
+	PublishedClockSPTR AudioClock() const
 	{
-		return &clockSinks;
+		return audioClock;
 	}
 
-
 	virtual void Flush() override;
 
 protected:
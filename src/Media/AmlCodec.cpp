@@ -17,16 +17,57 @@
 #include "AmlCodec.h"
 
 #include "Exception.h"
+#include "Trace.h"
 
 #include <sys/ioctl.h>
+#include <poll.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <cstring>
+#include <algorithm>
+
+
+
+// Runtime ioctls are traced so their latency shows up against
+// the element DoWork spans.
+template <typename T>
+static int TracedIoctl(IAmlDevice* device, const char* name, int fd, unsigned long request, T argument)
+{
+	TRACE_BEGIN(name);
+	int result = device->Ioctl(fd, request, (unsigned long)argument);
+	TRACE_END(name);
+
+	return result;
+}
+
+
+
+double AmlCodec::Now()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
 
 
 
 AmlCodec::AmlCodec()
+	: AmlCodec(AmlDevice::Default())
 {
-	int fd = open(CODEC_VIDEO_ES_DEVICE, O_WRONLY);
+}
+
+AmlCodec::AmlCodec(IAmlDeviceSPTR device)
+	: device(device)
+{
+	if (!device)
+		throw ArgumentNullException();
+
+
+	int fd = device->Open(CODEC_VIDEO_ES_DEVICE, O_WRONLY);
 	if (fd < 0)
 	{
 		throw Exception("AmlCodec open failed.");
@@ -36,7 +77,7 @@ AmlCodec::AmlCodec()
 	apiLevel = ApiLevel::S805;
 
 	int version;
-	int r = ioctl(fd, AMSTREAM_IOC_GET_VERSION, &version);
+	int r = device->Ioctl(fd, AMSTREAM_IOC_GET_VERSION, (unsigned long)&version);
 	if (r == 0)
 	{
 		printf("AmlCodec: amstream version : %d.%d\n", (version & 0xffff0000) >> 16, version & 0xffff);
@@ -47,7 +88,7 @@ AmlCodec::AmlCodec()
 		}
 	}
 
-	close(fd);
+	device->Close(fd);
 }
 
 
@@ -68,17 +109,18 @@ void AmlCodec::InternalOpen(VideoFormatEnum format, int width, int height, doubl
 	this->frameRate = frameRate;
 
 
-	// Open codec
-	int flags = O_WRONLY;
+	// Open codec.  Writes do not block so SendCodecData can
+	// wait on the buffer level instead.
+	int flags = O_WRONLY | O_NONBLOCK;
 	switch (format)
 	{
 		case VideoFormatEnum::Hevc:
 			//case VideoFormatEnum::VP9:
-			handle = open(CODEC_VIDEO_ES_HEVC_DEVICE, flags);
+			handle = device->Open(CODEC_VIDEO_ES_HEVC_DEVICE, flags);
 			break;
 
 		default:
-			handle = open(CODEC_VIDEO_ES_DEVICE, flags);
+			handle = device->Open(CODEC_VIDEO_ES_DEVICE, flags);
 			break;
 	}
 
@@ -185,7 +227,7 @@ void AmlCodec::InternalOpen(VideoFormatEnum format, int width, int height, doubl
 		parm.cmd = AMSTREAM_SET_VFORMAT;
 		parm.data_vformat = amlFormat;
 
-		r = ioctl(handle, AMSTREAM_IOC_SET, (unsigned long)&parm);
+		r = device->Ioctl(handle, AMSTREAM_IOC_SET, (unsigned long)&parm);
 		if (r < 0)
 		{
 			codecMutex.Unlock();
@@ -194,7 +236,7 @@ void AmlCodec::InternalOpen(VideoFormatEnum format, int width, int height, doubl
 	}
 	else //S805
 	{
-		r = ioctl(handle, AMSTREAM_IOC_VFORMAT, amlFormat);
+		r = device->Ioctl(handle, AMSTREAM_IOC_VFORMAT, amlFormat);
 		if (r < 0)
 		{
 			codecMutex.Unlock();
@@ -203,7 +245,7 @@ void AmlCodec::InternalOpen(VideoFormatEnum format, int width, int height, doubl
 	}
 
 
-	r = ioctl(handle, AMSTREAM_IOC_SYSINFO, (unsigned long)&am_sysinfo);
+	r = device->Ioctl(handle, AMSTREAM_IOC_SYSINFO, (unsigned long)&am_sysinfo);
 	if (r < 0)
 	{
 		codecMutex.Unlock();
@@ -212,7 +254,7 @@ void AmlCodec::InternalOpen(VideoFormatEnum format, int width, int height, doubl
 
 
 	// Control device
-	cntl_handle = open(CODEC_CNTL_DEVICE, O_RDWR);
+	cntl_handle = device->Open(CODEC_CNTL_DEVICE, O_RDWR);
 	if (cntl_handle < 0)
 	{
 		codecMutex.Unlock();
@@ -235,7 +277,7 @@ void AmlCodec::InternalOpen(VideoFormatEnum format, int width, int height, doubl
 		parm = { 0 };
 		parm.cmd = AMSTREAM_PORT_INIT;
 
-		r = ioctl(handle, AMSTREAM_IOC_SET, (unsigned long)&parm);
+		r = device->Ioctl(handle, AMSTREAM_IOC_SET, (unsigned long)&parm);
 		if (r != 0)
 		{
 			codecMutex.Unlock();
@@ -244,7 +286,7 @@ void AmlCodec::InternalOpen(VideoFormatEnum format, int width, int height, doubl
 	}
 	else	//S805
 	{
-		r = ioctl(handle, AMSTREAM_IOC_PORT_INIT, 0);
+		r = device->Ioctl(handle, AMSTREAM_IOC_PORT_INIT, 0);
 		if (r != 0)
 		{
 			codecMutex.Unlock();
@@ -254,7 +296,7 @@ void AmlCodec::InternalOpen(VideoFormatEnum format, int width, int height, doubl
 
 
 	//codec_h_control(pcodec->cntl_handle, AMSTREAM_IOC_SYNCENABLE, (unsigned long)enable);
-	r = ioctl(cntl_handle, AMSTREAM_IOC_SYNCENABLE, (unsigned long)1);
+	r = device->Ioctl(cntl_handle, AMSTREAM_IOC_SYNCENABLE, (unsigned long)1);
 	if (r != 0)
 	{
 		codecMutex.Unlock();
@@ -297,14 +339,14 @@ void AmlCodec::InternalClose()
 {
 	int r;
 
-	r = ioctl(cntl_handle, AMSTREAM_IOC_CLEAR_VIDEO, 0);
+	r = device->Ioctl(cntl_handle, AMSTREAM_IOC_CLEAR_VIDEO, 0);
 	if (r < 0)
 	{
 		codecMutex.Unlock();
 		throw Exception("AMSTREAM_IOC_CLEAR_VIDEO failed.");
 	}
 
-	r = close(cntl_handle);
+	r = device->Close(cntl_handle);
 	if (r < 0)
 	{
 		codecMutex.Unlock();
@@ -312,7 +354,7 @@ void AmlCodec::InternalClose()
 	}
 
 
-	r = close(handle);
+	r = device->Close(handle);
 	if (r < 0)
 	{
 		codecMutex.Unlock();
@@ -426,7 +468,7 @@ double AmlCodec::GetCurrentPts()
 		parm.cmd = AMSTREAM_GET_VPTS;
 		//parm.data_32 = &vpts;
 
-		ret = ioctl(handle, AMSTREAM_IOC_GET, (unsigned long)&parm);
+		ret = TracedIoctl(device.get(), "AMSTREAM_IOC_GET", handle, AMSTREAM_IOC_GET, (unsigned long)&parm);
 		if (ret < 0)
 		{
 			codecMutex.Unlock();
@@ -441,7 +483,7 @@ double AmlCodec::GetCurrentPts()
 	}
 	else	// S805
 	{
-		ret = ioctl(handle, AMSTREAM_IOC_VPTS, (unsigned long)&vpts);
+		ret = TracedIoctl(device.get(), "AMSTREAM_IOC_VPTS", handle, AMSTREAM_IOC_VPTS, (unsigned long)&vpts);
 		if (ret < 0)
 		{
 			codecMutex.Unlock();
@@ -454,6 +496,49 @@ double AmlCodec::GetCurrentPts()
 	return vpts / (double)PTS_FREQ;
 }
 
+double AmlCodec::GetCurrentPcr()
+{
+	codecMutex.Lock();
+
+	if (!isOpen)
+	{
+		codecMutex.Unlock();
+		throw InvalidOperationException("The codec is not open.");
+	}
+
+
+	unsigned int pcr;
+	int ret;
+	if (apiLevel >= ApiLevel::S905)	// S905
+	{
+		am_ioctl_parm parm = { 0 };
+
+		parm.cmd = AMSTREAM_GET_PCRSCR;
+
+		ret = TracedIoctl(device.get(), "AMSTREAM_IOC_GET", handle, AMSTREAM_IOC_GET, (unsigned long)&parm);
+		if (ret < 0)
+		{
+			codecMutex.Unlock();
+			throw Exception("AMSTREAM_GET_PCRSCR failed.");
+		}
+
+		pcr = parm.data_32;
+	}
+	else	// S805
+	{
+		ret = TracedIoctl(device.get(), "AMSTREAM_IOC_PCRSCR", handle, AMSTREAM_IOC_PCRSCR, (unsigned long)&pcr);
+		if (ret < 0)
+		{
+			codecMutex.Unlock();
+			throw Exception("AMSTREAM_IOC_PCRSCR failed.");
+		}
+	}
+
+	codecMutex.Unlock();
+
+	return pcr / (double)PTS_FREQ;
+}
+
 void AmlCodec::SetCurrentPts(double value)
 {
 	codecMutex.Lock();
@@ -484,7 +569,7 @@ void AmlCodec::SetCurrentPts(double value)
 		parm.data_32 = (unsigned int)(pts);
 		//parm.data_64 = (unsigned long)(value * PTS_FREQ);
 
-		int ret = ioctl(handle, AMSTREAM_IOC_SET, (unsigned long)&parm);
+		int ret = TracedIoctl(device.get(), "AMSTREAM_IOC_SET", handle, AMSTREAM_IOC_SET, (unsigned long)&parm);
 		if (ret < 0)
 		{
 			codecMutex.Unlock();
@@ -497,7 +582,7 @@ void AmlCodec::SetCurrentPts(double value)
 	}
 	else	// S805
 	{
-		int ret = ioctl(handle, AMSTREAM_IOC_SET_PCRSCR, pts);
+		int ret = TracedIoctl(device.get(), "AMSTREAM_IOC_SET_PCRSCR", handle, AMSTREAM_IOC_SET_PCRSCR, pts);
 		if (ret < 0)
 		{
 			codecMutex.Unlock();
@@ -520,7 +605,7 @@ void AmlCodec::Pause()
 
 	
 	//codec_pause(&codec);
-	int ret = ioctl(cntl_handle, AMSTREAM_IOC_VPAUSE, 1);
+	int ret = TracedIoctl(device.get(), "AMSTREAM_IOC_VPAUSE", cntl_handle, AMSTREAM_IOC_VPAUSE, 1);
 	if (ret < 0)
 	{
 		codecMutex.Unlock();
@@ -542,7 +627,7 @@ void AmlCodec::Resume()
 
 	
 	//codec_resume(&codec);
-	int ret = ioctl(cntl_handle, AMSTREAM_IOC_VPAUSE, 0);
+	int ret = TracedIoctl(device.get(), "AMSTREAM_IOC_VPAUSE", cntl_handle, AMSTREAM_IOC_VPAUSE, 0);
 	if (ret < 0)
 	{
 		codecMutex.Unlock();
@@ -569,7 +654,7 @@ buf_status AmlCodec::GetBufferStatus()
 		am_ioctl_parm_ex parm = { 0 };
 		parm.cmd = AMSTREAM_GET_EX_VB_STATUS;
 		
-		int r = ioctl(handle, AMSTREAM_IOC_GET_EX, (unsigned long)&parm);
+		int r = TracedIoctl(device.get(), "AMSTREAM_IOC_GET_EX", handle, AMSTREAM_IOC_GET_EX, (unsigned long)&parm);
 
 		codecMutex.Unlock();
 
@@ -584,7 +669,7 @@ buf_status AmlCodec::GetBufferStatus()
 	{
 		am_io_param am_io;
 
-		int r = ioctl(handle, AMSTREAM_IOC_VB_STATUS, (unsigned long)&am_io);
+		int r = TracedIoctl(device.get(), "AMSTREAM_IOC_VB_STATUS", handle, AMSTREAM_IOC_VB_STATUS, (unsigned long)&am_io);
 
 		codecMutex.Unlock();
 
@@ -614,7 +699,7 @@ vdec_status AmlCodec::GetVdecStatus()
 	am_ioctl_parm_ex parm = { 0 };
 	parm.cmd = AMSTREAM_GET_EX_VDECSTAT;
 
-	int r = ioctl(handle, AMSTREAM_IOC_GET_EX, (unsigned long)&parm);
+	int r = TracedIoctl(device.get(), "AMSTREAM_IOC_GET_EX", handle, AMSTREAM_IOC_GET_EX, (unsigned long)&parm);
 
 	codecMutex.Unlock();
 
@@ -741,7 +826,7 @@ void AmlCodec::SetVideoAxis(Int32Rectangle rectangle)
 		rectangle.X + rectangle.Width,
 		rectangle.Y + rectangle.Height };
 
-	int ret = ioctl(cntl_handle, AMSTREAM_IOC_SET_VIDEO_AXIS, &params);
+	int ret = TracedIoctl(device.get(), "AMSTREAM_IOC_SET_VIDEO_AXIS", cntl_handle, AMSTREAM_IOC_SET_VIDEO_AXIS, &params);
 
 	codecMutex.Unlock();
 
@@ -763,7 +848,7 @@ Int32Rectangle AmlCodec::GetVideoAxis()
 
 	int params[4] = { 0 };
 
-	int ret = ioctl(cntl_handle, AMSTREAM_IOC_GET_VIDEO_AXIS, &params);
+	int ret = TracedIoctl(device.get(), "AMSTREAM_IOC_GET_VIDEO_AXIS", cntl_handle, AMSTREAM_IOC_GET_VIDEO_AXIS, &params);
 
 	codecMutex.Unlock();
 
@@ -792,7 +877,7 @@ void AmlCodec::SetSyncThreshold(unsigned long pts)
 	}
 
 	//return codec_h_control(pcodec->cntl_handle, AMSTREAM_IOC_SYNCTHRESH, (unsigned long)syncthresh);
-	int ret = ioctl(cntl_handle, AMSTREAM_IOC_SYNCTHRESH, pts);
+	int ret = TracedIoctl(device.get(), "AMSTREAM_IOC_SYNCTHRESH", cntl_handle, AMSTREAM_IOC_SYNCTHRESH, pts);
 
 	codecMutex.Unlock();
 
@@ -825,7 +910,7 @@ void AmlCodec::CheckinPts(unsigned long pts)
 		parm.cmd = AMSTREAM_SET_TSTAMP;
 		parm.data_32 = (unsigned int)pts;
 
-		int r = ioctl(handle, AMSTREAM_IOC_SET, (unsigned long)&parm);
+		int r = TracedIoctl(device.get(), "AMSTREAM_IOC_SET", handle, AMSTREAM_IOC_SET, (unsigned long)&parm);
 		if (r < 0)
 		{
 			codecMutex.Unlock();
@@ -834,7 +919,7 @@ void AmlCodec::CheckinPts(unsigned long pts)
 	}
 	else	// S805
 	{
-		int r = ioctl(handle, AMSTREAM_IOC_TSTAMP, pts);
+		int r = TracedIoctl(device.get(), "AMSTREAM_IOC_TSTAMP", handle, AMSTREAM_IOC_TSTAMP, pts);
 		if (r < 0)
 		{
 			codecMutex.Unlock();
@@ -855,5 +940,117 @@ int AmlCodec::WriteData(unsigned char* data, int length)
 
 
 	// This is done unlocked because it blocks	
-	return write(handle, data, length);
-}
\ No newline at end of file
+	TRACE_BEGIN("AmlCodec::WriteData");
+	int result = device->Write(handle, data, length);
+	TRACE_END("AmlCodec::WriteData");
+
+	return result;
+}
+
+int AmlCodec::WriteData(const iovec* vectors, int count)
+{
+	if (vectors == nullptr)
+		throw ArgumentNullException("vectors");
+
+	if (count < 1)
+		throw ArgumentOutOfRangeException("count");
+
+
+	// This is done unlocked because it blocks
+	TRACE_BEGIN("AmlCodec::WriteData");
+
+	int result = -1;
+	if (count == 1)
+	{
+		result = device->Write(handle, vectors[0].iov_base, vectors[0].iov_len);
+	}
+	else
+	{
+		if (isWritevSupported && count <= IOV_MAX)
+		{
+			result = device->Writev(handle, vectors, count);
+			if (result < 0 && errno == ENOSYS)
+			{
+				printf("AmlCodec: writev is not supported, staging writes instead.\n");
+				isWritevSupported = false;
+			}
+		}
+
+		if (!isWritevSupported || count > IOV_MAX)
+		{
+			size_t length = 0;
+			for (int i = 0; i < count; ++i)
+			{
+				length += vectors[i].iov_len;
+			}
+
+			stagingBuffer.resize(length);
+
+			size_t offset = 0;
+			for (int i = 0; i < count; ++i)
+			{
+				memcpy(&stagingBuffer[offset], vectors[i].iov_base, vectors[i].iov_len);
+				offset += vectors[i].iov_len;
+			}
+
+			result = device->Write(handle, stagingBuffer.data(), length);
+		}
+	}
+
+	TRACE_END("AmlCodec::WriteData");
+
+	return result;
+}
+
+// poll() waits for the driver to have any space; above the
+// watermark the wait continues with a sleep that doubles up to
+// a frame period.
+bool AmlCodec::WaitForBuffer(double highWatermark, double timeoutSeconds)
+{
+	if (highWatermark <= 0 || highWatermark > 1)
+		throw ArgumentOutOfRangeException("highWatermark");
+
+	if (!isOpen)
+		throw InvalidOperationException("The codec is not open.");
+
+
+	const int MIN_SLEEP_MICROSECONDS = 1000;
+	int maxSleepMicroseconds = (frameRate > 0) ? (int)(1000000 / frameRate) : 20000;
+	int sleepMicroseconds = MIN_SLEEP_MICROSECONDS;
+
+	double deadline = Now() + timeoutSeconds;
+
+	while (true)
+	{
+		double remaining = deadline - Now();
+
+		if (isPollSupported)
+		{
+			TRACE_BEGIN("AmlCodec::Poll");
+			int result = device->Poll(handle, POLLOUT, (remaining > 0) ? (int)(remaining * 1000) : 0);
+			TRACE_END("AmlCodec::Poll");
+
+			if (result < 0 && errno != EINTR)
+			{
+				printf("AmlCodec: poll failed (errno=%d), sleeping instead.\n", errno);
+				isPollSupported = false;
+			}
+		}
+
+		buf_status status = GetBufferStatus();
+		if (status.size <= 0 ||
+			status.data_len < highWatermark * status.size)
+		{
+			return true;
+		}
+
+		remaining = deadline - Now();
+		if (remaining <= 0)
+		{
+			return false;
+		}
+
+		usleep(std::min(sleepMicroseconds, (int)(remaining * 1000000) + 1));
+		sleepMicroseconds = std::min(sleepMicroseconds * 2, std::max(maxSleepMicroseconds, MIN_SLEEP_MICROSECONDS));
+	}
+}
@@ -22,10 +22,14 @@
 //#include <codec.h>
 //}
 
+#include "AmlDevice.h"
 #include "Mutex.h"
 #include "Pin.h"
 #include "Rectangle.h"
 
+#include <vector>
+#include <sys/uio.h>
+
 
 // codec_type.h
 typedef struct {
@@ -200,6 +204,7 @@ struct am_ioctl_parm_ex {
 #define AMSTREAM_PORT_INIT 0x111
 #define AMSTREAM_SET_PCRSCR 0x118
 #define AMSTREAM_GET_VPTS 0x805
+#define AMSTREAM_GET_PCRSCR 0x806
 
 #define AMSTREAM_GET_EX_VB_STATUS 0x900
 #define AMSTREAM_GET_EX_VDECSTAT 0x902
@@ -212,6 +217,7 @@ struct am_ioctl_parm_ex {
 #define AMSTREAM_IOC_PORT_INIT _IO(AMSTREAM_IOC_MAGIC, 0x11)
 #define AMSTREAM_IOC_TSTAMP _IOW(AMSTREAM_IOC_MAGIC, 0x0e, unsigned long)
 #define AMSTREAM_IOC_VPTS _IOR(AMSTREAM_IOC_MAGIC, 0x41, unsigned long)
+#define AMSTREAM_IOC_PCRSCR _IOR(AMSTREAM_IOC_MAGIC, 0x42, unsigned long)
 #define AMSTREAM_IOC_SET_PCRSCR _IOW(AMSTREAM_IOC_MAGIC, 0x4a, unsigned long)
 #define AMSTREAM_IOC_VB_STATUS _IOR(AMSTREAM_IOC_MAGIC, 0x08, unsigned long)
 
@@ -259,6 +265,7 @@ class AmlCodec
 
 
 	//codec_para_t codec = { 0 };
+	IAmlDeviceSPTR device;
 	bool isOpen = false;
 	Mutex codecMutex;
 	CODEC_HANDLE handle;
@@ -268,10 +275,14 @@ class AmlCodec
 	int height;
 	double frameRate;
 	ApiLevel apiLevel;
+	bool isWritevSupported = true;
+	std::vector<unsigned char> stagingBuffer;	// used by WriteData when writev is not
+	bool isPollSupported = true;
 
 
 	void InternalOpen(VideoFormatEnum format, int width, int height, double frameRate);
 	void InternalClose();
+	static double Now();
 
 public:
 
@@ -283,6 +294,7 @@ public:
 
 
 	AmlCodec();
+	AmlCodec(IAmlDeviceSPTR device);
 	virtual ~AmlCodec() { }
 
 
@@ -292,6 +304,7 @@ public:
 	void Reset();
 	double GetCurrentPts();
 	void SetCurrentPts(double value);
+	double GetCurrentPcr();		// the video system clock SetCurrentPts sets
 	void Pause();
 	void Resume();
 	buf_status GetBufferStatus();
@@ -302,4 +315,13 @@ public:
 	void SetSyncThreshold(unsigned long pts);
 	void CheckinPts(unsigned long pts);
 	int WriteData(unsigned char* data, int length);
+
+	// Submits the vectors with one writev.  Like writev, the
+	// result may be short; the caller resubmits the remainder.
+	// The ES device is non-blocking: a full buffer fails with EAGAIN.
+	int WriteData(const iovec* vectors, int count);
+
+	// Waits for the ES buffer to drain below 'highWatermark', a
+	// fraction of its size.  Returns false on timeout.
+	bool WaitForBuffer(double highWatermark, double timeoutSeconds);
 };
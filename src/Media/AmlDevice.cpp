@@ -0,0 +1,82 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#include "AmlDevice.h"
+
+#include "Exception.h"
+
+#include <sys/ioctl.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+
+IAmlDeviceSPTR AmlDevice::current = std::make_shared<AmlKernelDevice>();
+
+
+
+int AmlKernelDevice::Open(const char* path, int flags)
+{
+	return open(path, flags);
+}
+
+int AmlKernelDevice::Close(int fd)
+{
+	return close(fd);
+}
+
+int AmlKernelDevice::Ioctl(int fd, unsigned long request, unsigned long argument)
+{
+	return ioctl(fd, request, argument);
+}
+
+int AmlKernelDevice::Write(int fd, const void* data, size_t length)
+{
+	return write(fd, data, length);
+}
+
+int AmlKernelDevice::Writev(int fd, const iovec* vectors, int count)
+{
+	return writev(fd, vectors, count);
+}
+
+int AmlKernelDevice::Poll(int fd, short events, int timeoutMilliseconds)
+{
+	pollfd descriptor;
+	descriptor.fd = fd;
+	descriptor.events = events;
+	descriptor.revents = 0;
+
+	int result = poll(&descriptor, 1, timeoutMilliseconds);
+
+	return (result > 0) ? descriptor.revents : result;
+}
+
+
+
+IAmlDeviceSPTR AmlDevice::Default()
+{
+	return current;
+}
+
+void AmlDevice::SetDefault(IAmlDeviceSPTR value)
+{
+	if (!value)
+		throw ArgumentNullException();
+
+	current = value;
+}
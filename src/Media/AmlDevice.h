@@ -0,0 +1,72 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#pragma once
+
+#include <memory>
+#include <cstddef>
+#include <sys/uio.h>
+
+
+
+// The device nodes behind AmlCodec.  Calls follow open(2), close(2),
+// ioctl(2), write(2) and writev(2): -1 and errno on failure.  A
+// device without scatter-gather support fails Writev with ENOSYS.
+// Poll is poll(2) on one descriptor and returns its revents.
+class IAmlDevice
+{
+public:
+	virtual ~IAmlDevice() {}
+
+
+	virtual int Open(const char* path, int flags) = 0;
+	virtual int Close(int fd) = 0;
+	virtual int Ioctl(int fd, unsigned long request, unsigned long argument) = 0;
+	virtual int Write(int fd, const void* data, size_t length) = 0;
+	virtual int Writev(int fd, const iovec* vectors, int count) = 0;
+	virtual int Poll(int fd, short events, int timeoutMilliseconds) = 0;
+};
+
+typedef std::shared_ptr<IAmlDevice> IAmlDeviceSPTR;
+
+
+
+// The amstream and amvideo kernel drivers
+class AmlKernelDevice : public IAmlDevice
+{
+public:
+
+	virtual int Open(const char* path, int flags) override;
+	virtual int Close(int fd) override;
+	virtual int Ioctl(int fd, unsigned long request, unsigned long argument) override;
+	virtual int Write(int fd, const void* data, size_t length) override;
+	virtual int Writev(int fd, const iovec* vectors, int count) override;
+	virtual int Poll(int fd, short events, int timeoutMilliseconds) override;
+};
+
+
+
+// The device used by AmlCodec instances created afterwards
+class AmlDevice
+{
+	static IAmlDeviceSPTR current;
+
+
+public:
+
+	static IAmlDeviceSPTR Default();
+	static void SetDefault(IAmlDeviceSPTR value);
+};
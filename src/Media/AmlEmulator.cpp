@@ -0,0 +1,671 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#include "AmlEmulator.h"
+
+#include "Exception.h"
+
+#include <sys/ioctl.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <cstring>
+
+
+
+double AmlEmulatorDevice::Now() const
+{
+	double now;
+
+	if (clock)
+	{
+		now = clock->Now();
+	}
+	else
+	{
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+
+		now = ts.tv_sec + ts.tv_nsec / 1000000000.0;
+	}
+
+	return (now - origin) * speed;
+}
+
+
+void AmlEmulatorDevice::ResetStream()
+{
+	writeOffset = 0;
+	readOffset = 0;
+	checkins.clear();
+	vpts = 0;
+	isPcrSet = false;
+	frameRate = 0;
+	lastFrameTime = Now();
+
+	pthread_cond_broadcast(&spaceAvailable);
+}
+
+// Waits for the modelled decoder to free buffer space.  A negative
+// timeout (real seconds) waits until there is space or the device
+// is closed.  Returns true if there is space.
+bool AmlEmulatorDevice::WaitForSpace(double timeoutSeconds)
+{
+	timespec limit;
+	clock_gettime(CLOCK_MONOTONIC, &limit);
+
+	if (timeoutSeconds > 0)
+	{
+		long long nsec = limit.tv_nsec + (long long)(timeoutSeconds * 1e9);
+		limit.tv_sec += nsec / 1000000000LL;
+		limit.tv_nsec = nsec % 1000000000LL;
+	}
+
+
+	while (isEsOpen && writeOffset - readOffset >= (uint64_t)bufferSize)
+	{
+		if (timeoutSeconds == 0)
+			break;
+
+		// Sleep until the next frame is due
+		double wait = 0.01;
+		if (frameRate > 0 && !isPaused)
+		{
+			wait = (lastFrameTime + 1.0 / frameRate - Now()) / speed;
+			if (wait < 0.001)
+			{
+				wait = 0.001;
+			}
+		}
+
+		timespec deadline;
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+		long long nsec = deadline.tv_nsec + (long long)(wait * 1e9);
+		deadline.tv_sec += nsec / 1000000000LL;
+		deadline.tv_nsec = nsec % 1000000000LL;
+
+		if (timeoutSeconds > 0)
+		{
+			if (deadline.tv_sec > limit.tv_sec ||
+				(deadline.tv_sec == limit.tv_sec && deadline.tv_nsec >= limit.tv_nsec))
+			{
+				pthread_cond_timedwait(&spaceAvailable, &mutex, &limit);
+				Decode(Now());
+				break;
+			}
+		}
+
+		pthread_cond_timedwait(&spaceAvailable, &mutex, &deadline);
+
+		Decode(Now());
+	}
+
+	return isEsOpen && writeOffset - readOffset < (uint64_t)bufferSize;
+}
+
+// Runs the modelled decoder up to 'now'
+void AmlEmulatorDevice::Decode(double now)
+{
+	if (!isEsOpen || frameRate <= 0 || isPaused)
+	{
+		lastFrameTime = now;
+		return;
+	}
+
+
+	double period = 1.0 / frameRate;
+
+	while (now - lastFrameTime >= period)
+	{
+		if (readOffset == writeOffset)
+		{
+			// The decoder idles until data arrives
+			++stats.Underruns;
+			lastFrameTime = now;
+			break;
+		}
+
+
+		unsigned int pts = vpts;
+		if (checkins.size() > 0)
+		{
+			const Checkin& front = checkins.front();
+
+			if (isPcrSet && isSyncEnabled &&
+				front.Pts > Pcr(now) + syncThreshold)
+			{
+				// Early; shown once the PCR catches up
+				lastFrameTime = now - period;
+				break;
+			}
+
+			pts = front.Pts;
+			checkins.pop_front();
+		}
+
+		// A frame runs up to the next timestamp.  Without one the
+		// rest of the buffer is taken so the stream can drain.
+		readOffset = (checkins.size() > 0) ? checkins.front().Offset : writeOffset;
+		vpts = pts;
+
+		++stats.FramesDecoded;
+		lastFrameTime += period;
+	}
+
+	pthread_cond_broadcast(&spaceAvailable);
+}
+
+unsigned int AmlEmulatorDevice::Pcr(double now) const
+{
+	return pcrBase + (unsigned int)((now - pcrTime) * PTS_FREQ);
+}
+
+buf_status AmlEmulatorDevice::BufferStatus() const
+{
+	buf_status result;
+
+	result.size = bufferSize;
+	result.data_len = (int)(writeOffset - readOffset);
+	result.free_len = bufferSize - result.data_len;
+	result.read_pointer = (unsigned int)(readOffset % bufferSize);
+	result.write_pointer = (unsigned int)(writeOffset % bufferSize);
+
+	return result;
+}
+
+int AmlEmulatorDevice::SetCommand(unsigned int cmd, unsigned int value)
+{
+	switch (cmd)
+	{
+		case AMSTREAM_SET_VFORMAT:
+			videoFormat = (int)value;
+			break;
+
+		case AMSTREAM_SET_TSTAMP:
+		{
+			// Applies to the data written next
+			Checkin checkin;
+			checkin.Offset = writeOffset;
+			checkin.Pts = value;
+
+			checkins.push_back(checkin);
+			break;
+		}
+
+		case AMSTREAM_PORT_INIT:
+			break;
+
+		case AMSTREAM_SET_PCRSCR:
+			pcrBase = value;
+			pcrTime = Now();
+			isPcrSet = true;
+			break;
+
+		default:
+			errno = EINVAL;
+			return -1;
+	}
+
+	return 0;
+}
+
+int AmlEmulatorDevice::EsIoctl(unsigned long request, unsigned long argument)
+{
+	Decode(Now());
+
+
+	if (request == AMSTREAM_IOC_GET_VERSION)
+	{
+		*(int*)argument = (int)version;
+	}
+	else if (request == AMSTREAM_IOC_SYSINFO)
+	{
+		// AmlCodec passes 96000 / frameRate + 1
+		dec_sysinfo_t* sysinfo = (dec_sysinfo_t*)argument;
+		if (sysinfo->rate > 1)
+		{
+			frameRate = 96000.0 / (sysinfo->rate - 1);
+		}
+	}
+	else if (request == AMSTREAM_IOC_SET)
+	{
+		am_ioctl_parm* parm = (am_ioctl_parm*)argument;
+		return SetCommand(parm->cmd, parm->data_32);
+	}
+	else if (request == AMSTREAM_IOC_GET)
+	{
+		am_ioctl_parm* parm = (am_ioctl_parm*)argument;
+		switch (parm->cmd)
+		{
+			case AMSTREAM_GET_VPTS:
+				parm->data_32 = vpts;
+				break;
+
+			case AMSTREAM_GET_PCRSCR:
+				parm->data_32 = isPcrSet ? Pcr(Now()) : vpts;
+				break;
+
+			default:
+				errno = EINVAL;
+				return -1;
+		}
+	}
+	else if (request == AMSTREAM_IOC_GET_EX)
+	{
+		am_ioctl_parm_ex* parm = (am_ioctl_parm_ex*)argument;
+		switch (parm->cmd)
+		{
+			case AMSTREAM_GET_EX_VB_STATUS:
+				parm->status = BufferStatus();
+				break;
+
+			case AMSTREAM_GET_EX_VDECSTAT:
+				memset(&parm->vstatus, 0, sizeof(parm->vstatus));
+				parm->vstatus.fps = (unsigned int)frameRate;
+				break;
+
+			default:
+				errno = EINVAL;
+				return -1;
+		}
+	}
+	else if (request == AMSTREAM_IOC_VFORMAT)		// S805
+	{
+		return SetCommand(AMSTREAM_SET_VFORMAT, (unsigned int)argument);
+	}
+	else if (request == AMSTREAM_IOC_PORT_INIT)
+	{
+		return SetCommand(AMSTREAM_PORT_INIT, 0);
+	}
+	else if (request == AMSTREAM_IOC_TSTAMP)
+	{
+		return SetCommand(AMSTREAM_SET_TSTAMP, (unsigned int)argument);
+	}
+	else if (request == AMSTREAM_IOC_SET_PCRSCR)
+	{
+		return SetCommand(AMSTREAM_SET_PCRSCR, (unsigned int)argument);
+	}
+	else if (request == AMSTREAM_IOC_VPTS)
+	{
+		*(unsigned int*)argument = vpts;
+	}
+	else if (request == AMSTREAM_IOC_PCRSCR)
+	{
+		*(unsigned int*)argument = isPcrSet ? Pcr(Now()) : vpts;
+	}
+	else if (request == AMSTREAM_IOC_VB_STATUS)
+	{
+		am_io_param* am_io = (am_io_param*)argument;
+		am_io->status = BufferStatus();
+	}
+	else
+	{
+		printf("AmlEmulatorDevice: unsupported ioctl 0x%lx.\n", request);
+
+		errno = ENOTTY;
+		return -1;
+	}
+
+	return 0;
+}
+
+int AmlEmulatorDevice::CntlIoctl(unsigned long request, unsigned long argument)
+{
+	if (request == AMSTREAM_IOC_VPAUSE)
+	{
+		// Settle the decoder at the old rate first
+		Decode(Now());
+
+		isPaused = (argument != 0);
+		lastFrameTime = Now();
+
+		pthread_cond_broadcast(&spaceAvailable);
+	}
+	else if (request == AMSTREAM_IOC_SYNCENABLE)
+	{
+		isSyncEnabled = (argument != 0);
+	}
+	else if (request == AMSTREAM_IOC_SYNCTHRESH)
+	{
+		syncThreshold = (unsigned int)argument;
+	}
+	else if (request == AMSTREAM_IOC_CLEAR_VIDEO)
+	{
+	}
+	else if (request == AMSTREAM_IOC_SET_VIDEO_AXIS)
+	{
+		memcpy(axis, (int*)argument, sizeof(axis));
+	}
+	else if (request == AMSTREAM_IOC_GET_VIDEO_AXIS)
+	{
+		memcpy((int*)argument, axis, sizeof(axis));
+	}
+	else
+	{
+		printf("AmlEmulatorDevice: unsupported control ioctl 0x%lx.\n", request);
+
+		errno = ENOTTY;
+		return -1;
+	}
+
+	return 0;
+}
+
+
+
+AmlEmulatorDevice::AmlEmulatorDevice(const char* logPath, double speed, int bufferSize, unsigned int version)
+	: speed(speed), bufferSize(bufferSize), version(version)
+{
+	if (speed <= 0)
+		throw ArgumentOutOfRangeException("speed");
+
+	if (bufferSize < 1)
+		throw ArgumentOutOfRangeException("bufferSize");
+
+
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	origin = ts.tv_sec + ts.tv_nsec / 1000000000.0;
+
+
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+	if (pthread_cond_init(&spaceAvailable, &attr) != 0)
+	{
+		pthread_condattr_destroy(&attr);
+		throw Exception("AmlEmulatorDevice: pthread_cond_init failed.");
+	}
+
+	pthread_condattr_destroy(&attr);
+
+
+	if (logPath)
+	{
+		logFile = fopen(logPath, "wb");
+		if (!logFile)
+		{
+			pthread_cond_destroy(&spaceAvailable);
+			throw Exception("AmlEmulatorDevice: could not open the stream log.");
+		}
+	}
+}
+
+AmlEmulatorDevice::~AmlEmulatorDevice()
+{
+	if (logFile)
+	{
+		fclose(logFile);
+	}
+
+	pthread_cond_destroy(&spaceAvailable);
+}
+
+
+void AmlEmulatorDevice::SetClock(IMediaClockSPTR value)
+{
+	if (!value)
+		throw ArgumentNullException();
+
+	pthread_mutex_lock(&mutex);
+
+	if (isEsOpen)
+	{
+		pthread_mutex_unlock(&mutex);
+		throw InvalidOperationException("AmlEmulatorDevice: the clock must be set before the device is opened.");
+	}
+
+	clock = value;
+	origin = clock->Now();
+
+	pthread_mutex_unlock(&mutex);
+}
+
+
+int AmlEmulatorDevice::Open(const char* path, int flags)
+{
+	if (!path)
+		throw ArgumentNullException();
+
+
+	int result;
+
+	pthread_mutex_lock(&mutex);
+
+	if (strstr(path, "amstream_vbuf") || strstr(path, "amstream_hevc"))
+	{
+		if (isEsOpen)
+		{
+			errno = EBUSY;
+			result = -1;
+		}
+		else
+		{
+			isEsOpen = true;
+			isNonBlocking = (flags & O_NONBLOCK) != 0;
+			ResetStream();
+
+			result = ES_HANDLE;
+		}
+	}
+	else if (strstr(path, "amvideo"))
+	{
+		isCntlOpen = true;
+		result = CNTL_HANDLE;
+	}
+	else
+	{
+		errno = ENOENT;
+		result = -1;
+	}
+
+	pthread_mutex_unlock(&mutex);
+
+	return result;
+}
+
+int AmlEmulatorDevice::Close(int fd)
+{
+	int result = 0;
+
+	pthread_mutex_lock(&mutex);
+
+	if (fd == ES_HANDLE && isEsOpen)
+	{
+		// Wakes a blocked Write, which then fails
+		isEsOpen = false;
+		ResetStream();
+	}
+	else if (fd == CNTL_HANDLE && isCntlOpen)
+	{
+		isCntlOpen = false;
+	}
+	else
+	{
+		errno = EBADF;
+		result = -1;
+	}
+
+	pthread_mutex_unlock(&mutex);
+
+	return result;
+}
+
+int AmlEmulatorDevice::Ioctl(int fd, unsigned long request, unsigned long argument)
+{
+	int result;
+
+	pthread_mutex_lock(&mutex);
+
+	++stats.Ioctls;
+
+	if (fd == ES_HANDLE && isEsOpen)
+	{
+		result = EsIoctl(request, argument);
+	}
+	else if (fd == CNTL_HANDLE && isCntlOpen)
+	{
+		result = CntlIoctl(request, argument);
+	}
+	else
+	{
+		errno = EBADF;
+		result = -1;
+	}
+
+	pthread_mutex_unlock(&mutex);
+
+	return result;
+}
+
+int AmlEmulatorDevice::Write(int fd, const void* data, size_t length)
+{
+	iovec vector;
+	vector.iov_base = (void*)data;
+	vector.iov_len = length;
+
+	return Writev(fd, &vector, 1);
+}
+
+// Like the driver, a write takes as much as fits and is counted once
+int AmlEmulatorDevice::Writev(int fd, const iovec* vectors, int count)
+{
+	if (vectors == nullptr || count < 1)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	size_t length = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		length += vectors[i].iov_len;
+	}
+
+
+	pthread_mutex_lock(&mutex);
+
+	if (fd != ES_HANDLE || !isEsOpen)
+	{
+		pthread_mutex_unlock(&mutex);
+
+		errno = EBADF;
+		return -1;
+	}
+
+
+	++stats.Writes;
+
+	double start = Now();
+	Decode(start);
+
+	if (writeOffset - readOffset >= (uint64_t)bufferSize)
+	{
+		if (isNonBlocking)
+		{
+			++stats.FullWrites;
+			pthread_mutex_unlock(&mutex);
+
+			errno = EAGAIN;
+			return -1;
+		}
+
+		WaitForSpace(-1);
+
+		++stats.BlockedWrites;
+		stats.BlockedSeconds += (Now() - start) / speed;
+	}
+
+	if (!isEsOpen)
+	{
+		pthread_mutex_unlock(&mutex);
+
+		errno = EBADF;
+		return -1;
+	}
+
+
+	size_t freeLength = bufferSize - (size_t)(writeOffset - readOffset);
+	size_t accepted = (length < freeLength) ? length : freeLength;
+
+	writeOffset += accepted;
+	stats.BytesWritten += accepted;
+
+	if (logFile)
+	{
+		size_t remaining = accepted;
+		for (int i = 0; i < count && remaining > 0; ++i)
+		{
+			size_t segment = (vectors[i].iov_len < remaining) ? vectors[i].iov_len : remaining;
+			fwrite(vectors[i].iov_base, 1, segment, logFile);
+
+			remaining -= segment;
+		}
+	}
+
+	pthread_mutex_unlock(&mutex);
+
+	return (int)accepted;
+}
+
+
+// Only POLLOUT is reported
+int AmlEmulatorDevice::Poll(int fd, short events, int timeoutMilliseconds)
+{
+	pthread_mutex_lock(&mutex);
+
+	if (fd != ES_HANDLE || !isEsOpen)
+	{
+		pthread_mutex_unlock(&mutex);
+
+		errno = EBADF;
+		return -1;
+	}
+
+
+	++stats.Polls;
+
+	Decode(Now());
+
+	int result = 0;
+	if ((events & POLLOUT) &&
+		WaitForSpace(timeoutMilliseconds < 0 ? -1 : timeoutMilliseconds / 1000.0))
+	{
+		result = POLLOUT;
+	}
+
+	if (!isEsOpen)
+	{
+		result = POLLNVAL;
+	}
+
+	pthread_mutex_unlock(&mutex);
+
+	return result;
+}
+
+
+AmlEmulatorStats AmlEmulatorDevice::Stats()
+{
+	pthread_mutex_lock(&mutex);
+	AmlEmulatorStats result = stats;
+	pthread_mutex_unlock(&mutex);
+
+	return result;
+}
@@ -0,0 +1,147 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#pragma once
+
+#include "AmlDevice.h"
+#include "AmlCodec.h"
+#include "MediaClock.h"
+
+#include <pthread.h>
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <stdint.h>
+
+
+
+struct AmlEmulatorStats
+{
+	unsigned long Writes = 0;
+	unsigned long BlockedWrites = 0;	// writes that waited for buffer space
+	double BlockedSeconds = 0;
+	unsigned long long BytesWritten = 0;
+	unsigned long Ioctls = 0;
+	unsigned long FramesDecoded = 0;
+	unsigned long Underruns = 0;		// frames due while the buffer was empty
+	unsigned long FullWrites = 0;		// non-blocking writes failed with EAGAIN
+	unsigned long Polls = 0;
+};
+
+
+// Software stand-in for /dev/amstream_vbuf, /dev/amstream_hevc and
+// /dev/amvideo.
+//
+// Handles the amstream ioctls AmlCodec issues for both API levels.
+// Written data goes into a finite ES buffer that a modelled decoder
+// drains one frame per frame period: a frame is the data between two
+// checked-in timestamps and VPTS becomes its timestamp.  Once the
+// PCR is set, a frame is held until the PCR reaches its timestamp.
+// Writes block while the buffer is full, like the driver, unless the
+// device was opened O_NONBLOCK; Poll reports POLLOUT once there is
+// space.
+//
+// The written elementary stream is copied to a file if a path is
+// given.  'speed' scales the emulated time against CLOCK_MONOTONIC,
+// or against the media clock given to SetClock.  With a virtual
+// clock the modelled decoder only runs as the clock is advanced.
+class AmlEmulatorDevice : public IAmlDevice
+{
+	static const int ES_HANDLE = 0x1000;
+	static const int CNTL_HANDLE = 0x1001;
+	static const unsigned int PTS_FREQ = 90000;
+
+
+	struct Checkin
+	{
+		uint64_t Offset;
+		unsigned int Pts;
+	};
+
+
+	pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+	pthread_cond_t spaceAvailable;
+	IMediaClockSPTR clock;		// CLOCK_MONOTONIC when null
+	double origin;
+	double speed;
+	int bufferSize;
+	unsigned int version;
+	FILE* logFile = nullptr;
+
+	bool isEsOpen = false;
+	bool isNonBlocking = false;
+	bool isCntlOpen = false;
+	int videoFormat = -1;
+	double frameRate = 0;
+	bool isPaused = false;
+	bool isSyncEnabled = false;
+	unsigned int syncThreshold = 0;
+	int axis[4] = { 0 };
+
+	uint64_t writeOffset = 0;		// stream bytes written
+	uint64_t readOffset = 0;		// stream bytes decoded
+	std::deque<Checkin> checkins;
+	unsigned int vpts = 0;
+	bool isPcrSet = false;
+	unsigned int pcrBase = 0;
+	double pcrTime = 0;
+	double lastFrameTime = 0;
+
+	AmlEmulatorStats stats;
+
+
+	double Now() const;
+
+	// Must be called with mutex held
+	void ResetStream();
+	void Decode(double now);
+	bool WaitForSpace(double timeoutSeconds);
+	unsigned int Pcr(double now) const;
+	buf_status BufferStatus() const;
+	int SetCommand(unsigned int cmd, unsigned int value);
+	int EsIoctl(unsigned long request, unsigned long argument);
+	int CntlIoctl(unsigned long request, unsigned long argument);
+
+
+public:
+
+	static const int DEFAULT_BUFFER_SIZE = 3 * 1024 * 1024;
+	static const unsigned int S905_VERSION = 0x20000;
+
+
+	AmlEmulatorDevice(const char* logPath = nullptr, double speed = 1.0,
+		int bufferSize = DEFAULT_BUFFER_SIZE, unsigned int version = S905_VERSION);
+	virtual ~AmlEmulatorDevice();
+
+	AmlEmulatorDevice(const AmlEmulatorDevice&) = delete;
+	AmlEmulatorDevice& operator=(const AmlEmulatorDevice&) = delete;
+
+
+	// Must be called before the device is opened
+	void SetClock(IMediaClockSPTR value);
+
+
+	virtual int Open(const char* path, int flags) override;
+	virtual int Close(int fd) override;
+	virtual int Ioctl(int fd, unsigned long request, unsigned long argument) override;
+	virtual int Write(int fd, const void* data, size_t length) override;
+	virtual int Writev(int fd, const iovec* vectors, int count) override;
+	virtual int Poll(int fd, short events, int timeoutMilliseconds) override;
+
+	AmlEmulatorStats Stats();
+};
+
+typedef std::shared_ptr<AmlEmulatorDevice> AmlEmulatorDeviceSPTR;
@@ -16,6 +16,9 @@
 
 #include "AmlVideoSink.h"
 
+#include <errno.h>
+#include <unistd.h>
+
 
 
 
@@ -23,36 +26,129 @@ void AmlVideoSinkElement::timer_Expired(void* sender, const EventArgs& args)
 {
 	timerMutex.Lock();
 
-	if (isEndOfStream)
+	// A check rescheduled meanwhile finds the timer running again
+	if (isEndOfStream && !timer.IsRunning())
 	{
-		buf_status bufferStatus = amlCodec.GetBufferStatus();
-		//int api = codec_get_vbuf_state(&codecContext, &bufferStatus);
-		//if (api == 0)
-		{
-			//printf("AmlVideoSinkElement: codec_get_vbuf_state free_len=%d, size=%d, data_len=%d, read_pointer=%x, write_pointer=%x\n",
-			//	bufferStatus.free_len, bufferStatus.size, bufferStatus.data_len, bufferStatus.read_pointer, bufferStatus.write_pointer);
+		CheckDrain();
+	}
 
-			// Testing has shown this value does not reach zero
-			if (bufferStatus.data_len < 512)
-			{
-				printf("AmlVideoSinkElement: timer_Expired - isEndOfStream=true (Pausing).\n");
-				SetState(MediaState::Pause);
-				isEndOfStream = false;
+	timerMutex.Unlock();
 
-				////debuging
-				//printf("AmlVideoSinkElement: timer_Expired - size=%d, data_len=%d, free_len=%d, read_pointer=%u, write_pointer=%u\n",
-				//	bufferStatus.size, bufferStatus.data_len, bufferStatus.free_len, bufferStatus.read_pointer, bufferStatus.write_pointer);
+	//printf("AmlVideoSinkElement: timer expired.\n");
+}
 
-				//vdec_status vdecStatus = amlCodec.GetVdecStatus();
-				//printf("AmlVideoSinkElement: timer_Expired - width=%u, height=%u, fps=%u, error_count=%u, status=0x%x\n",
-				//	vdecStatus.width, vdecStatus.height, vdecStatus.fps, vdecStatus.error_count, vdecStatus.status);
-			}
-		}
+void AmlVideoSinkElement::StartDrainWatch()
+{
+	timerMutex.Lock();
+
+	double now = ElementMetrics::Now() * 1e-9;
+
+	isEndOfStream = true;
+	endOfStreamTime = now;
+	drainCheckTime = now;
+	drainDataLength = -1;
+	drainVpts = -1;
+	drainProgressTime = now;
+
+	if (!timer.IsRunning())
+	{
+		timer.SetInterval(DRAIN_CHECK_MIN);
+		timer.Start();
 	}
 
 	timerMutex.Unlock();
+}
 
-	//printf("AmlVideoSinkElement: timer expired.\n");
+// Must be called with timerMutex held
+void AmlVideoSinkElement::CheckDrain()
+{
+	double now = ElementMetrics::Now() * 1e-9;
+
+	buf_status bufferStatus = amlCodec.GetBufferStatus();
+	double vpts = amlCodec.GetCurrentPts();
+
+	++eosStats.Checks;
+
+	if (bufferStatus.data_len != drainDataLength || vpts != drainVpts)
+	{
+		drainProgressTime = now;
+	}
+
+
+	double frameRate = videoPin->InfoAs()->FrameRate;
+	double framePeriod = (frameRate > 0) ? 1.0 / frameRate : 1.0 / 25.0;
+
+	// Testing has shown the ES level does not reach zero
+	bool isEmpty = bufferStatus.data_len < DRAIN_EMPTY_LEVEL;
+
+	// The decoder may hold back frames or present a PTS that never
+	// matches the last one checked in, so a few idle frame periods
+	// with an empty buffer also count as presented.
+	bool isPresented = lastTimeStamp <= 0 ||
+		vpts >= lastTimeStamp - framePeriod ||
+		now - drainProgressTime >= 4 * framePeriod;
+
+	bool isStalled = now - drainProgressTime >= DRAIN_STALL_TIMEOUT;
+
+	if ((isEmpty && isPresented) || isStalled)
+	{
+		double latency = now - endOfStreamTime;
+
+		if (!isEmpty)
+		{
+			++eosStats.Timeouts;
+			printf("AmlVideoSinkElement: the codec stopped with %d bytes left.\n", bufferStatus.data_len);
+		}
+
+		printf("AmlVideoSinkElement: end of stream drained in %f s (Pausing).\n", latency);
+
+		RecordEndOfStream(latency);
+		isEndOfStream = false;
+
+		SetState(MediaState::Pause);
+		return;
+	}
+
+
+	// Estimate how long draining takes from the ES drain rate and
+	// from the media left between VPTS and the last PTS checked in.
+	double remaining = 0;
+
+	double interval = now - drainCheckTime;
+	if (drainDataLength > bufferStatus.data_len && interval > 0)
+	{
+		double drainRate = (drainDataLength - bufferStatus.data_len) / interval;
+		remaining = (bufferStatus.data_len - DRAIN_EMPTY_LEVEL) / drainRate;
+	}
+
+	if (lastTimeStamp > 0 && vpts > 0)
+	{
+		remaining = std::max(remaining, lastTimeStamp - vpts);
+	}
+
+	drainCheckTime = now;
+	drainDataLength = bufferStatus.data_len;
+	drainVpts = vpts;
+
+
+	// Checking at half the estimate converges on the end without
+	// overshooting it by more than DRAIN_CHECK_MIN.
+	double delay = std::max(DRAIN_CHECK_MIN, std::min(remaining * 0.5, DRAIN_CHECK_MAX));
+
+	timer.SetInterval(delay);
+	timer.Start();
+}
+
+// Must be called with timerMutex held
+void AmlVideoSinkElement::RecordEndOfStream(double latency)
+{
+	++eosStats.Count;
+	eosStats.LastLatency = latency;
+
+	if (latency > eosStats.MaxLatency)
+	{
+		eosStats.MaxLatency = latency;
+	}
 }
 
 void AmlVideoSinkElement::SetupHardware()
@@ -193,224 +289,258 @@ void AmlVideoSinkElement::ProcessBuffer(AVPacketBufferSPTR buffer)
 	AVPacket* pkt = buffer->GetAVPacket();
 
 
-	unsigned char* nalHeader = (unsigned char*)pkt->data;
+	uint64_t pts = 0;
 
-#if 0
-	printf("Header (pkt.size=%x):\n", pkt.size);
-	for (int j = 0; j < 16; ++j)	//nalHeaderLength
+	if (pkt->pts != AV_NOPTS_VALUE)
 	{
-		printf("%02x ", nalHeader[j]);
+		double timeStamp = av_q2d(buffer->TimeBase()) * pkt->pts;
+		pts = (uint64_t)(timeStamp * PTS_FREQ);
+
+		estimatedNextPts = pkt->pts + pkt->duration;
+		lastTimeStamp = timeStamp;
 	}
-	printf("\n");
-#endif
 
-	if (isFirstVideoPacket)
+
+	// Without an audio clock the video display paces playback
+	if (mediaClock->IsVirtual() && !audioClock && !clockInPin->Source())
 	{
-		printf("Header (pkt.size=%x):\n", pkt->size);
-		for (int j = 0; j < 16; ++j)	//nalHeaderLength
+		double duration = av_q2d(buffer->TimeBase()) * pkt->duration;
+		if (duration <= 0 && videoPin->InfoAs()->FrameRate > 0)
 		{
-			printf("%02x ", nalHeader[j]);
+			duration = 1.0 / videoPin->InfoAs()->FrameRate;
 		}
-		printf("\n");
 
-		if (nalHeader[0] == 0 && nalHeader[1] == 0 &&
-			nalHeader[2] == 0 && nalHeader[3] == 1)
+		if (duration > 0)
 		{
-			isAnnexB = true;
+			mediaClock->Advance(duration);
 		}
+	}
 
-		//double timeStamp = av_q2d(buffer->TimeBase()) * pkt->pts;
-		//unsigned long pts = (unsigned long)(timeStamp * PTS_FREQ);
-
-		//amlCodec.SetSyncThreshold(pts);
 
-		isFirstVideoPacket = false;
+	// The filter delivers the access unit ready to write, its
+	// header (if any) apart from the packet
+	const std::vector<unsigned char>& header = buffer->Header();
+	iovec vectors[2];
+	int count = 0;
 
-		printf("isAnnexB=%u\n", isAnnexB);
+	if (header.size() > 0)
+	{
+		vectors[count].iov_base = (void*)header.data();
+		vectors[count].iov_len = header.size();
+		++count;
 	}
 
+	vectors[count].iov_base = pkt->data;
+	vectors[count].iov_len = pkt->size;
+	++count;
 
-	uint64_t pts = 0;
-
-	if (pkt->pts != AV_NOPTS_VALUE)
+	//if (!amlCodec.SendData(pts, pkt->data, pkt->size))
+	if (!SendCodecData(pts, vectors, count))
 	{
-		double timeStamp = av_q2d(buffer->TimeBase()) * pkt->pts;
-		pts = (uint64_t)(timeStamp * PTS_FREQ);
+		printf("AmlVideoSinkElement::ProcessBuffer - SendData Failed.\n");
+	}
 
-		estimatedNextPts = pkt->pts + pkt->duration;
-		lastTimeStamp = timeStamp;
+
+	if (doPauseFlag)
+	{
+		//codec_pause(&codecContext);
+		amlCodec.Pause();
+		doPauseFlag = false;
 	}
 
+	playPauseMutex.Unlock();
+}
 
-	isExtraDataSent = false;
+// Consumes 'vectors': they are advanced past data already written
+bool AmlVideoSinkElement::SendCodecData(unsigned long pts, iovec* vectors, int count)
+{
+	//printf("AmlVideoSink: SendCodecData - pts=%lu, count=%d\n", pts, count);
+	bool result = true;
 
-	if (isAnnexB)
+	if (pts > 0)
 	{
-		SendCodecData(pts, pkt->data, pkt->size);
-		//amlCodec.SendData(pts, pkt->data, pkt->size);
+		amlCodec.CheckinPts(pts);
 	}
-	else if (!isAnnexB &&
-		(videoFormat == VideoFormatEnum::Avc ||
-		 videoFormat == VideoFormatEnum::Hevc))
-	{
-		//unsigned char* nalHeader = (unsigned char*)pkt.data;
 
-		// Five least significant bits of first NAL unit byte signify nal_unit_type.
-		int nal_unit_type;
-		const int nalHeaderLength = 4;
+	int index = 0;
+	unsigned long writes = 0;
+	unsigned long long bytes = 0;
+	uint64_t progressTime = ElementMetrics::Now();	// of the last write that made progress
+	double totalStallSeconds = 0;
+	bool isReset = false;
 
-		while (nalHeader < (pkt->data + pkt->size))
+	while (index < count)
+	{
+		if (!IsRunning())
 		{
-			switch (videoFormat)
-			{
-				case VideoFormatEnum::Avc:
-					//if (!isExtraDataSent)
-				{
-					// Copy AnnexB data if NAL unit type is 5
-					nal_unit_type = nalHeader[nalHeaderLength] & 0x1F;
+			result = false;
+			break;
+		}
 
-					if (!isExtraDataSent || nal_unit_type == 5)
-					{
-						ConvertH264ExtraDataToAnnexB();
+		int written = amlCodec.WriteData(vectors + index, count - index);
+		++writes;
 
-						SendCodecData(pts, &videoExtraData[0], videoExtraData.size());
-						//amlCodec.SendData(pts, &videoExtraData[0], videoExtraData.size());
-					}
+		if (written > 0)
+		{
+			bytes += written;
+			progressTime = ElementMetrics::Now();
 
-					isExtraDataSent = true;
-				}
-				break;
+			// Skip the vectors written and trim a partial one
+			size_t remaining = written;
+			while (index < count && remaining >= vectors[index].iov_len)
+			{
+				remaining -= vectors[index].iov_len;
+				++index;
+			}
 
-				case VideoFormatEnum::Hevc:
-					//if (!isExtraDataSent)
-				{
-					nal_unit_type = (nalHeader[nalHeaderLength] >> 1) & 0x3f;
+			if (remaining > 0)
+			{
+				vectors[index].iov_base = (unsigned char*)vectors[index].iov_base + remaining;
+				vectors[index].iov_len -= remaining;
+			}
+			//printf("codec_write send %x bytes.\n", written);
 
-					/* prepend extradata to IRAP frames */
-					if (!isExtraDataSent || (nal_unit_type >= 16 && nal_unit_type <= 23))
-					{
-						HevcExtraDataToAnnexB();
+			continue;
+		}
 
-						SendCodecData(0, &videoExtraData[0], videoExtraData.size());
-						//amlCodec.SendData(0, &videoExtraData[0], videoExtraData.size());
-					}
 
-					isExtraDataSent = true;
-				}
-				break;
+		bool isFailed = (written < 0 && errno != EAGAIN && errno != EINTR);
+		if (isFailed)
+		{
+			printf("AmlVideoSink: codec write failed (errno=%d), resetting.\n", errno);
+		}
+		else
+		{
+			// The buffer is full: wait for the decoder to drain it
+			uint64_t start = ElementMetrics::Now();
+			bool isDrained = amlCodec.WaitForBuffer(highWatermark, WRITE_WAIT_SLICE);
 
-				default:
-					throw NotSupportedException("Unexpected video format.");
+			if (isDrained)
+			{
+				// Below the watermark yet the write was refused, e.g. a
+				// packet larger than the free space.  Back off instead
+				// of spinning on the write.
+				usleep(WRITE_RETRY_MICROSECONDS);
 			}
 
+			totalStallSeconds += (ElementMetrics::Now() - start) * 1e-9;
+		}
 
-			// Overwrite header NAL length with startcode '0x00000001' in *BigEndian*
-			int nalLength = nalHeader[0] << 24;
-			nalLength |= nalHeader[1] << 16;
-			nalLength |= nalHeader[2] << 8;
-			nalLength |= nalHeader[3];
+		// Timed from the last progress, however the waits returned
+		double stallSeconds = (ElementMetrics::Now() - progressTime) * 1e-9;
 
-			if (nalLength < 0 || nalLength > pkt->size)
+		if (isFailed || stallSeconds >= writeTimeout)
+		{
+			if (!isFailed)
 			{
-				printf("Invalid NAL length=%d, pkt->size=%d\n", nalLength, pkt->size);
-				throw Exception();
+				printf("AmlVideoSink: codec write made no progress for %f seconds, resetting.\n", stallSeconds);
 			}
 
-			nalHeader[0] = 0;
-			nalHeader[1] = 0;
-			nalHeader[2] = 0;
-			nalHeader[3] = 1;
+			amlCodec.Reset();
+			clockInPin->ResetSync();
+			vptsSampler.Invalidate();
+			isReset = true;
+			result = false;
 
-			nalHeader += nalLength + 4;
+			break;
 		}
+	}
 
-		//SendCodecData(pts, pkt->data, pkt->size);
-		//if (!amlCodec.SendData(pts, pkt->data, pkt->size))
-		if (!SendCodecData(pts, pkt->data, pkt->size))
-		{
-			// Resend extra data on codec reset
-			isExtraDataSent = false;
 
-			printf("AmlVideoSinkElement::ProcessBuffer - SendData Failed.\n");
-		}
+	writeStatsMutex.Lock();
 
-		//isExtraDataSent = false;
-	}
-	else if (videoPin->InfoAs()->Format == VideoFormatEnum::Mpeg4V3)
+	++writeStats.Frames;
+	writeStats.Writes += writes;
+	writeStats.Bytes += bytes;
+
+	if (totalStallSeconds > 0)
 	{
-		//printf("Sending Divx3\n");
-		Divx3Header(videoPin->InfoAs()->Width, videoPin->InfoAs()->Height, pkt->size);
-		SendCodecData(pts, &videoExtraData[0], videoExtraData.size());
-		//amlCodec.SendData(pts, &videoExtraData[0], videoExtraData.size());
+		++writeStats.Stalls;
+		writeStats.StallSeconds += totalStallSeconds;
 
-		SendCodecData(0, pkt->data, pkt->size);
-		//amlCodec.SendData(0, pkt->data, pkt->size);
+		if (totalStallSeconds > writeStats.MaxStallSeconds)
+		{
+			writeStats.MaxStallSeconds = totalStallSeconds;
+		}
 	}
-	else
+
+	if (isReset)
 	{
-		SendCodecData(pts, pkt->data, pkt->size);
-		//amlCodec.SendData(pts, pkt->data, pkt->size);
+		++writeStats.Resets;
 	}
 
-
-	if (doPauseFlag)
+	if (writes > writeStats.MaxWritesPerFrame)
 	{
-		//codec_pause(&codecContext);
-		amlCodec.Pause();
-		doPauseFlag = false;
+		writeStats.MaxWritesPerFrame = writes;
 	}
 
-	playPauseMutex.Unlock();
+	writeStatsMutex.Unlock();
+
+	return result;
 }
 
-bool AmlVideoSinkElement::SendCodecData(unsigned long pts, unsigned char* data, int length)
+ClockSyncStats AmlVideoSinkElement::ClockStats()
 {
-	//printf("AmlVideoSink: SendCodecData - pts=%lu, data=%p, length=0x%x\n", pts, data, length);
-	bool result = true;
+	return clockInPin->Stats();
+}
 
-	if (pts > 0)
+EndOfStreamStats AmlVideoSinkElement::EosStats()
+{
+	timerMutex.Lock();
+	EndOfStreamStats result = eosStats;
+	timerMutex.Unlock();
+
+	return result;
+}
+
+void AmlVideoSinkElement::SynchronizeClock()
+{
+	if (!audioClock || !amlCodec.IsOpen())
 	{
-		amlCodec.CheckinPts(pts);
+		return;
 	}
 
-	int maxAttempts = 150;
-	int offset = 0;
-	while (offset < length)
+
+	ClockSample sample = audioClock->Read();
+	if (sample.IsValid && sample.Rate > 0)
 	{
-		if (!IsRunning())
-		{
-			result = false;
-			break;
-		}
+		clockInPin->Synchronize(sample.Extrapolate(mediaClock->Now()));
+	}
+}
 
-		int count = amlCodec.WriteData(data + offset, length - offset);
-		if (count > 0)
-		{
-			offset += count;
-			//printf("codec_write send %x bytes of %x total.\n", count, pkt.size);
-		}
-		else
-		{
-			//printf("codec_write failed (%x).\n", count);
-			maxAttempts -= 1;
+void AmlVideoSinkElement::PublishClock()
+{
+	if (clockSinks.IsEmpty())
+	{
+		return;
+	}
 
-			if (maxAttempts <= 0)
-			{
-				printf("codec_write max attempts exceeded.\n");
-				
-				amlCodec.Reset();
-				result = false;
 
-				break;
-			}
-		}
+	// Served from the VPTS cache.  It reads 0 until the
+	// first frame is decoded.
+	double time = Clock();
+	if (time <= 0)
+	{
+		return;
 	}
 
-	return result;
+	for (IClockSinkSPTR sink : clockSinks)
+	{
+		sink->SetTimeStamp(time);
+	}
 }
 
 
 
+AmlVideoSinkElement::AmlVideoSinkElement()
+	: mediaClock(MediaClock::Default()),
+	vptsSampler(&amlCodec, mediaClock)
+{
+	// Writes to the codec block while its buffer is full
+	SetExecutionMode(ExecutionModeEnum::Dedicated);
+}
+
+
 double AmlVideoSinkElement::Clock()
 {
 	// NOTE: This value is not valid until pts check-in
@@ -425,7 +555,7 @@ double AmlVideoSinkElement::Clock()
 
 	if (amlCodec.IsOpen())
 	{
-		return amlCodec.GetCurrentPts();
+		return vptsSampler.Time();
 	}
 	else
 	{
@@ -435,6 +565,17 @@ double AmlVideoSinkElement::Clock()
 
 
 
+CodecWriteStats AmlVideoSinkElement::WriteStats()
+{
+	writeStatsMutex.Lock();
+	CodecWriteStats result = writeStats;
+	writeStatsMutex.Unlock();
+
+	return result;
+}
+
+
+
 void AmlVideoSinkElement::Initialize()
 {
 	ClearOutputPins();
@@ -479,8 +620,7 @@ void AmlVideoSinkElement::Initialize()
 		std::bind(&AmlVideoSinkElement::timer_Expired, this, std::placeholders::_1, std::placeholders::_2));
 
 	timer.Expired.AddListener(timerExpiredListener);
-	timer.SetInterval(0.5f); //0.25f
-	timer.Start();
+	timer.SetIsPeriodic(false);
 }
 
 void AmlVideoSinkElement::DoWork()
@@ -498,8 +638,10 @@ void AmlVideoSinkElement::DoWork()
 	{
 		//AVPacketBufferSPTR avPacketBuffer = std::static_pointer_cast<AVPacketBuffer>(buffer);
 
-		// Video
-		if (videoPin->TryGetFilledBuffer(&buffer))
+		// Video.  The filter delivers in bursts and wakes coalesce,
+		// so the pin is drained rather than read once per wake.
+		while (State() == MediaState::Play &&
+			videoPin->TryGetFilledBuffer(&buffer))
 		{
 			if (isFirstData)
 			{
@@ -512,9 +654,13 @@ void AmlVideoSinkElement::DoWork()
 					}
 
 					VideoPinInfoSPTR info = std::static_pointer_cast<VideoPinInfo>(otherPin->Info());
+					if (!info->IsDecoderReady)
+					{
+						throw InvalidOperationException("AmlVideoSink: The video pin must come from a BitstreamFilterElement.");
+					}
+
 					videoFormat = info->Format;
 					//frameRate = info->FrameRate;
-					extraData = *(info->ExtraData);
 
 					// TODO: This information should be copied
 					//       as part of pin negotiation
@@ -524,11 +670,10 @@ void AmlVideoSinkElement::DoWork()
 					videoPin->InfoAs()->FrameRate = info->FrameRate;
 					videoPin->InfoAs()->ExtraData = info->ExtraData;
 					videoPin->InfoAs()->HasEstimatedPts = info->HasEstimatedPts;
+					videoPin->InfoAs()->IsDecoderReady = info->IsDecoderReady;
 
 					clockInPin->SetFrameRate(info->FrameRate);
 
-					printf("AmlVideoSink: ExtraData size=%ld\n", (long int)extraData.size());
-
 					SetupHardware();
 
 					//clockThread.Start();
@@ -548,7 +693,20 @@ void AmlVideoSinkElement::DoWork()
 					switch (markerBuffer->Marker())
 					{
 						case MarkerEnum::EndOfStream:
-							isEndOfStream = true;
+							if (mediaClock->IsVirtual())
+							{
+								// Virtual time stops with the stream, so
+								// the emulated decoder is not waited for
+								timerMutex.Lock();
+								RecordEndOfStream(0);
+								timerMutex.Unlock();
+
+								SetState(MediaState::Pause);
+							}
+							else
+							{
+								StartDrainWatch();
+							}
 							break;
 
 						case MarkerEnum::Discontinue:
@@ -568,6 +726,8 @@ void AmlVideoSinkElement::DoWork()
 					//printf("AmlVideoSink: Got a buffer.\n");
 					AVPacketBufferSPTR avPacketBuffer = std::static_pointer_cast<AVPacketBuffer>(buffer);
 					ProcessBuffer(avPacketBuffer);
+					SynchronizeClock();
+					PublishClock();
 					break;
 				}
 
@@ -597,6 +757,7 @@ void AmlVideoSinkElement::ChangeState(MediaState oldState, MediaState newState)
 			{
 				amlCodec.Resume();
 			}
+			vptsSampler.SetRate(1.0);
 
 			//doPauseFlag = false;
 			//doResumeFlag = true;
@@ -619,6 +780,7 @@ void AmlVideoSinkElement::ChangeState(MediaState oldState, MediaState newState)
 			{
 				amlCodec.Pause();
 			}
+			vptsSampler.SetRate(0);
 
 			//timer.Stop();
 
@@ -634,10 +796,17 @@ void AmlVideoSinkElement::ChangeState(MediaState oldState, MediaState newState)
 
 void AmlVideoSinkElement::Flush()
 {
+	// A pending drain check must not pause the flushed sink.
+	// Cancel waits for a running timer_Expired, which takes
+	// timerMutex, so it must be called unlocked.
 	timerMutex.Lock();
-	playPauseMutex.Lock();
+	isEndOfStream = false;
+	timerMutex.Unlock();
 
-	timer.Stop();
+	timer.Cancel();
+
+	timerMutex.Lock();
+	playPauseMutex.Lock();
 
 
 	////int codec_flush_video(codec_para_t *pcodec)
@@ -676,6 +845,8 @@ void AmlVideoSinkElement::Flush()
 		printf("AmlVideoSinkElement: reset.\n");
 		//codec_close(&codecContext);
 		amlCodec.Reset();
+		clockInPin->ResetSync();
+		vptsSampler.Invalidate();
 
 		//printf("AmlVideoSinkElement: codec_init.\n");
 		//codec_init(&codecContext);
@@ -688,8 +859,6 @@ void AmlVideoSinkElement::Flush()
 	}
 
 
-	timer.Start();
-
 	playPauseMutex.Unlock();
 	timerMutex.Unlock();
 
@@ -700,15 +869,47 @@ void AmlVideoSinkElement::Flush()
 void AmlVideoSinkElement::Terminating()
 {
 	timerMutex.Lock();
-	playPauseMutex.Lock();
+	isEndOfStream = false;
+	timerMutex.Unlock();
+
+	timer.Cancel();
+
+	TimerStats stats = timer.Stats();
+	printf("AmlVideoSinkElement: timer expirations=%lu overruns=%lu drift=%f max=%f jitter=%f\n",
+		stats.Expirations, stats.Overruns, stats.MeanLateness, stats.MaxLateness, stats.Jitter);
 
-	timer.Stop();
+	CodecWriteStats writes = WriteStats();
+	printf("AmlVideoSinkElement: frames=%lu writes=%lu (%f per frame, max %lu)\n",
+		writes.Frames, writes.Writes,
+		writes.Frames > 0 ? writes.Writes / (double)writes.Frames : 0.0,
+		writes.MaxWritesPerFrame);
+	printf("AmlVideoSinkElement: stalls=%lu (%f s, max %f s) resets=%lu\n",
+		writes.Stalls, writes.StallSeconds, writes.MaxStallSeconds, writes.Resets);
 
-	//codec_resume(&codecContext);
-	amlCodec.Resume();
+	ClockSyncStats sync = ClockStats();
+	printf("AmlVideoSinkElement: clock drift=%f max=%f measurements=%lu corrections=%lu resyncs=%lu ioctls=%lu (%f per s)\n",
+		sync.Drift, sync.MaxDrift, sync.Measurements, sync.Corrections, sync.HardResyncs, sync.Ioctls,
+		sync.Seconds > 0 ? sync.Ioctls / sync.Seconds : 0.0);
 
-	//codec_close(&codecContext);
-	amlCodec.Close();
+	VptsSamplerStats vpts = vptsSampler.Stats();
+	printf("AmlVideoSinkElement: vpts queries=%lu samples=%lu\n",
+		vpts.Queries, vpts.Samples);
+
+	EndOfStreamStats eos = EosStats();
+	printf("AmlVideoSinkElement: end of stream count=%lu latency=%f max=%f checks=%lu timeouts=%lu\n",
+		eos.Count, eos.LastLatency, eos.MaxLatency, eos.Checks, eos.Timeouts);
+
+	timerMutex.Lock();
+	playPauseMutex.Lock();
+
+	if (amlCodec.IsOpen())
+	{
+		//codec_resume(&codecContext);
+		amlCodec.Resume();
+
+		//codec_close(&codecContext);
+		amlCodec.Close();
+	}
 
 	//codec_close_no_modeset(&codecContext);
 
@@ -734,157 +935,3 @@ void AmlVideoSinkElement::Terminating()
 //
 //	close(fd);
 //}
-
-void AmlVideoSinkElement::Divx3Header(int width, int height, int packetSize)
-{
-	// Bitstream info from Kodi
-
-	videoExtraData.clear();
-
-	videoExtraData.push_back(0x00);
-	videoExtraData.push_back(0x00);
-	videoExtraData.push_back(0x00);
-	videoExtraData.push_back(0x01);
-
-	unsigned i = (width << 12) | (height & 0xfff);
-	videoExtraData.push_back(0x20);
-	videoExtraData.push_back((i >> 16) & 0xff);
-	videoExtraData.push_back((i >> 8) & 0xff);
-	videoExtraData.push_back(i & 0xff);
-	videoExtraData.push_back(0x00);
-	videoExtraData.push_back(0x00);
-
-	const unsigned char divx311_chunk_prefix[] =
-	{
-		0x00, 0x00, 0x00, 0x01,
-		0xb6, 'D', 'I', 'V', 'X', '3', '.', '1', '1'
-	};
-
-	for (size_t i = 0; i < sizeof(divx311_chunk_prefix); ++i)
-	{
-		videoExtraData.push_back(divx311_chunk_prefix[i]);
-	}
-
-	videoExtraData.push_back((packetSize >> 24) & 0xff);
-	videoExtraData.push_back((packetSize >> 16) & 0xff);
-	videoExtraData.push_back((packetSize >> 8) & 0xff);
-	videoExtraData.push_back(packetSize & 0xff);
-}
-
-void AmlVideoSinkElement::ConvertH264ExtraDataToAnnexB()
-{
-	void* video_extra_data = &extraData[0];
-	int video_extra_data_size = extraData.size();
-
-	videoExtraData.clear();
-
-	if (video_extra_data_size > 0)
-	{
-		unsigned char* extraData = (unsigned char*)video_extra_data;
-
-		// http://aviadr1.blogspot.com/2010/05/h264-extradata-partially-explained-for.html
-
-		const int spsStart = 6;
-		int spsLen = extraData[spsStart] * 256 + extraData[spsStart + 1];
-
-		videoExtraData.push_back(0);
-		videoExtraData.push_back(0);
-		videoExtraData.push_back(0);
-		videoExtraData.push_back(1);
-
-		for (int i = 0; i < spsLen; ++i)
-		{
-			videoExtraData.push_back(extraData[spsStart + 2 + i]);
-		}
-
-
-		int ppsStart = spsStart + 2 + spsLen + 1; // 2byte sbs len, 1 byte pps start code
-		int ppsLen = extraData[ppsStart] * 256 + extraData[ppsStart + 1];
-
-		videoExtraData.push_back(0);
-		videoExtraData.push_back(0);
-		videoExtraData.push_back(0);
-		videoExtraData.push_back(1);
-
-		for (int i = 0; i < ppsLen; ++i)
-		{
-			videoExtraData.push_back(extraData[ppsStart + 2 + i]);
-		}
-
-	}
-
-#if 0
-	printf("EXTRA DATA = ");
-
-	for (int i = 0; i < videoExtraData.size(); ++i)
-	{
-		printf("%02x ", videoExtraData[i]);
-
-	}
-
-	printf("\n");
-#endif
-}
-
-void AmlVideoSinkElement::HevcExtraDataToAnnexB()
-{
-	void* video_extra_data = &extraData[0];
-	int video_extra_data_size = extraData.size();
-
-
-	videoExtraData.clear();
-
-	if (video_extra_data_size > 0)
-	{
-		unsigned char* extraData = (unsigned char*)video_extra_data;
-
-		// http://fossies.org/linux/ffmpeg/libavcodec/hevc_mp4toannexb_bsf.c
-
-		int offset = 21;
-		int length_size = (extraData[offset++] & 3) + 1;
-		length_size = length_size;// silence compiler warning
-
-		int num_arrays = extraData[offset++];
-
-		//printf("HevcExtraDataToAnnexB: length_size=%d, num_arrays=%d\n", length_size, num_arrays);
-
-
-		for (int i = 0; i < num_arrays; i++)
-		{
-			int type = extraData[offset++] & 0x3f;
-			type = type; // silence compiler warning
-
-			int cnt = extraData[offset++] << 8;
-			cnt |= extraData[offset++];
-
-			for (int j = 0; j < cnt; j++)
-			{
-				videoExtraData.push_back(0);
-				videoExtraData.push_back(0);
-				videoExtraData.push_back(0);
-				videoExtraData.push_back(1);
-
-				int nalu_len = extraData[offset++] << 8;
-				nalu_len |= extraData[offset++];
-
-				for (int k = 0; k < nalu_len; ++k)
-				{
-					videoExtraData.push_back(extraData[offset++]);
-				}
-			}
-		}
-
-#if 0
-		printf("EXTRA DATA = ");
-
-		for (int i = 0; i < videoExtraData.size(); ++i)
-		{
-			printf("%02x ", videoExtraData[i]);
-		}
-
-		printf("\n");
-#endif
-	}
-}
-
-
@@ -20,6 +20,8 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <cstring>
+#include <cmath>
+#include <algorithm>
 
 
 #include <vector>
@@ -30,75 +32,117 @@
 #include "Thread.h"
 #include "Timer.h"
 #include "AmlCodec.h"
+#include "MediaClock.h"
+#include "PublishedClock.h"
+#include "VptsSampler.h"
 
 
 
-class AmlVideoSinkClockInPin : public InPin
+// Codec submission counters.  An access unit normally costs one
+// write; more mean short writes, retries or a staged fallback.
+struct CodecWriteStats
 {
-	const uint64_t PTS_FREQ = 90000;
+	unsigned long Frames = 0;
+	unsigned long Writes = 0;			// write/writev calls, failed ones included
+	unsigned long MaxWritesPerFrame = 0;
+	unsigned long long Bytes = 0;
+	unsigned long Stalls = 0;			// frames that waited for buffer space
+	double StallSeconds = 0;
+	double MaxStallSeconds = 0;
+	unsigned long Resets = 0;			// codec resets after a write timeout
+};
 
-	//codec_para_t* codecContextPtr;
-	AmlCodec* codecPTR;
-	//double clock = 0;
-	double frameRate = 0;	// TODO just read info from Owner()
 
 
-	void ProcessClockBuffer(BufferSPTR buffer)
-	{
-		// truncate to 32bit
-		uint64_t pts = (uint64_t)(buffer->TimeStamp() * PTS_FREQ);
-		pts &= 0xffffffff;
+// End of stream drain watches.  Latency runs from the EOS marker
+// reaching the sink to the sink pausing once the codec has drained.
+struct EndOfStreamStats
+{
+	unsigned long Count = 0;
+	unsigned long Checks = 0;		// drain checks, all streams
+	double LastLatency = 0;
+	double MaxLatency = 0;
+	unsigned long Timeouts = 0;		// the decoder stopped before draining
+};
 
-		uint64_t vpts = (uint64_t)(codecPTR->GetCurrentPts() * PTS_FREQ);
-		vpts &= 0xffffffff;
 
-		//double pts = pts1 / (double)PTS_FREQ;
 
-		//unsigned long pts = (unsigned long)(buffer->TimeStamp() * PTS_FREQ);
+// Audio/video clock recovery counters
+struct ClockSyncStats
+{
+	double Drift = 0;				// filtered PCR - audio, seconds
+	double MaxDrift = 0;			// largest filtered magnitude
+	unsigned long Measurements = 0;
+	unsigned long Corrections = 0;	// gradual PCR adjustments
+	unsigned long HardResyncs = 0;
+	unsigned long Ioctls = 0;		// PCR reads and writes
+	double Seconds = 0;				// since the first measurement
+};
 
 
-		//int vpts = codec_get_vpts(codecContextPtr);
-		//double vpts = vpts1 / (double)PTS_FREQ;
+// Locks the video system clock (PCR) to the audio clock.
+//
+// The PCR is sampled at most every MEASURE_INTERVAL and the drift
+// against the audio timestamps is low-pass filtered.  A PI
+// controller on the filtered drift moves the PCR at most every
+// ADJUST_INTERVAL and by no more than a quarter frame, so a
+// correction never skips or repeats a frame.  The PCR is only set
+// outright when locking and when the drift exceeds HARD_RESYNC_DRIFT.
+// The sink drives Synchronize from the published audio clock.
+// Nothing in the player connects to the pin any more; its DoWork
+// is kept for external graphs that push ClockData buffers, which
+// drive Synchronize the same way.  An unconnected pin has no work
+// item, so the path costs nothing in the player.
+class AmlVideoSinkClockInPin : public InPin
+{
+	const double MEASURE_INTERVAL = 0.1;
+	const double ADJUST_INTERVAL = 0.5;
+	const double FILTER_GAIN = 0.25;			// per measurement
+	const double PROPORTIONAL_GAIN = 0.5;		// per adjustment
+	const double INTEGRAL_GAIN = 0.1;			// per second
+	const double MIN_CORRECTION = 0.001;
+	const double MAX_CORRECTION_FRAMES = 0.25;
+	const double LOCK_DRIFT_FRAMES = 2.0;
+	const double HARD_RESYNC_DRIFT = 0.25;
 
-		//if (clock < (vpts / (double)PTS_FREQ))
-		//{
-		//	clock = (vpts / (double)PTS_FREQ);
-		//}
+	//codec_para_t* codecContextPtr;
+	AmlCodec* codecPTR;
+	//double clock = 0;
+	double frameRate = 0;	// TODO just read info from Owner()
 
+	Mutex syncMutex;
+	bool isLocked = false;
+	double filteredDrift = 0;
+	double integral = 0;
+	double firstMeasureTime = -1;
+	double lastMeasureTime = -1;
+	double lastAdjustTime = -1;
+	ClockSyncStats stats;
+	IMediaClockSPTR mediaClock;	// virtual time makes runs repeatable
 
-		double drift = ((double)vpts - (double)pts) / (double)PTS_FREQ;
-		//double driftTime = drift / (double)PTS_FREQ;
-		double driftFrames = drift * frameRate;
 
-		// To minimize clock jitter, only adjust the clock if it
-		// deviates more than +/- 2 frames
-		if (driftFrames >= 2.0 || driftFrames <= -2.0)
-		{
-			//if (pts > 0)
-			{
-				//int codecCall = codec_set_pcrscr(codecContextPtr, (int)pts);
-				//if (codecCall != 0)
-				//{
-				//	printf("codec_set_pcrscr failed.\n");
-				//}
-				codecPTR->SetCurrentPts(buffer->TimeStamp());
-
-				printf("AmlVideoSink: Adjust PTS - pts=%f vpts=%f drift=%f (%f frames)\n", pts / (double)PTS_FREQ, vpts / (double)PTS_FREQ, drift, driftFrames);
-			}
-		}
+	double Now()
+	{
+		return mediaClock->Now();
 	}
 
 protected:
 
+	virtual bool HasWork() const override
+	{
+		return true;
+	}
+
 	virtual void DoWork() override
 	{
 		BufferSPTR buffer;
 		if (TryGetFilledBuffer(&buffer))
 		{
 			ElementSPTR owner = Owner().lock();
-			if (owner && owner->State() == MediaState::Play)
+			if (owner && owner->State() == MediaState::Play &&
+				codecPTR->IsOpen())
 			{
-				ProcessClockBuffer(buffer);
+				Synchronize(buffer->TimeStamp());
 			}
 
 			PushProcessedBuffer(buffer);
@@ -109,14 +153,6 @@ protected:
 
 public:
 
-	//double Clock() const
-	//{
-	//	//return clock;
-	//	int vpts = codec_get_vpts(codecContextPtr);
-	//	
-	//	return vpts / (double)PTS_FREQ;
-	//}
-
 	double FrameRate() const
 	{
 		return frameRate;
@@ -126,15 +162,129 @@ public:
 		frameRate = value;
 	}
 
+	// 'pts' is the audio position playing now.  Calls closer
+	// together than MEASURE_INTERVAL are ignored.
+	void Synchronize(double pts)
+	{
+		syncMutex.Lock();
+
+		double now = Now();
+		if (lastMeasureTime >= 0 && now - lastMeasureTime < MEASURE_INTERVAL)
+		{
+			syncMutex.Unlock();
+			return;
+		}
+
+
+		double framePeriod = (frameRate > 0) ? 1.0 / frameRate : 1.0 / 25.0;
+		double maxCorrection = MAX_CORRECTION_FRAMES * framePeriod;
+
+		double pcr = codecPTR->GetCurrentPcr();
+		double drift = pcr - pts;
+
+		++stats.Measurements;
+		++stats.Ioctls;
+
+		if (firstMeasureTime < 0)
+		{
+			firstMeasureTime = now;
+		}
+		stats.Seconds = now - firstMeasureTime;
+
+		// A pause stops both clocks; the gap is not drift
+		double interval = (lastMeasureTime >= 0) ? std::min(now - lastMeasureTime, 1.0) : 0;
+		lastMeasureTime = now;
+
+
+		bool isHardResync = isLocked ?
+			std::abs(drift) > HARD_RESYNC_DRIFT :
+			std::abs(drift) >= LOCK_DRIFT_FRAMES * framePeriod;
+
+		if (isHardResync)
+		{
+			codecPTR->SetCurrentPts(pts);
+
+			++stats.HardResyncs;
+			++stats.Ioctls;
+
+			printf("AmlVideoSink: Resync PTS - pts=%f pcr=%f drift=%f (%f frames)\n",
+				pts, pcr, drift, drift / framePeriod);
+
+			filteredDrift = 0;
+			integral = 0;
+			lastAdjustTime = now;
+		}
+		else
+		{
+			filteredDrift += FILTER_GAIN * (drift - filteredDrift);
+
+			integral += filteredDrift * interval;
+			integral = std::max(-maxCorrection / INTEGRAL_GAIN, std::min(integral, maxCorrection / INTEGRAL_GAIN));
+
+			if (lastAdjustTime < 0 || now - lastAdjustTime >= ADJUST_INTERVAL)
+			{
+				double correction = PROPORTIONAL_GAIN * filteredDrift + INTEGRAL_GAIN * integral;
+				correction = std::max(-maxCorrection, std::min(correction, maxCorrection));
+
+				if (std::abs(correction) >= MIN_CORRECTION)
+				{
+					// Slews the PCR back when video runs ahead
+					codecPTR->SetCurrentPts(pcr - correction);
+
+					++stats.Corrections;
+					++stats.Ioctls;
+
+					filteredDrift -= correction;
+					lastAdjustTime = now;
+				}
+			}
+		}
+
+		isLocked = true;
+
+		stats.Drift = filteredDrift;
+		if (std::abs(filteredDrift) > stats.MaxDrift)
+		{
+			stats.MaxDrift = std::abs(filteredDrift);
+		}
+
+		syncMutex.Unlock();
+	}
+
+	ClockSyncStats Stats()
+	{
+		syncMutex.Lock();
+		ClockSyncStats result = stats;
+		syncMutex.Unlock();
+
+		return result;
+	}
+
 
 
 	AmlVideoSinkClockInPin(ElementWPTR owner, PinInfoSPTR info, AmlCodec* codecPTR)
 		: InPin(owner, info),
-		codecPTR(codecPTR)
+		codecPTR(codecPTR),
+		mediaClock(MediaClock::Default())
 	{
 		if (codecPTR == nullptr)
 			throw ArgumentNullException();
 	}
+
+
+	// The next measurement locks again, e.g. after a seek
+	void ResetSync()
+	{
+		syncMutex.Lock();
+
+		isLocked = false;
+		filteredDrift = 0;
+		integral = 0;
+		lastMeasureTime = -1;
+		lastAdjustTime = -1;
+
+		syncMutex.Unlock();
+	}
 };
 
 typedef std::shared_ptr<AmlVideoSinkClockInPin> AmlVideoSinkClockInPinSPTR;
@@ -217,9 +367,16 @@ typedef std::shared_ptr<AmlVideoSinkClockInPin> AmlVideoSinkClockInPinSPTR;
 
 
 
+// Writes the access units from BitstreamFilterElement to the codec.
 class AmlVideoSinkElement : public Element
 {
 	const uint64_t PTS_FREQ = 90000;
+	const double WRITE_WAIT_SLICE = 0.1;	// IsRunning is checked in between
+	const int WRITE_RETRY_MICROSECONDS = 1000;
+	const double DRAIN_CHECK_MIN = 0.005;
+	const double DRAIN_CHECK_MAX = 0.1;
+	const double DRAIN_STALL_TIMEOUT = 2.0;	// no ES or VPTS progress
+	const int DRAIN_EMPTY_LEVEL = 512;		// the ES level never reaches zero
 	//
 	//const long EXTERNAL_PTS = (1);
 	//const long SYNC_OUTSIDE = (2);
@@ -228,20 +385,14 @@ class AmlVideoSinkElement : public Element
 	//const long MAX_REFER_BUF = 0x10;
 	//const long ERROR_RECOVERY_MODE_IN = 0x20;
 
-	std::vector<unsigned char> videoExtraData;
-
 	//codec_para_t codecContext;
 	double lastTimeStamp = -1;
 
-	bool isFirstVideoPacket = true;
-	bool isAnnexB = false;
-	bool isExtraDataSent = false;
 	int64_t estimatedNextPts = 0;
 
 	VideoFormatEnum videoFormat = VideoFormatEnum::Unknown;
 	VideoInPinSPTR videoPin;
 	bool isFirstData = true;
-	std::vector<unsigned char> extraData;
 
 	uint64_t clockPts = 0;
 	uint64_t lastClockPts = 0;
@@ -249,8 +400,14 @@ class AmlVideoSinkElement : public Element
 
 	AmlVideoSinkClockInPinSPTR clockInPin;
 	bool isEndOfStream = false;
-
-	Timer timer;
+	double endOfStreamTime = 0;
+	double drainCheckTime = 0;
+	int drainDataLength = 0;
+	double drainVpts = 0;
+	double drainProgressTime = 0;
+	EndOfStreamStats eosStats;
+
+	Timer timer;	// one-shot drain watch, idle while playing
 	EventListenerSPTR<EventArgs> timerExpiredListener;
 	Mutex timerMutex;
 	bool doPauseFlag = false;
@@ -258,14 +415,27 @@ class AmlVideoSinkElement : public Element
 	Mutex playPauseMutex;
 
 	//AmlVideoSinkClockOutPinSPTR clockOutPin;
+	IMediaClockSPTR mediaClock;	// virtual: the codec is expected to be emulated
 	AmlCodec amlCodec;
+	VptsSampler vptsSampler;
+	PublishedClockSPTR audioClock;
+	ClockList clockSinks;
+	CodecWriteStats writeStats;
+	Mutex writeStatsMutex;
+	double highWatermark = 0.8;
+	double writeTimeout = 3.0;
 
 
 
 	void timer_Expired(void* sender, const EventArgs& args);
+	void StartDrainWatch();
+	void CheckDrain();
+	void RecordEndOfStream(double latency);
 	void SetupHardware();
 	void ProcessBuffer(AVPacketBufferSPTR buffer);	
-	bool SendCodecData(unsigned long pts, unsigned char* data, int length);
+	bool SendCodecData(unsigned long pts, iovec* vectors, int count);
+	void SynchronizeClock();
+	void PublishClock();
 
 
 protected:
@@ -279,7 +449,59 @@ protected:
 
 public:
 
+	AmlVideoSinkElement();
+
+
+	// Served from a cached VPTS sample; polling it is cheap
 	double Clock();
+	CodecWriteStats WriteStats();
+	ClockSyncStats ClockStats();
+	EndOfStreamStats EosStats();
+
+	// The clock video is slewed to.  Set before playing; without
+	// one the video display paces playback.
+	PublishedClockSPTR AudioClock() const
+	{
+		return audioClock;
+	}
+	void SetAudioClock(PublishedClockSPTR value)
+	{
+		audioClock = value;
+	}
+
+	// Given the displayed position after every packet written.
+	// Add before playing.
+	ClockList* ClockSinks()
+	{
+		return &clockSinks;
+	}
+
+	// A full ES buffer is written again once it drains below this
+	// fraction of its size.
+	double HighWatermark() const
+	{
+		return highWatermark;
+	}
+	void SetHighWatermark(double value)
+	{
+		if (value <= 0 || value > 1)
+			throw ArgumentOutOfRangeException();
+
+		highWatermark = value;
+	}
+
+	// How long a write may make no progress before the codec is reset
+	double WriteTimeout() const
+	{
+		return writeTimeout;
+	}
+	void SetWriteTimeout(double value)
+	{
+		if (value <= 0)
+			throw ArgumentOutOfRangeException();
+
+		writeTimeout = value;
+	}
 
 	virtual void Flush() override;
 
@@ -287,10 +509,6 @@ private:
 
 	//static void WriteToFile(const char* path, const char* value);
 
-	void Divx3Header(int width, int height, int packetSize);
-	void ConvertH264ExtraDataToAnnexB();
-	void HevcExtraDataToAnnexB();
-
 };
 
 typedef std::shared_ptr<AmlVideoSinkElement> AmlVideoSinkElementSPTR;
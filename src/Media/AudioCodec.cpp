@@ -111,6 +111,41 @@ void AudioCodecElement::SetupCodec()
 }
 
 
+PcmDataBufferSPTR AudioCodecElement::GetPcmBuffer(PcmFormat format, int channels, int samples)
+{
+	BufferSPTR buffer;
+
+	while (audioOutPin->TryGetAvailableBuffer(&buffer))
+	{
+		// Markers sent downstream come back here too; only
+		// PCM buffers are recycled.
+		if (buffer->Type() == BufferTypeEnum::PcmData)
+		{
+			PcmDataBufferSPTR pcmDataBuffer = std::static_pointer_cast<PcmDataBuffer>(buffer);
+
+			if (pcmDataBuffer->Reconfigure(format, channels, samples))
+			{
+				Log("AudioCodecElement: PcmDataBuffer grew to %d bytes.\n", pcmDataBuffer->Capacity());
+			}
+
+			return pcmDataBuffer;
+		}
+	}
+
+
+	// The pool grows until it covers the buffers in flight downstream
+	PcmDataBufferSPTR pcmDataBuffer = std::make_shared<PcmDataBuffer>(
+		shared_from_this(),
+		format,
+		channels,
+		samples);
+
+	++pcmBufferCount;
+	Log("AudioCodecElement: PcmDataBuffer pool count=%d.\n", pcmBufferCount);
+
+	return pcmDataBuffer;
+}
+
 void AudioCodecElement::ProcessBuffer(AVPacketBufferSPTR buffer, AVFrameBufferSPTR frame)
 {
 	AVPacket* pkt = buffer->GetAVPacket();
@@ -197,8 +232,7 @@ void AudioCodecElement::ProcessBuffer(AVPacketBufferSPTR buffer, AVFrameBufferSP
 			}
 
 
-			PcmDataBufferSPTR pcmDataBuffer = std::make_shared<PcmDataBuffer>(
-				shared_from_this(),
+			PcmDataBufferSPTR pcmDataBuffer = GetPcmBuffer(
 				format,
 				decoded_frame->channels,
 				decoded_frame->nb_samples);
@@ -319,16 +353,9 @@ void AudioCodecElement::Initialize()
 void AudioCodecElement::DoWork()
 {
 	BufferSPTR buffer;
-	BufferSPTR outBuffer;
-
-	// Reap output buffers
-	while (audioOutPin->TryGetAvailableBuffer(&buffer))
-	{
-		// New buffers are created as needed so just
-		// drop this buffer.
-		Wake();
-	}
 
+	// Returned output buffers stay in audioOutPin
+	// and are recycled by GetPcmBuffer.
 
 	if (audioInPin->TryGetFilledBuffer(&buffer))
 	{
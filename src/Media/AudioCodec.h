@@ -44,9 +44,11 @@ class AudioCodecElement : public Element
 	int outputChannels = 0;
 	int sampleRate = 0;
 	AVFrameBufferSPTR frame;
+	int pcmBufferCount = 0;
 
 
 	void SetupCodec();
+	PcmDataBufferSPTR GetPcmBuffer(PcmFormat format, int channels, int samples);
 	void ProcessBuffer(AVPacketBufferSPTR buffer, AVFrameBufferSPTR frame);
 
 
@@ -0,0 +1,996 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#include "Bitstream.h"
+
+#include "Exception.h"
+
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define BITSTREAM_NEON
+#endif
+
+
+
+const unsigned char Bitstream::startCode[4] = { 0x00, 0x00, 0x00, 0x01 };
+
+
+
+int Bitstream::FindStartCodeScalar(const unsigned char* data, int length, int offset)
+{
+	if (data == nullptr)
+		throw ArgumentNullException("data");
+
+
+	int i = offset;
+	while (i + 2 < length)
+	{
+		// A start code can not begin at a position whose third byte
+		// rules it out, so skip as far as the bytes allow.
+		if (data[i + 2] > 1)
+		{
+			i += 3;
+		}
+		else if (data[i + 1] != 0)
+		{
+			i += 2;
+		}
+		else if (data[i] != 0 || data[i + 2] != 1)
+		{
+			i += 1;
+		}
+		else
+		{
+			return i;
+		}
+	}
+
+	return length;
+}
+
+int Bitstream::FindStartCode(const unsigned char* data, int length, int offset)
+{
+	if (data == nullptr)
+		throw ArgumentNullException("data");
+
+
+	// Blocks of 16 without a zero byte can not hold the start of a
+	// start code.  The two bytes after a block are read when checking
+	// its last positions.
+	int i = offset;
+
+#if defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128();
+
+	while (i + 16 + 2 <= length)
+	{
+		__m128i block = _mm_loadu_si128((const __m128i*)(data + i));
+		int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, zero));
+
+		while (mask != 0)
+		{
+			int j = i + __builtin_ctz(mask);
+			if (data[j + 1] == 0 && data[j + 2] == 1)
+			{
+				return j;
+			}
+
+			mask &= mask - 1;
+		}
+
+		i += 16;
+	}
+#elif defined(BITSTREAM_NEON)
+	const uint8x16_t zero = vdupq_n_u8(0);
+
+	while (i + 16 + 2 <= length)
+	{
+		uint8x16_t isZero = vceqq_u8(vld1q_u8(data + i), zero);
+		uint8x8_t folded = vorr_u8(vget_low_u8(isZero), vget_high_u8(isZero));
+
+		if (vget_lane_u64(vreinterpret_u64_u8(folded), 0) != 0)
+		{
+			for (int j = i; j < i + 16; ++j)
+			{
+				if (data[j] == 0 && data[j + 1] == 0 && data[j + 2] == 1)
+				{
+					return j;
+				}
+			}
+		}
+
+		i += 16;
+	}
+#endif
+
+	return FindStartCodeScalar(data, length, i);
+}
+
+void Bitstream::SplitAnnexB(const unsigned char* data, int length, std::vector<NalUnit>* outUnits)
+{
+	if (outUnits == nullptr)
+		throw ArgumentNullException("outUnits");
+
+
+	int start = FindStartCode(data, length, 0);
+	while (start < length)
+	{
+		int unitStart = start + 3;
+		int next = FindStartCode(data, length, unitStart);
+
+		int unitEnd = next;
+		while (unitEnd > unitStart && data[unitEnd - 1] == 0)
+		{
+			--unitEnd;
+		}
+
+		if (unitEnd > unitStart)
+		{
+			NalUnit unit;
+			unit.Data = data + unitStart;
+			unit.Length = unitEnd - unitStart;
+
+			outUnits->push_back(unit);
+		}
+
+		start = next;
+	}
+}
+
+bool Bitstream::SplitLengthPrefixed(const unsigned char* data, int length, int prefixLength, std::vector<NalUnit>* outUnits)
+{
+	if (data == nullptr)
+		throw ArgumentNullException("data");
+
+	if (prefixLength < 1 || prefixLength > 4)
+		throw ArgumentOutOfRangeException("prefixLength");
+
+	if (outUnits == nullptr)
+		throw ArgumentNullException("outUnits");
+
+
+	size_t count = outUnits->size();
+
+	int offset = 0;
+	while (offset < length)
+	{
+		if (length - offset < prefixLength)
+		{
+			outUnits->resize(count);
+			return false;
+		}
+
+		uint32_t unitLength = 0;
+		for (int i = 0; i < prefixLength; ++i)
+		{
+			unitLength = (unitLength << 8) | data[offset + i];
+		}
+
+		offset += prefixLength;
+
+		if (unitLength > (uint32_t)(length - offset))
+		{
+			outUnits->resize(count);
+			return false;
+		}
+
+		NalUnit unit;
+		unit.Data = data + offset;
+		unit.Length = (int)unitLength;
+
+		outUnits->push_back(unit);
+
+		offset += unitLength;
+	}
+
+	return true;
+}
+
+bool Bitstream::LengthPrefixedToAnnexB(unsigned char* data, int length, int prefixLength, std::vector<NalUnit>* outUnits)
+{
+	if (prefixLength != 3 && prefixLength != 4)
+		throw ArgumentOutOfRangeException("prefixLength");
+
+
+	size_t first = outUnits ? outUnits->size() : 0;
+
+	std::vector<NalUnit> units;
+	std::vector<NalUnit>* target = outUnits ? outUnits : &units;
+
+	if (!SplitLengthPrefixed(data, length, prefixLength, target))
+		return false;
+
+
+	const unsigned char* code = startCode + (4 - prefixLength);
+	for (size_t i = first; i < target->size(); ++i)
+	{
+		unsigned char* prefix = (unsigned char*)(*target)[i].Data - prefixLength;
+		for (int j = 0; j < prefixLength; ++j)
+		{
+			prefix[j] = code[j];
+		}
+	}
+
+	return true;
+}
+
+void Bitstream::AppendAnnexB(const std::vector<NalUnit>& units, std::vector<iovec>* outVectors)
+{
+	if (outVectors == nullptr)
+		throw ArgumentNullException("outVectors");
+
+
+	for (auto& unit : units)
+	{
+		iovec vector;
+
+		vector.iov_base = (void*)startCode;
+		vector.iov_len = sizeof(startCode);
+		outVectors->push_back(vector);
+
+		vector.iov_base = (void*)unit.Data;
+		vector.iov_len = unit.Length;
+		outVectors->push_back(vector);
+	}
+}
+
+bool Bitstream::AnnexBToLengthPrefixed(const unsigned char* data, int length, int prefixLength, std::vector<unsigned char>* output)
+{
+	if (prefixLength < 1 || prefixLength > 4)
+		throw ArgumentOutOfRangeException("prefixLength");
+
+	if (output == nullptr)
+		throw ArgumentNullException("output");
+
+
+	std::vector<NalUnit> units;
+	SplitAnnexB(data, length, &units);
+
+	size_t total = 0;
+	for (auto& unit : units)
+	{
+		if (prefixLength < 4 && (uint32_t)unit.Length >= (1u << (prefixLength * 8)))
+			return false;
+
+		total += prefixLength + unit.Length;
+	}
+
+
+	size_t offset = output->size();
+	output->resize(offset + total);
+
+	unsigned char* dest = output->data() + offset;
+	for (auto& unit : units)
+	{
+		for (int i = prefixLength - 1; i >= 0; --i)
+		{
+			*dest++ = (unit.Length >> (i * 8)) & 0xff;
+		}
+
+		memcpy(dest, unit.Data, unit.Length);
+		dest += unit.Length;
+	}
+
+	return true;
+}
+
+// 'count' units behind 16 bit lengths, as avcC and hvcC store them
+static bool ReadConfigurationUnits(const unsigned char* data, int length, int* offset, int count, std::vector<NalUnit>* outUnits)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		if (length - *offset < 2)
+			return false;
+
+		int unitLength = (data[*offset] << 8) | data[*offset + 1];
+		*offset += 2;
+
+		if (unitLength > length - *offset)
+			return false;
+
+		NalUnit unit;
+		unit.Data = data + *offset;
+		unit.Length = unitLength;
+
+		outUnits->push_back(unit);
+
+		*offset += unitLength;
+	}
+
+	return true;
+}
+
+bool Bitstream::ParseDecoderConfiguration(VideoFormatEnum format, const unsigned char* data, int length,
+	int* outPrefixLength, std::vector<NalUnit>* outUnits)
+{
+	if (data == nullptr)
+		throw ArgumentNullException("data");
+
+	if (outPrefixLength == nullptr)
+		throw ArgumentNullException("outPrefixLength");
+
+	if (outUnits == nullptr)
+		throw ArgumentNullException("outUnits");
+
+
+	std::vector<NalUnit> units;
+	int prefixLength;
+
+	switch (format)
+	{
+		case VideoFormatEnum::Avc:
+		{
+			// configurationVersion, profile, compatibility, level,
+			// lengthSizeMinusOne, numOfSequenceParameterSets
+			const int headerLength = 6;
+
+			if (length < headerLength + 1 || data[0] != 1)
+				return false;
+
+			prefixLength = (data[4] & 3) + 1;
+
+			int offset = headerLength;
+			if (!ReadConfigurationUnits(data, length, &offset, data[5] & 0x1f, &units))
+				return false;
+
+			if (offset >= length)
+				return false;
+
+			int ppsCount = data[offset++];
+			if (!ReadConfigurationUnits(data, length, &offset, ppsCount, &units))
+				return false;
+
+			// High profile chroma and bit depth fields may follow
+		}
+		break;
+
+		case VideoFormatEnum::Hevc:
+		{
+			// 21 bytes of profile, tier and format fields, then
+			// lengthSizeMinusOne and numOfArrays
+			const int headerLength = 23;
+
+			if (length < headerLength || data[0] != 1)
+				return false;
+
+			prefixLength = (data[21] & 3) + 1;
+
+			int offset = headerLength;
+			for (int i = 0; i < data[22]; ++i)
+			{
+				// array_completeness and NAL_unit_type, numNalus
+				if (length - offset < 3)
+					return false;
+
+				int count = (data[offset + 1] << 8) | data[offset + 2];
+				offset += 3;
+
+				if (!ReadConfigurationUnits(data, length, &offset, count, &units))
+					return false;
+			}
+		}
+		break;
+
+		default:
+			throw NotSupportedException();
+	}
+
+	*outPrefixLength = prefixLength;
+	outUnits->insert(outUnits->end(), units.begin(), units.end());
+
+	return true;
+}
+
+NalTypeEnum Bitstream::Classify(VideoFormatEnum format, const unsigned char* nal, int length)
+{
+	if (nal == nullptr || length < 1)
+		return NalTypeEnum::Unknown;
+
+
+	switch (format)
+	{
+		case VideoFormatEnum::Avc:
+		{
+			int type = nal[0] & 0x1f;
+			switch (type)
+			{
+				case 1:
+				case 2:
+				case 3:
+				case 4:
+					return NalTypeEnum::Picture;
+
+				case 5:
+					return NalTypeEnum::KeyPicture;
+
+				case 6:
+					return NalTypeEnum::Sei;
+
+				case 7:
+					return NalTypeEnum::SequenceParameterSet;
+
+				case 8:
+					return NalTypeEnum::PictureParameterSet;
+
+				case 9:
+					return NalTypeEnum::AccessUnitDelimiter;
+
+				case 10:	// end of sequence
+				case 11:	// end of stream
+					return NalTypeEnum::EndOfSequence;
+
+				default:
+					return NalTypeEnum::Other;
+			}
+		}
+
+		case VideoFormatEnum::Hevc:
+		{
+			int type = (nal[0] >> 1) & 0x3f;
+
+			if (type <= 15)
+				return NalTypeEnum::Picture;
+
+			if (type <= 23)		// IRAP, including reserved
+				return NalTypeEnum::KeyPicture;
+
+			switch (type)
+			{
+				case 32:
+					return NalTypeEnum::VideoParameterSet;
+
+				case 33:
+					return NalTypeEnum::SequenceParameterSet;
+
+				case 34:
+					return NalTypeEnum::PictureParameterSet;
+
+				case 35:
+					return NalTypeEnum::AccessUnitDelimiter;
+
+				case 36:	// end of sequence
+				case 37:	// end of bitstream
+					return NalTypeEnum::EndOfSequence;
+
+				case 39:	// prefix
+				case 40:	// suffix
+					return NalTypeEnum::Sei;
+
+				default:
+					return NalTypeEnum::Other;
+			}
+		}
+
+		case VideoFormatEnum::Mpeg2:
+		{
+			int code = nal[0];
+
+			if (code == 0x00)
+			{
+				// picture_coding_type follows the 10 bit temporal_reference
+				if (length < 3)
+					return NalTypeEnum::Unknown;
+
+				int codingType = (nal[2] >> 3) & 0x07;
+				return (codingType == 1) ? NalTypeEnum::KeyPicture : NalTypeEnum::Picture;
+			}
+
+			if (code <= 0xaf)	// slices
+				return NalTypeEnum::Picture;
+
+			switch (code)
+			{
+				case 0xb3:
+					return NalTypeEnum::SequenceParameterSet;
+
+				case 0xb7:
+					return NalTypeEnum::EndOfSequence;
+
+				case 0xb8:
+					return NalTypeEnum::EntryPoint;
+
+				default:
+					return NalTypeEnum::Other;
+			}
+		}
+
+		case VideoFormatEnum::VC1:
+		{
+			switch (nal[0])
+			{
+				case 0x0a:
+					return NalTypeEnum::EndOfSequence;
+
+				case 0x0b:	// slice
+				case 0x0c:	// field
+				case 0x0d:	// frame
+					return NalTypeEnum::Picture;
+
+				case 0x0e:
+					return NalTypeEnum::EntryPoint;
+
+				case 0x0f:
+					return NalTypeEnum::SequenceParameterSet;
+
+				default:
+					return NalTypeEnum::Other;
+			}
+		}
+
+		default:
+			return NalTypeEnum::Unknown;
+	}
+}
+
+void Bitstream::RemoveEmulationPrevention(const unsigned char* data, int length, std::vector<unsigned char>* output)
+{
+	if (data == nullptr)
+		throw ArgumentNullException("data");
+
+	if (output == nullptr)
+		throw ArgumentNullException("output");
+
+
+	output->clear();
+	output->reserve(length);
+
+	int zeros = 0;
+	for (int i = 0; i < length; ++i)
+	{
+		unsigned char value = data[i];
+
+		if (zeros >= 2 && value == 0x03)
+		{
+			zeros = 0;
+			continue;
+		}
+
+		zeros = (value == 0) ? zeros + 1 : 0;
+		output->push_back(value);
+	}
+}
+
+
+
+// Larger than any level of H.264 or HEVC allows
+static const unsigned int MAX_DIMENSION = 16384;
+
+
+// Reads the left, right, top and bottom offsets of an H.264 frame
+// crop or HEVC conformance window and removes them from the size.
+// Offsets count in chroma samples, scaled by 'unitX' and 'unitY'
+// for the luma plane.
+static bool ApplyCrop(BitReader* reader, int unitX, int unitY, unsigned int chromaFormat, int* width, int* height)
+{
+	unsigned int left = reader->ReadUE();
+	unsigned int right = reader->ReadUE();
+	unsigned int top = reader->ReadUE();
+	unsigned int bottom = reader->ReadUE();
+
+	if (left > MAX_DIMENSION || right > MAX_DIMENSION ||
+		top > MAX_DIMENSION || bottom > MAX_DIMENSION)
+	{
+		return false;
+	}
+
+	if (chromaFormat == 1 || chromaFormat == 2)
+	{
+		unitX *= 2;
+	}
+
+	if (chromaFormat == 1)
+	{
+		unitY *= 2;
+	}
+
+	*width -= (int)(left + right) * unitX;
+	*height -= (int)(top + bottom) * unitY;
+
+	return true;
+}
+
+static void SkipH264ScalingList(BitReader* reader, int size)
+{
+	int lastScale = 8;
+	int nextScale = 8;
+
+	for (int i = 0; i < size; ++i)
+	{
+		if (nextScale != 0)
+		{
+			int delta = reader->ReadSE();
+			nextScale = (lastScale + delta + 256) % 256;
+		}
+
+		lastScale = (nextScale == 0) ? lastScale : nextScale;
+	}
+}
+
+static bool ParseH264Sps(BitReader* reader, SequenceInfo* info)
+{
+	int profile = reader->ReadBits(8);
+	reader->SkipBits(8);	// constraint flags
+	int level = reader->ReadBits(8);
+	reader->ReadUE();		// seq_parameter_set_id
+
+	unsigned int chromaFormat = 1;
+	bool isSeparateColourPlane = false;
+
+	switch (profile)
+	{
+		case 100:
+		case 110:
+		case 122:
+		case 244:
+		case 44:
+		case 83:
+		case 86:
+		case 118:
+		case 128:
+		case 138:
+		case 139:
+		case 134:
+		case 135:
+		{
+			chromaFormat = reader->ReadUE();
+			if (chromaFormat > 3)
+				return false;
+
+			if (chromaFormat == 3)
+			{
+				isSeparateColourPlane = reader->ReadBit();
+			}
+
+			reader->ReadUE();	// bit_depth_luma_minus8
+			reader->ReadUE();	// bit_depth_chroma_minus8
+			reader->ReadBit();	// qpprime_y_zero_transform_bypass_flag
+
+			if (reader->ReadBit())	// seq_scaling_matrix_present_flag
+			{
+				int count = (chromaFormat == 3) ? 12 : 8;
+				for (int i = 0; i < count; ++i)
+				{
+					if (reader->ReadBit())
+					{
+						SkipH264ScalingList(reader, (i < 6) ? 16 : 64);
+					}
+				}
+			}
+		}
+		break;
+
+		default:
+			break;
+	}
+
+	reader->ReadUE();	// log2_max_frame_num_minus4
+
+	int pocType = reader->ReadUE();
+	if (pocType == 0)
+	{
+		reader->ReadUE();	// log2_max_pic_order_cnt_lsb_minus4
+	}
+	else if (pocType == 1)
+	{
+		reader->ReadBit();	// delta_pic_order_always_zero_flag
+		reader->ReadSE();	// offset_for_non_ref_pic
+		reader->ReadSE();	// offset_for_top_to_bottom_field
+
+		int cycle = reader->ReadUE();
+		for (int i = 0; i < cycle && !reader->IsOverrun(); ++i)
+		{
+			reader->ReadSE();
+		}
+	}
+
+	reader->ReadUE();	// max_num_ref_frames
+	reader->ReadBit();	// gaps_in_frame_num_value_allowed_flag
+
+	unsigned int widthInMbs = reader->ReadUE() + 1;
+	unsigned int heightInMapUnits = reader->ReadUE() + 1;
+	int isFrameMbsOnly = reader->ReadBit();
+
+	if (!isFrameMbsOnly)
+	{
+		reader->ReadBit();	// mb_adaptive_frame_field_flag
+	}
+
+	reader->ReadBit();	// direct_8x8_inference_flag
+
+	// ue(v) reaches 2^32 - 2, so bound the sizes before multiplying
+	if (widthInMbs > MAX_DIMENSION / 16 ||
+		heightInMapUnits > MAX_DIMENSION / 16 / (2 - isFrameMbsOnly))
+	{
+		return false;
+	}
+
+	int width = (int)widthInMbs * 16;
+	int height = (2 - isFrameMbsOnly) * (int)heightInMapUnits * 16;
+
+	if (reader->ReadBit())	// frame_cropping_flag
+	{
+		if (!ApplyCrop(reader, 1, 2 - isFrameMbsOnly,
+			isSeparateColourPlane ? 0 : chromaFormat, &width, &height))
+		{
+			return false;
+		}
+	}
+
+	double frameRate = 0;
+
+	if (reader->ReadBit())	// vui_parameters_present_flag
+	{
+		if (reader->ReadBit())	// aspect_ratio_info_present_flag
+		{
+			if (reader->ReadBits(8) == 255)		// Extended_SAR
+			{
+				reader->SkipBits(32);
+			}
+		}
+
+		if (reader->ReadBit())	// overscan_info_present_flag
+		{
+			reader->ReadBit();
+		}
+
+		if (reader->ReadBit())	// video_signal_type_present_flag
+		{
+			reader->SkipBits(4);
+			if (reader->ReadBit())	// colour_description_present_flag
+			{
+				reader->SkipBits(24);
+			}
+		}
+
+		if (reader->ReadBit())	// chroma_loc_info_present_flag
+		{
+			reader->ReadUE();
+			reader->ReadUE();
+		}
+
+		if (reader->ReadBit())	// timing_info_present_flag
+		{
+			unsigned int unitsInTick = reader->ReadBits(32);
+			unsigned int timeScale = reader->ReadBits(32);
+
+			if (unitsInTick > 0)
+			{
+				frameRate = timeScale / (2.0 * unitsInTick);
+			}
+		}
+	}
+
+	if (reader->IsOverrun() || width <= 0 || height <= 0)
+		return false;
+
+	info->Width = width;
+	info->Height = height;
+	info->FrameRate = frameRate;
+	info->Profile = profile;
+	info->Level = level;
+
+	return true;
+}
+
+static bool ParseHevcSps(BitReader* reader, SequenceInfo* info)
+{
+	reader->SkipBits(4);	// sps_video_parameter_set_id
+	int maxSubLayersMinus1 = reader->ReadBits(3);
+	reader->SkipBits(1);	// sps_temporal_id_nesting_flag
+
+	// profile_tier_level
+	reader->SkipBits(3);	// general_profile_space, general_tier_flag
+	int profile = reader->ReadBits(5);
+	reader->SkipBits(32);	// general_profile_compatibility_flag
+	reader->SkipBits(48);	// source flags and reserved bits
+	int level = reader->ReadBits(8);
+
+	bool isProfilePresent[8] = { false };
+	bool isLevelPresent[8] = { false };
+
+	for (int i = 0; i < maxSubLayersMinus1; ++i)
+	{
+		isProfilePresent[i] = reader->ReadBit();
+		isLevelPresent[i] = reader->ReadBit();
+	}
+
+	if (maxSubLayersMinus1 > 0)
+	{
+		reader->SkipBits(2 * (8 - maxSubLayersMinus1));
+	}
+
+	for (int i = 0; i < maxSubLayersMinus1; ++i)
+	{
+		if (isProfilePresent[i])
+		{
+			reader->SkipBits(88);
+		}
+
+		if (isLevelPresent[i])
+		{
+			reader->SkipBits(8);
+		}
+	}
+
+	reader->ReadUE();	// sps_seq_parameter_set_id
+
+	unsigned int chromaFormat = reader->ReadUE();
+	if (chromaFormat > 3)
+		return false;
+
+	bool isSeparateColourPlane = false;
+	if (chromaFormat == 3)
+	{
+		isSeparateColourPlane = reader->ReadBit();
+	}
+
+	unsigned int lumaWidth = reader->ReadUE();
+	unsigned int lumaHeight = reader->ReadUE();
+
+	if (lumaWidth > MAX_DIMENSION || lumaHeight > MAX_DIMENSION)
+		return false;
+
+	int width = (int)lumaWidth;
+	int height = (int)lumaHeight;
+
+	if (reader->ReadBit())	// conformance_window_flag
+	{
+		if (!ApplyCrop(reader, 1, 1,
+			isSeparateColourPlane ? 0 : chromaFormat, &width, &height))
+		{
+			return false;
+		}
+	}
+
+	if (reader->IsOverrun() || width <= 0 || height <= 0)
+		return false;
+
+	info->Width = width;
+	info->Height = height;
+	info->FrameRate = 0;
+	info->Profile = profile;
+	info->Level = level;
+
+	return true;
+}
+
+static bool ParseMpeg2SequenceHeader(BitReader* reader, SequenceInfo* info)
+{
+	static const double frameRates[] =
+	{
+		0, 24000.0 / 1001.0, 24, 25, 30000.0 / 1001.0, 30, 50, 60000.0 / 1001.0, 60
+	};
+
+	int width = reader->ReadBits(12);
+	int height = reader->ReadBits(12);
+	reader->SkipBits(4);	// aspect_ratio_information
+	unsigned int frameRateCode = reader->ReadBits(4);
+
+	if (reader->IsOverrun() || width <= 0 || height <= 0)
+		return false;
+
+	info->Width = width;
+	info->Height = height;
+	info->FrameRate = (frameRateCode < sizeof(frameRates) / sizeof(frameRates[0])) ? frameRates[frameRateCode] : 0;
+	info->Profile = 0;	// in the sequence extension
+	info->Level = 0;
+
+	return true;
+}
+
+static bool ParseVc1SequenceHeader(BitReader* reader, SequenceInfo* info)
+{
+	int profile = reader->ReadBits(2);
+	if (profile != 3)	// only the advanced profile uses start codes
+		return false;
+
+	int level = reader->ReadBits(3);
+	reader->SkipBits(2 + 3 + 5 + 1);	// colordiff, frmrtq, bitrtq, postprocflag
+
+	int width = (reader->ReadBits(12) + 1) * 2;
+	int height = (reader->ReadBits(12) + 1) * 2;
+
+	reader->SkipBits(6);	// pulldown, interlace, tfcntr, finterp, reserved, psf
+
+	double frameRate = 0;
+
+	if (reader->ReadBit())	// display_ext
+	{
+		reader->SkipBits(14 + 14);	// display size
+
+		if (reader->ReadBit())	// aspect_ratio_flag
+		{
+			if (reader->ReadBits(4) == 15)
+			{
+				reader->SkipBits(16);
+			}
+		}
+
+		if (reader->ReadBit())	// framerate_flag
+		{
+			if (reader->ReadBit())	// framerateind
+			{
+				frameRate = (reader->ReadBits(16) + 1) / 32.0;
+			}
+			else
+			{
+				static const double numerators[] = { 0, 24, 25, 30, 50, 60, 48, 72 };
+
+				unsigned int numerator = reader->ReadBits(8);
+				unsigned int denominator = reader->ReadBits(4);
+
+				if (numerator > 0 && numerator < 8 &&
+					(denominator == 1 || denominator == 2))
+				{
+					frameRate = numerators[numerator] * 1000.0 / ((denominator == 1) ? 1000.0 : 1001.0);
+				}
+			}
+		}
+	}
+
+	if (reader->IsOverrun())
+		return false;
+
+	info->Width = width;
+	info->Height = height;
+	info->FrameRate = frameRate;
+	info->Profile = profile;
+	info->Level = level;
+
+	return true;
+}
+
+bool Bitstream::ParseSequenceHeader(VideoFormatEnum format, const unsigned char* nal, int length, SequenceInfo* outInfo)
+{
+	if (outInfo == nullptr)
+		throw ArgumentNullException("outInfo");
+
+	if (Classify(format, nal, length) != NalTypeEnum::SequenceParameterSet)
+		return false;
+
+
+	// Skip the NAL unit header or start code value
+	int headerLength = (format == VideoFormatEnum::Hevc) ? 2 : 1;
+	if (length <= headerLength)
+		return false;
+
+	std::vector<unsigned char> rbsp;
+	RemoveEmulationPrevention(nal + headerLength, length - headerLength, &rbsp);
+
+	BitReader reader(rbsp.data(), rbsp.size());
+
+	switch (format)
+	{
+		case VideoFormatEnum::Avc:
+			return ParseH264Sps(&reader, outInfo);
+
+		case VideoFormatEnum::Hevc:
+			return ParseHevcSps(&reader, outInfo);
+
+		case VideoFormatEnum::Mpeg2:
+			return ParseMpeg2SequenceHeader(&reader, outInfo);
+
+		case VideoFormatEnum::VC1:
+			return ParseVc1SequenceHeader(&reader, outInfo);
+
+		default:
+			return false;
+	}
+}
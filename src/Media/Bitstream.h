@@ -0,0 +1,203 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#pragma once
+
+#include "Pin.h"
+
+#include <sys/uio.h>
+#include <stdint.h>
+#include <vector>
+
+
+
+// What a NAL unit (H.264, HEVC) or start code unit (MPEG-2, VC-1)
+// carries.  The parameter set values are in VPS, SPS, PPS order.
+enum class NalTypeEnum
+{
+	Unknown = 0,
+	Picture,				// coded picture or slice data
+	KeyPicture,				// H.264 IDR, HEVC IRAP, MPEG-2 I picture
+	VideoParameterSet,		// HEVC VPS
+	SequenceParameterSet,	// H.264/HEVC SPS, MPEG-2/VC-1 sequence header
+	PictureParameterSet,	// H.264/HEVC PPS
+	EntryPoint,				// MPEG-2 GOP, VC-1 entry point
+	Sei,
+	AccessUnitDelimiter,
+	EndOfSequence,
+	Other
+};
+
+
+// A unit within a packet, without its start code or length prefix.
+// For MPEG-2 and VC-1 it starts with the start code value.
+struct NalUnit
+{
+	const unsigned char* Data;
+	int Length;
+};
+
+
+struct SequenceInfo
+{
+	int Width = 0;
+	int Height = 0;
+	double FrameRate = 0;	// 0 when the header does not say
+	int Profile = 0;
+	int Level = 0;
+};
+
+
+
+// Reads an RBSP (emulation prevention bytes removed) MSB first.
+// Reads past the end return zeros and set IsOverrun.
+class BitReader
+{
+	const unsigned char* data;
+	int length;
+	int position = 0;	// in bits
+	bool isOverrun = false;
+
+
+public:
+
+	bool IsOverrun() const
+	{
+		return isOverrun;
+	}
+
+
+
+	BitReader(const unsigned char* data, int length)
+		: data(data), length(length)
+	{
+	}
+
+
+
+	unsigned int ReadBit()
+	{
+		if (position >= length * 8)
+		{
+			isOverrun = true;
+			return 0;
+		}
+
+		unsigned int result = (data[position >> 3] >> (7 - (position & 7))) & 1;
+		++position;
+
+		return result;
+	}
+
+	unsigned int ReadBits(int count)
+	{
+		unsigned int result = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			result = (result << 1) | ReadBit();
+		}
+
+		return result;
+	}
+
+	void SkipBits(int count)
+	{
+		position += count;
+		if (position > length * 8)
+		{
+			isOverrun = true;
+		}
+	}
+
+	// Exp-Golomb ue(v)
+	unsigned int ReadUE()
+	{
+		int zeros = 0;
+		while (ReadBit() == 0)
+		{
+			if (isOverrun || zeros >= 31)
+			{
+				isOverrun = true;
+				return 0;
+			}
+
+			++zeros;
+		}
+
+		return ((1u << zeros) - 1) + ReadBits(zeros);
+	}
+
+	// Exp-Golomb se(v)
+	int ReadSE()
+	{
+		unsigned int value = ReadUE();
+		return (value & 1) ? (int)((value + 1) / 2) : -(int)(value / 2);
+	}
+};
+
+
+
+// Elementary stream helpers shared by the video sinks and decoders.
+//
+// Start code scanning uses SSE2 or NEON when the compiler targets
+// them and falls back to FindStartCodeScalar otherwise.  Nothing
+// here trusts the stream: lengths are checked against the buffer
+// and malformed input is reported, not followed.
+class Bitstream
+{
+	static const unsigned char startCode[4];
+
+
+public:
+
+	// Offset of the next 00 00 01 at or after 'offset', or 'length'
+	static int FindStartCode(const unsigned char* data, int length, int offset = 0);
+	static int FindStartCodeScalar(const unsigned char* data, int length, int offset = 0);
+
+	// Start code delimited units.  Zero bytes before a start code are
+	// not part of the preceding unit.
+	static void SplitAnnexB(const unsigned char* data, int length, std::vector<NalUnit>* outUnits);
+
+	// Units behind 'prefixLength' (1-4) byte big endian lengths.
+	// Returns false if a length runs past the end of the data.
+	static bool SplitLengthPrefixed(const unsigned char* data, int length, int prefixLength, std::vector<NalUnit>* outUnits);
+
+	// In place: the prefixes (3 or 4 bytes) become start codes of the
+	// same size.  The data is left untouched when it is malformed.
+	static bool LengthPrefixedToAnnexB(unsigned char* data, int length, int prefixLength, std::vector<NalUnit>* outUnits);
+
+	// Appends a start code and a payload vector per unit
+	static void AppendAnnexB(const std::vector<NalUnit>& units, std::vector<iovec>* outVectors);
+
+	// Returns false if a unit is too long for the prefix
+	static bool AnnexBToLengthPrefixed(const unsigned char* data, int length, int prefixLength, std::vector<unsigned char>* output);
+
+	// avcC (H.264) or hvcC (HEVC) decoder configuration record: the
+	// length prefix size and every parameter set, pointing into
+	// 'data'.  Returns false, leaving the outputs untouched, if the
+	// record is truncated or a count or length runs past its end.
+	static bool ParseDecoderConfiguration(VideoFormatEnum format, const unsigned char* data, int length,
+		int* outPrefixLength, std::vector<NalUnit>* outUnits);
+
+	static NalTypeEnum Classify(VideoFormatEnum format, const unsigned char* nal, int length);
+
+	static void RemoveEmulationPrevention(const unsigned char* data, int length, std::vector<unsigned char>* output);
+
+	// H.264/HEVC SPS, MPEG-2 or VC-1 (advanced profile) sequence
+	// header.  HEVC frame rates are in the VUI behind the reference
+	// picture sets and are not parsed.
+	static bool ParseSequenceHeader(VideoFormatEnum format, const unsigned char* nal, int length, SequenceInfo* outInfo);
+};
@@ -0,0 +1,637 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+
+#include "BitstreamFilterElement.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+
+void BitstreamFilterElement::SetupFilter(VideoPinInfoSPTR info)
+{
+	videoFormat = info->Format;
+
+	if (info->ExtraData)
+	{
+		extraData = *(info->ExtraData);
+	}
+
+	outInfo->Format = info->Format;
+	outInfo->Width = info->Width;
+	outInfo->Height = info->Height;
+	outInfo->FrameRate = info->FrameRate;
+	outInfo->ExtraData = info->ExtraData;
+	outInfo->HasEstimatedPts = info->HasEstimatedPts;
+	outInfo->IsDecoderReady = true;
+
+	printf("BitstreamFilter: ExtraData size=%ld\n", (long int)extraData.size());
+
+	// avcC and hvcC start with configurationVersion 1;
+	// Annex-B extra data is not used.
+	if (extraData.size() > 0 && extraData[0] == 1 &&
+		(videoFormat == VideoFormatEnum::Avc || videoFormat == VideoFormatEnum::Hevc))
+	{
+		if (!ParseExtraData())
+		{
+			// The stream may still carry its parameter sets in-band
+			printf("BitstreamFilter: Malformed avcC/hvcC extra data ignored.\n");
+			return;
+		}
+
+		BuildAnnexBExtraData();
+
+		for (auto& item : parameterSets)
+		{
+			SequenceInfo sequence;
+			if (item.Type == NalTypeEnum::SequenceParameterSet &&
+				Bitstream::ParseSequenceHeader(videoFormat, item.Data.data(), item.Data.size(), &sequence))
+			{
+				printf("BitstreamFilter: SPS %dx%d fps=%f profile=%d level=%d\n",
+					sequence.Width, sequence.Height, sequence.FrameRate, sequence.Profile, sequence.Level);
+
+				// Some containers do not give a rate
+				if (outInfo->FrameRate <= 0 && sequence.FrameRate > 0)
+				{
+					outInfo->FrameRate = sequence.FrameRate;
+				}
+			}
+		}
+	}
+}
+
+bool BitstreamFilterElement::TryGetOutputBuffer()
+{
+	BufferSPTR buffer;
+
+	while (videoOutPin->TryGetAvailableBuffer(&buffer))
+	{
+		// Markers sent downstream come back here too; only
+		// packets are recycled.
+		if (buffer->Type() == BufferTypeEnum::AVPacket)
+		{
+			spareBuffer = std::static_pointer_cast<AVPacketBuffer>(buffer);
+			return true;
+		}
+	}
+
+
+	// Bounded so a blocked sink also stalls the source
+	if (outputBufferCount < MAX_OUTPUT_BUFFERS)
+	{
+		spareBuffer = std::make_shared<AVPacketBuffer>(shared_from_this());
+		++outputBufferCount;
+
+		return true;
+	}
+
+	return false;
+}
+
+// Returns false if the packet was dropped
+bool BitstreamFilterElement::ProcessBuffer(AVPacketBufferSPTR buffer, AVPacketBufferSPTR outBuffer)
+{
+	AVPacket* pkt = buffer->GetAVPacket();
+
+
+	if (isFirstVideoPacket)
+	{
+		unsigned char* nalHeader = (unsigned char*)pkt->data;
+
+		printf("Header (pkt.size=%x):\n", pkt->size);
+		for (int j = 0; j < 16 && j < pkt->size; ++j)	//nalHeaderLength
+		{
+			printf("%02x ", nalHeader[j]);
+		}
+		printf("\n");
+
+		if (pkt->size >= 4 &&
+			nalHeader[0] == 0 && nalHeader[1] == 0 &&
+			nalHeader[2] == 0 && nalHeader[3] == 1)
+		{
+			isAnnexB = true;
+		}
+
+		isFirstVideoPacket = false;
+
+		printf("isAnnexB=%u\n", isAnnexB);
+	}
+
+
+	// The access unit is gathered from a header or extra data
+	// vector (if any) followed by the packet.  Unless the packet was
+	// split, the header travels with a reference to the packet and
+	// the sink writes both with one writev.
+	vectors.clear();
+	bool isValid = true;
+	bool isPacketSplit = false;	// the packet went in as per-unit vectors
+
+	if (isAnnexB)
+	{
+		// Sent as is
+	}
+	else if (videoFormat == VideoFormatEnum::Avc ||
+		videoFormat == VideoFormatEnum::Hevc)
+	{
+		// 3 and 4 byte length prefixes become start codes in place;
+		// shorter ones, and payloads shared read-only by a tee, are
+		// gathered as start code and payload vectors.
+		nalUnits.clear();
+		bool isConvertedInPlace = (nalLengthSize >= 3 && !buffer->IsReadOnly());
+
+		if (isConvertedInPlace)
+		{
+			isValid = Bitstream::LengthPrefixedToAnnexB(pkt->data, pkt->size, nalLengthSize, &nalUnits);
+		}
+		else
+		{
+			isValid = Bitstream::SplitLengthPrefixed(pkt->data, pkt->size, nalLengthSize, &nalUnits);
+		}
+
+		if (!isValid)
+		{
+			printf("BitstreamFilter: Invalid NAL lengths, packet dropped (pkt->size=%d).\n", pkt->size);
+
+			statsMutex.Lock();
+			++stats.Dropped;
+			statsMutex.Unlock();
+
+			return false;
+		}
+
+
+		bool isKeyPicture = false;
+		std::vector<ParameterSet> inBand;
+
+		for (auto& unit : nalUnits)
+		{
+			NalTypeEnum type = Bitstream::Classify(videoFormat, unit.Data, unit.Length);
+
+			switch (type)
+			{
+				case NalTypeEnum::VideoParameterSet:
+				case NalTypeEnum::SequenceParameterSet:
+				case NalTypeEnum::PictureParameterSet:
+				{
+					ParameterSet parameterSet;
+					parameterSet.Type = type;
+					parameterSet.Data.assign(unit.Data, unit.Data + unit.Length);
+
+					inBand.push_back(parameterSet);
+				}
+				break;
+
+				default:
+					break;
+			}
+
+			if (type == NalTypeEnum::KeyPicture)
+			{
+				isKeyPicture = true;
+			}
+		}
+
+		if (inBand.size() > 0)
+		{
+			UpdateParameterSets(inBand);
+		}
+
+		// Prepend extradata to the first frame and to H.264 IDR and
+		// HEVC IRAP frames.  Frames converted in place go out as a
+		// reference to the packet, the extradata as its header.
+		if (!isExtraDataSent || isKeyPicture)
+		{
+			isExtraDataSent = true;
+
+			if (!isVideoExtraDataValid)
+			{
+				BuildAnnexBExtraData();
+			}
+
+			if (videoExtraData.size() > 0)
+			{
+				iovec vector;
+				vector.iov_base = &videoExtraData[0];
+				vector.iov_len = videoExtraData.size();
+
+				vectors.push_back(vector);
+			}
+		}
+
+		if (!isConvertedInPlace)
+		{
+			Bitstream::AppendAnnexB(nalUnits, &vectors);
+			isPacketSplit = true;
+		}
+	}
+	else if (videoFormat == VideoFormatEnum::Mpeg4V3)
+	{
+		Divx3Header(outInfo->Width, outInfo->Height, pkt->size);
+		isVideoExtraDataValid = false;
+
+		iovec vector;
+		vector.iov_base = &videoExtraData[0];
+		vector.iov_len = videoExtraData.size();
+
+		vectors.push_back(vector);
+	}
+
+	if (!isPacketSplit)
+	{
+		iovec vector;
+		vector.iov_base = pkt->data;
+		vector.iov_len = pkt->size;
+
+		vectors.push_back(vector);
+	}
+
+
+	outBuffer->Reset();
+	AVPacket* outPkt = outBuffer->GetAVPacket();
+	bool isPassedThrough = false;
+	size_t size = 0;
+
+	if (!isPacketSplit)
+	{
+		// The payload is shared; only a header is copied
+		if (av_packet_ref(outPkt, pkt) < 0)
+		{
+			throw Exception("BitstreamFilterElement: av_packet_ref failed.");
+		}
+
+		if (vectors.size() > 1)
+		{
+			outBuffer->SetHeader((unsigned char*)vectors[0].iov_base, vectors[0].iov_len);
+			size = vectors[0].iov_len;
+		}
+
+		isPassedThrough = true;
+	}
+	else
+	{
+		for (auto& vector : vectors)
+		{
+			size += vector.iov_len;
+		}
+
+		packetPool.NewPacket(outPkt, (int)size);
+
+		unsigned char* dest = outPkt->data;
+		for (auto& vector : vectors)
+		{
+			memcpy(dest, vector.iov_base, vector.iov_len);
+			dest += vector.iov_len;
+		}
+
+		outPkt->pts = pkt->pts;
+		outPkt->dts = pkt->dts;
+		outPkt->duration = pkt->duration;
+		outPkt->flags = pkt->flags;
+		outPkt->stream_index = pkt->stream_index;
+		outPkt->pos = pkt->pos;
+	}
+
+	outBuffer->SetTimeBase(buffer->TimeBase());
+	outBuffer->SetTimeStamp(buffer->TimeStamp());
+
+
+	statsMutex.Lock();
+
+	++stats.Packets;
+	if (isPassedThrough)
+	{
+		++stats.PassedThrough;
+	}
+	stats.BytesCopied += size;
+
+	statsMutex.Unlock();
+
+	return true;
+}
+
+
+
+BitstreamFilterElement::BitstreamFilterElement()
+{
+	// The conversion runs beside the sink's blocking writes
+	SetExecutionMode(ExecutionModeEnum::Dedicated);
+}
+
+
+BitstreamFilterStats BitstreamFilterElement::Stats()
+{
+	statsMutex.Lock();
+	BitstreamFilterStats result = stats;
+	statsMutex.Unlock();
+
+	return result;
+}
+
+
+
+void BitstreamFilterElement::Initialize()
+{
+	ClearOutputPins();
+	ClearInputPins();
+
+	// TODO: Pin format negotiation
+
+	{
+		// Create a video in pin
+		VideoPinInfoSPTR info = std::make_shared<VideoPinInfo>();
+		info->Format = VideoFormatEnum::Unknown;
+		info->FrameRate = 0;
+
+		ElementWPTR weakPtr = shared_from_this();
+		videoInPin = std::make_shared<VideoInPin>(weakPtr, info);
+		AddInputPin(videoInPin);
+	}
+
+	{
+		// Create a video out pin
+		outInfo = std::make_shared<VideoPinInfo>();
+		outInfo->Format = VideoFormatEnum::Unknown;
+		outInfo->FrameRate = 0;
+
+		ElementWPTR weakPtr = shared_from_this();
+		videoOutPin = std::make_shared<OutPin>(weakPtr, outInfo);
+		AddOutputPin(videoOutPin);
+	}
+}
+
+void BitstreamFilterElement::DoWork()
+{
+	BufferSPTR buffer;
+
+	// Returned output buffers stay in videoOutPin.  With all of them
+	// downstream the input waits; a returned buffer wakes the element.
+
+	while (State() == MediaState::Play &&
+		(spareBuffer || TryGetOutputBuffer()) &&
+		videoInPin->TryGetFilledBuffer(&buffer))
+	{
+		switch (buffer->Type())
+		{
+			case BufferTypeEnum::Marker:
+			{
+				MarkerBufferSPTR markerBuffer = std::static_pointer_cast<MarkerBuffer>(buffer);
+
+				switch (markerBuffer->Marker())
+				{
+					case MarkerEnum::EndOfStream:
+					{
+						MarkerBufferSPTR eosBuffer = std::make_shared<MarkerBuffer>(shared_from_this(), MarkerEnum::EndOfStream);
+						videoOutPin->SendBuffer(eosBuffer);
+
+						SetState(MediaState::Pause);
+						break;
+					}
+
+					default:
+						// ignore unknown 
+						break;
+				}
+
+				break;
+			}
+
+			case BufferTypeEnum::AVPacket:
+			{
+				if (isFirstData)
+				{
+					OutPinSPTR otherPin = videoInPin->Source();
+					if (otherPin)
+					{
+						if (otherPin->Info()->Category() != MediaCategoryEnum::Video)
+						{
+							throw InvalidOperationException("BitstreamFilterElement: Not connected to a video pin.");
+						}
+
+						SetupFilter(std::static_pointer_cast<VideoPinInfo>(otherPin->Info()));
+
+						isFirstData = false;
+					}
+				}
+
+				AVPacketBufferSPTR avPacketBuffer = std::static_pointer_cast<AVPacketBuffer>(buffer);
+				if (ProcessBuffer(avPacketBuffer, spareBuffer))
+				{
+					AVPacketBufferSPTR outBuffer = spareBuffer;
+					spareBuffer.reset();
+
+					videoOutPin->SendBuffer(outBuffer);
+				}
+
+				break;
+			}
+
+			default:
+				throw NotSupportedException("Unexpected buffer type.");
+		}
+
+		videoInPin->PushProcessedBuffer(buffer);
+		videoInPin->ReturnProcessedBuffers();
+	}
+}
+
+void BitstreamFilterElement::Terminating()
+{
+	BitstreamFilterStats filterStats = Stats();
+	printf("BitstreamFilterElement: packets=%lu passed through=%lu dropped=%lu copied=%llu bytes\n",
+		filterStats.Packets, filterStats.PassedThrough, filterStats.Dropped, filterStats.BytesCopied);
+
+	PacketBufferPoolStats poolStats = packetPool.Stats();
+	printf("BitstreamFilterElement: new packets=%lu pooled=%lu pool allocations=%lu\n",
+		poolStats.Packets, poolStats.PooledPackets, poolStats.Allocations);
+
+	Element::Terminating();
+}
+
+
+
+void BitstreamFilterElement::Divx3Header(int width, int height, int packetSize)
+{
+	// Bitstream info from Kodi
+
+	videoExtraData.clear();
+
+	videoExtraData.push_back(0x00);
+	videoExtraData.push_back(0x00);
+	videoExtraData.push_back(0x00);
+	videoExtraData.push_back(0x01);
+
+	unsigned i = (width << 12) | (height & 0xfff);
+	videoExtraData.push_back(0x20);
+	videoExtraData.push_back((i >> 16) & 0xff);
+	videoExtraData.push_back((i >> 8) & 0xff);
+	videoExtraData.push_back(i & 0xff);
+	videoExtraData.push_back(0x00);
+	videoExtraData.push_back(0x00);
+
+	const unsigned char divx311_chunk_prefix[] =
+	{
+		0x00, 0x00, 0x00, 0x01,
+		0xb6, 'D', 'I', 'V', 'X', '3', '.', '1', '1'
+	};
+
+	for (size_t i = 0; i < sizeof(divx311_chunk_prefix); ++i)
+	{
+		videoExtraData.push_back(divx311_chunk_prefix[i]);
+	}
+
+	videoExtraData.push_back((packetSize >> 24) & 0xff);
+	videoExtraData.push_back((packetSize >> 16) & 0xff);
+	videoExtraData.push_back((packetSize >> 8) & 0xff);
+	videoExtraData.push_back(packetSize & 0xff);
+}
+
+// Returns false, with no parameter sets, if the record is malformed
+bool BitstreamFilterElement::ParseExtraData()
+{
+	parameterSets.clear();
+	isVideoExtraDataValid = false;
+
+	int prefixLength;
+	std::vector<NalUnit> units;
+
+	if (!Bitstream::ParseDecoderConfiguration(videoFormat, extraData.data(), (int)extraData.size(),
+		&prefixLength, &units))
+	{
+		return false;
+	}
+
+	nalLengthSize = prefixLength;
+
+	for (auto& unit : units)
+	{
+		if (unit.Length < 1)
+			continue;
+
+		ParameterSet parameterSet;
+		parameterSet.Type = Bitstream::Classify(videoFormat, unit.Data, unit.Length);
+		parameterSet.Data.assign(unit.Data, unit.Data + unit.Length);
+		parameterSets.push_back(parameterSet);
+	}
+
+	return true;
+}
+
+// Replaces the cached sets of each type the stream carried in-band.
+// The NAL unit ids are not parsed, so a type is replaced as a whole.
+void BitstreamFilterElement::UpdateParameterSets(const std::vector<ParameterSet>& inBand)
+{
+	std::vector<ParameterSet> updated;
+	bool isChanged = false;
+
+	for (auto& cached : parameterSets)
+	{
+		bool isReplaced = false;
+		for (auto& item : inBand)
+		{
+			if (item.Type == cached.Type)
+			{
+				isReplaced = true;
+				break;
+			}
+		}
+
+		if (!isReplaced)
+		{
+			updated.push_back(cached);
+		}
+	}
+
+	// Unchanged unless the sets of some type differ
+	for (auto& item : inBand)
+	{
+		updated.push_back(item);
+	}
+
+	if (updated.size() != parameterSets.size())
+	{
+		isChanged = true;
+	}
+	else
+	{
+		for (auto& item : inBand)
+		{
+			bool isFound = false;
+			for (auto& cached : parameterSets)
+			{
+				if (cached.Type == item.Type && cached.Data == item.Data)
+				{
+					isFound = true;
+					break;
+				}
+			}
+
+			if (!isFound)
+			{
+				isChanged = true;
+				break;
+			}
+		}
+	}
+
+	if (isChanged)
+	{
+		printf("BitstreamFilter: in-band parameter sets changed.\n");
+
+		// VPS, SPS, PPS order
+		std::stable_sort(updated.begin(), updated.end(),
+			[](const ParameterSet& a, const ParameterSet& b) { return a.Type < b.Type; });
+
+		parameterSets.swap(updated);
+		isVideoExtraDataValid = false;
+	}
+}
+
+void BitstreamFilterElement::BuildAnnexBExtraData()
+{
+	size_t length = 0;
+	for (auto& item : parameterSets)
+	{
+		length += 4 + item.Data.size();
+	}
+
+	videoExtraData.resize(length);
+
+	unsigned char* dest = videoExtraData.data();
+	for (auto& item : parameterSets)
+	{
+		dest[0] = 0;
+		dest[1] = 0;
+		dest[2] = 0;
+		dest[3] = 1;
+
+		memcpy(dest + 4, item.Data.data(), item.Data.size());
+		dest += 4 + item.Data.size();
+	}
+
+	isVideoExtraDataValid = true;
+
+#if 0
+	printf("EXTRA DATA = ");
+
+	for (int i = 0; i < videoExtraData.size(); ++i)
+	{
+		printf("%02x ", videoExtraData[i]);
+	}
+
+	printf("\n");
+#endif
+}
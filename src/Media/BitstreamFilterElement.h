@@ -0,0 +1,110 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+
+#pragma once
+
+#include <sys/uio.h>
+
+#include <vector>
+
+#include "Codec.h"
+#include "Element.h"
+#include "InPin.h"
+#include "Bitstream.h"
+#include "PacketBufferPool.h"
+
+
+
+struct BitstreamFilterStats
+{
+	unsigned long Packets = 0;
+	unsigned long PassedThrough = 0;	// Referenced without a copy
+	unsigned long Dropped = 0;			// Malformed NAL lengths
+	unsigned long long BytesCopied = 0;
+};
+
+
+// Turns demuxed video packets into the access units the hardware
+// decoder expects: AVCC/HVCC length prefixes become start codes,
+// the parameter sets are prepended to key frames and DivX 3 frames
+// get their header.
+//
+// The filter runs on its own thread with a small pool of output
+// packets, so it converts the next frame while the sink is still
+// blocked writing the current one.
+class BitstreamFilterElement : public Element
+{
+	struct ParameterSet
+	{
+		NalTypeEnum Type;
+		std::vector<unsigned char> Data;		// NAL unit without a start code
+	};
+
+
+	const int MAX_OUTPUT_BUFFERS = 4;
+
+	VideoInPinSPTR videoInPin;
+	OutPinSPTR videoOutPin;
+	VideoPinInfoSPTR outInfo;
+
+	bool isFirstData = true;
+	bool isFirstVideoPacket = true;
+	bool isAnnexB = false;
+	bool isExtraDataSent = false;
+	VideoFormatEnum videoFormat = VideoFormatEnum::Unknown;
+	std::vector<unsigned char> extraData;
+
+	std::vector<unsigned char> videoExtraData;
+	std::vector<ParameterSet> parameterSets;	// from the extra data, updated in-band
+	bool isVideoExtraDataValid = false;		// videoExtraData holds parameterSets as Annex-B
+	int nalLengthSize = 4;					// AVCC/HVCC length prefix
+	std::vector<NalUnit> nalUnits;
+	std::vector<iovec> vectors;
+
+	AVPacketBufferSPTR spareBuffer;			// Taken before the input it is filled from
+	int outputBufferCount = 0;
+	PacketBufferPool packetPool;
+	BitstreamFilterStats stats;
+	Mutex statsMutex;
+
+
+	void SetupFilter(VideoPinInfoSPTR info);
+	bool TryGetOutputBuffer();
+	bool ProcessBuffer(AVPacketBufferSPTR buffer, AVPacketBufferSPTR outBuffer);
+
+	void Divx3Header(int width, int height, int packetSize);
+	bool ParseExtraData();
+	void UpdateParameterSets(const std::vector<ParameterSet>& inBand);
+	void BuildAnnexBExtraData();
+
+
+protected:
+
+	virtual void Initialize() override;
+	virtual void DoWork() override;
+	virtual void Terminating() override;
+
+
+public:
+
+	BitstreamFilterElement();
+
+
+	BitstreamFilterStats Stats();
+};
+
+typedef std::shared_ptr<BitstreamFilterElement> BitstreamFilterElementSPTR;
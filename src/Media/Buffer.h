@@ -26,6 +26,8 @@ extern "C"
 
 #include <memory>
 #include <vector>
+#include <cstdlib>
+#include <algorithm>
 
 
 enum class BufferTypeEnum
@@ -50,6 +52,7 @@ class Buffer
 {
 	BufferTypeEnum type;
 	ElementSPTR owner;
+	bool isReadOnly = false;
 
 
 protected:
@@ -71,6 +74,18 @@ public:
 		return owner;
 	}
 
+	// Set while several elements hold the buffer (TeeElement).
+	// The payload must not be modified; an element that needs to
+	// rewrite it works on a copy instead.
+	bool IsReadOnly() const
+	{
+		return isReadOnly;
+	}
+	void SetReadOnly(bool value)
+	{
+		isReadOnly = value;
+	}
+
 
 	virtual ~Buffer() {};
 
@@ -241,8 +256,13 @@ public:
 
 class PcmDataBuffer : public GenericBuffer<PcmData*>
 {
+	// Plane alignment suitable for SIMD loads and stores
+	static const int ALIGNMENT = 64;
+
 	PcmData pcmData;
 	double timeStamp = -1;
+	void* data = nullptr;
+	int capacity = 0;
 
 
 	static int GetSampleSize(PcmFormat format)
@@ -297,6 +317,11 @@ class PcmDataBuffer : public GenericBuffer<PcmData*>
 		return result;
 	}
 
+	static int AlignUp(int value)
+	{
+		return (value + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+	}
+
 
 public:
 	//PcmDataBuffer( PcmFormat format, int channels, int samples)
@@ -311,6 +336,25 @@ public:
 		//printf("PcmDataBuffer ctor: format=%d, channels=%d, samples=%d\n",
 		//	(int)format, channels, samples);
 
+		Reconfigure(format, channels, samples);
+	}
+	~PcmDataBuffer()
+	{
+		free(data);
+	}
+
+
+	// Size in bytes of the allocation backing all planes
+	int Capacity() const
+	{
+		return capacity;
+	}
+
+	// Lays out the buffer for a new frame.  All planes share one
+	// allocation; it is only replaced if the frame no longer fits.
+	// Returns true if the allocation grew.
+	bool Reconfigure(PcmFormat format, int channels, int samples)
+	{
 		if (channels < 1 ||
 			channels > PcmData::MAX_CHANNELS)
 		{
@@ -321,41 +365,53 @@ public:
 			throw ArgumentOutOfRangeException();
 
 
-		pcmData.Format = (format);
-		pcmData.Channels = channels;
-		pcmData.Samples = (samples);
-
+		int planeCount;
+		int planeSize;
 
 		if (IsInterleaved(format))
 		{
-			//printf("PcmDataBuffer ctor: IsInterleaved=true\n");
-
-			int size = samples * GetSampleSize(format) * channels;
-			pcmData.Channel[0] = malloc(size);
-			pcmData.ChannelSize = size;
+			planeCount = 1;
+			planeSize = samples * GetSampleSize(format) * channels;
 		}
 		else
 		{
-			//printf("PcmDataBuffer ctor: IsInterleaved=false\n");
+			planeCount = channels;
+			planeSize = samples * GetSampleSize(format);
+		}
 
-			int size = samples * GetSampleSize(format);
-			pcmData.ChannelSize = size;
-			//printf("PcmDataBuffer ctor: pcmData.ChannelSize=%d\n", pcmData.ChannelSize);
+		int stride = AlignUp(planeSize);
+		int required = std::max(stride * planeCount, (int)ALIGNMENT);
 
-			for (int i = 0; i < channels; ++i)
-			{
-				pcmData.Channel[i] = malloc(size);
+		bool grew = false;
+		if (required > capacity)
+		{
+			free(data);
+			data = nullptr;
+			capacity = 0;
 
-				//printf("PcmDataBuffer ctor: pcmData.Channel[%d]=%p\n", i, pcmData.Channel[i]);
+			if (posix_memalign(&data, ALIGNMENT, required) != 0)
+			{
+				throw Exception("PcmDataBuffer: posix_memalign failed.");
 			}
+
+			capacity = required;
+			grew = true;
 		}
-	}
-	~PcmDataBuffer()
-	{
+
+
+		pcmData.Format = format;
+		pcmData.Channels = channels;
+		pcmData.Samples = samples;
+		pcmData.ChannelSize = planeSize;
+
 		for (int i = 0; i < PcmData::MAX_CHANNELS; ++i)
 		{
-			free(pcmData.Channel[i]);
+			pcmData.Channel[i] = (i < planeCount) ? (unsigned char*)data + (i * stride) : nullptr;
 		}
+
+		timeStamp = -1;
+
+		return grew;
 	}
 
 
@@ -394,6 +450,7 @@ class AVPacketBuffer : public GenericBuffer<AVPacket*>
 {
 	double timeStamp = -1;
 	AVRational time_base;
+	std::vector<unsigned char> header;
 
 
 	static AVPacket* CreatePayload()
@@ -471,6 +528,7 @@ public:
 		time_base.den = 1;
 
 		timeStamp = -1;
+		header.clear();
 	}
 
 	AVRational TimeBase()
@@ -482,6 +540,17 @@ public:
 		time_base = value;
 	}
 
+	// Written before the packet data, e.g. parameter sets or a DivX 3
+	// header, so the packet itself is passed on without a copy.
+	const std::vector<unsigned char>& Header() const
+	{
+		return header;
+	}
+	void SetHeader(const unsigned char* data, size_t length)
+	{
+		header.assign(data, data + length);
+	}
+
 };
 
 typedef std::shared_ptr<AVPacketBuffer> AVPacketBufferPtr;
@@ -70,6 +70,15 @@
 			}
 
 			//executionState = newState;
+
+			if (newState == ExecutionStateEnum::Idle)
+			{
+				metrics.RecordIdle();
+			}
+			else if (newState == ExecutionStateEnum::Executing)
+			{
+				metrics.RecordExecute();
+			}
 		}
 
 		// Signal even if already set
@@ -110,6 +119,22 @@
 		Log("Element (%s) DoWork exited.\n", name.c_str());
 	}
 
+	void Element::TimedDoWork()
+	{
+		TRACE_BEGIN(traceName);
+		bool isCpuTimed = ElementMetrics::IsCpuTimeEnabled();
+		uint64_t cpuStart = isCpuTimed ? ElementMetrics::ThreadCpuTime() : 0;
+		uint64_t start = ElementMetrics::Now();
+
+		DoWork();
+
+		uint64_t elapsed = ElementMetrics::Now() - start;
+		uint64_t cpuElapsed = isCpuTimed ? ElementMetrics::ThreadCpuTime() - cpuStart : 0;
+
+		metrics.RecordWork(elapsed, cpuElapsed);
+		TRACE_END(traceName);
+	}
+
 	void Element::Idling()
 	{
 	}
@@ -141,7 +166,7 @@
 					SetExecutionState(ExecutionStateEnum::Executing);
 				}
 
-				DoWork();
+				TimedDoWork();
 			}
 
 			//playPauseMutex.Unlock();
@@ -151,9 +176,8 @@
 				break;
 
 
-			pthread_mutex_lock(&waitMutex);
-
-			while (canSleep)
+			// Wakes during DoWork coalesce into one more pass
+			if (!wakeCondition.TryWait())
 			{
 				if (ExecutionState() != ExecutionStateEnum::Idle)
 				{
@@ -161,12 +185,8 @@
 					SetExecutionState(ExecutionStateEnum::Idle);
 				}
 
-				pthread_cond_wait(&waitCondition, &waitMutex);
+				wakeCondition.WaitForSignal();
 			}
-
-			canSleep = true;
-
-			pthread_mutex_unlock(&waitMutex);
 		}
 	}
 
@@ -278,22 +298,98 @@
 	}
 
 
+	// One pass of State_Executing for the shared executor.  Instead
+	// of sleeping, the step returns and Wake() schedules it again.
+	void Element::ExecuteStep()
+	{
+		if (executionState == ExecutionStateEnum::WaitingForExecute)
+		{
+			Log("Element (%s) ExecuteStep initializing.\n", name.c_str());
+
+			SetExecutionState(ExecutionStateEnum::Initializing);
+			Initialize();
+
+			SetExecutionState(ExecutionStateEnum::Idle);
+		}
+
+
+		if (isRunning)
+		{
+			// Consume the wake that scheduled this step
+			wakeCondition.TryWait();
+
+
+			if (state == MediaState::Play)
+			{
+				if (ExecutionState() != ExecutionStateEnum::Executing)
+				{
+					SetExecutionState(ExecutionStateEnum::Executing);
+				}
+
+				TimedDoWork();
+			}
+		}
+
+
+		if (!isRunning)
+		{
+			printf("Element (%s) ExecuteStep - Terminating\n", name.c_str());
+			SetExecutionState(ExecutionStateEnum::Terminating);
+			Terminating();
+
+			SetExecutionState(ExecutionStateEnum::WaitingForExecute);
+			return;
+		}
+
+
+		// If woken during DoWork the step is already rescheduled
+		if (!wakeCondition.IsSignaled() && ExecutionState() != ExecutionStateEnum::Idle)
+		{
+			SetExecutionState(ExecutionStateEnum::Idle);
+		}
+	}
+
+	void Element::SetExecutionMode(ExecutionModeEnum value)
+	{
+		if (executionState != ExecutionStateEnum::WaitingForExecute)
+		{
+			throw InvalidOperationException();
+		}
+
+		executionMode = value;
+	}
+
+
 	void Element::AddInputPin(InPinSPTR pin)
 	{
+		if (!pin)
+			throw ArgumentNullException();
+
+		metricsMutex.Lock();
 		inputs.Add(pin);
+		metricsMutex.Unlock();
 	}
 	void Element::ClearInputPins()
 	{
+		metricsMutex.Lock();
 		inputs.Clear();
+		metricsMutex.Unlock();
 	}
 
 	void Element::AddOutputPin(OutPinSPTR pin)
 	{
+		if (!pin)
+			throw ArgumentNullException();
+
+		metricsMutex.Lock();
 		outputs.Add(pin);
+		metricsMutex.Unlock();
 	}
 	void Element::ClearOutputPins()
 	{
+		metricsMutex.Lock();
 		outputs.Clear();
+		metricsMutex.Unlock();
 	}
 
 
@@ -321,6 +417,11 @@
 		return result;
 	}
 
+	ExecutionModeEnum Element::ExecutionMode() const
+	{
+		return executionMode;
+	}
+
 	bool Element::IsExecuting() const
 	{
 		//return desiredExecutionState == ExecutionStateEnum::Executing;
@@ -330,11 +431,23 @@
 
 	std::string Element::Name() const
 	{
-		return name;
+		metricsMutex.Lock();
+		std::string result = name;
+		metricsMutex.Unlock();
+
+		return result;
 	}
 	void Element::SetName(std::string name)
 	{
+		metricsMutex.Lock();
 		this->name = name;
+		metricsMutex.Unlock();
+
+		const char* interned = TRACE_INTERN(name);
+		if (interned)
+		{
+			traceName = interned;
+		}
 	}
 
 	bool Element::LogEnabled() const
@@ -346,6 +459,36 @@
 		logEnabled = value;
 	}
 
+	ElementMetricsSnapshot Element::SnapshotMetrics()
+	{
+		ElementMetricsSnapshot result;
+
+		// Copy under the lock; the pins themselves keep
+		// their counters in atomics or locked queues.
+		metricsMutex.Lock();
+
+		result.Name = name;
+		std::vector<InPinSPTR> inPins = inputs.pins;
+		std::vector<OutPinSPTR> outPins = outputs.pins;
+
+		metricsMutex.Unlock();
+
+
+		result.Capture(metrics);
+
+		for (auto& pin : inPins)
+		{
+			result.Pins.push_back(pin->SnapshotMetrics());
+		}
+
+		for (auto& pin : outPins)
+		{
+			result.Pins.push_back(pin->SnapshotMetrics());
+		}
+
+		return result;
+	}
+
 	MediaState Element::State() const
 	{
 		return state;
@@ -362,6 +505,11 @@
 
 	Element::~Element()
 	{
+		if (workItem)
+		{
+			workItem->Cancel();
+		}
+
 		printf("Element %s destructed.\n", name.c_str());
 	}
 
@@ -376,7 +524,18 @@
 
 
 		isRunning = true;
-		thread.Start();
+
+		MetricsRegistry::Add(shared_from_this());
+
+		if (executionMode == ExecutionModeEnum::Dedicated)
+		{
+			thread.Start();
+		}
+		else
+		{
+			workItem = std::make_shared<WorkItem>(std::function<void()>(std::bind(&Element::ExecuteStep, this)));
+			workItem->Schedule();
+		}
 
 
 		Log("Element (%s) Execute.\n", name.c_str());
@@ -384,18 +543,15 @@
 
 	void Element::Wake()
 	{
-		pthread_mutex_lock(&waitMutex);
-
-		canSleep = false;
+		// No syscall unless the dedicated thread is asleep
+		wakeCondition.Signal();
 
-		//pthread_cond_signal(&waitCondition);
-		if (pthread_cond_broadcast(&waitCondition) != 0)
+		WorkItemSPTR item = workItem;
+		if (item)
 		{
-			throw Exception("Element::Wake - pthread_cond_broadcast failed.");
+			item->Schedule();
 		}
 
-		pthread_mutex_unlock(&waitMutex);
-
 		Log("Element (%s) Wake.\n", name.c_str());
 	}
 
@@ -420,8 +576,16 @@
 
 		//thread.Cancel();
 
-		printf("Element (%s) thread.Join().\n", name.c_str());
-		thread.Join();
+		if (executionMode == ExecutionModeEnum::Dedicated)
+		{
+			printf("Element (%s) thread.Join().\n", name.c_str());
+			thread.Join();
+		}
+		else
+		{
+			// Keep the cancelled item; Wake() may still race with us
+			workItem->Cancel();
+		}
 
 		printf("Element (%s) Terminate.\n", name.c_str());
 	}
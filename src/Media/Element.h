@@ -21,8 +21,12 @@
 #include <sys/time.h>
 
 #include "Codec.h"
+#include "Executor.h"
 #include "InPin.h"
 #include "OutPin.h"
+#include "Trace.h"
+#include "Metrics.h"
+#include "Mutex.h"
 #include "WaitCondition.h"
 
 
@@ -65,20 +69,37 @@ enum class ExecutionStateEnum
 };
 
 
+// Shared elements run on the Executor, one DoWork per Wake.
+// Dedicated elements own a thread; use it for elements whose
+// DoWork blocks (device writes, waiting on buffers).
+enum class ExecutionModeEnum
+{
+	Shared = 0,
+	Dedicated
+};
+
+
 class Element : public std::enable_shared_from_this<Element>
 {
 	Thread thread = Thread(std::function<void()>(std::bind(&Element::InternalWorkThread, this)));
+	ExecutionModeEnum executionMode = ExecutionModeEnum::Shared;
+	WorkItemSPTR workItem;
 	MediaState state = MediaState::Pause;
 	InPinCollection inputs;
 	OutPinCollection outputs;
 	ExecutionStateEnum executionState = ExecutionStateEnum::WaitingForExecute;
 	//ExecutionStateEnum desiredExecutionState = ExecutionStateEnum::WaitingForExecute;
 
-	pthread_cond_t waitCondition = PTHREAD_COND_INITIALIZER;
-	pthread_mutex_t waitMutex = PTHREAD_MUTEX_INITIALIZER;
-	bool canSleep = true;
+	WaitCondition wakeCondition;	// Signaled means a Wake is pending
 
 	std::string name = "Element";
+	const char* traceName = "Element";
+
+	// Elements are registered for metrics before Initialize runs,
+	// so the reporter thread can snapshot while pins are added or
+	// the name changes.  Guards name and the pin collections'
+	// membership; pins are named before they are added.
+	mutable Mutex metricsMutex;
 
 	pthread_cond_t executionWaitCondition = PTHREAD_COND_INITIALIZER;
 	pthread_mutex_t executionWaitMutex = PTHREAD_MUTEX_INITIALIZER;
@@ -86,11 +107,14 @@ class Element : public std::enable_shared_from_this<Element>
 	bool logEnabled = false;
 	bool isRunning = false;
 
+	ElementMetrics metrics;
+
 
 
 
 
 	void SetExecutionState(ExecutionStateEnum newState);
+	void TimedDoWork();
 
 
 protected:
@@ -115,6 +139,8 @@ protected:
 
 	void State_Executing();
 	void InternalWorkThread();
+	void ExecuteStep();
+	void SetExecutionMode(ExecutionModeEnum value);
 	void AddInputPin(InPinSPTR pin);
 	void ClearInputPins();
 	void AddOutputPin(OutPinSPTR pin);
@@ -127,11 +153,15 @@ public:
 	InPinCollection* Inputs();
 	OutPinCollection* Outputs();
 	ExecutionStateEnum ExecutionState() const;
+	ExecutionModeEnum ExecutionMode() const;
 	bool IsExecuting() const;
 	std::string Name() const;
 	void SetName(std::string name);
 	bool LogEnabled() const;
 	void SetLogEnabled(bool value);
+
+	// Takes metricsMutex while reading the name and pin list
+	ElementMetricsSnapshot SnapshotMetrics();
 	virtual MediaState State() const;
 	virtual void SetState(MediaState value);
 
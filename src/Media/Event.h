@@ -20,17 +20,63 @@
 #include "Exception.h"
 #include "EventListener.h"
 
+#include <atomic>
+#include <memory>
 #include <vector>
 
 
 template<typename T>  // where T : EventArgs
 class Event
 {
+	typedef std::vector<EventListenerWPTR<T>> ListenerList;
+
+
+	// Invoke reads the current list without locking.  Writers publish
+	// a modified copy under the mutex.  Replaced lists are kept until
+	// the Event is destroyed since a reader may still be iterating
+	// one; listeners only change during setup and teardown so this
+	// stays small.
+	std::atomic<const ListenerList*> listeners;
+	std::vector<std::unique_ptr<ListenerList>> lists;
 	Mutex mutex;
-	std::vector<EventListenerWPTR<T>> listeners;
+
+
+	// Copy of the current list without expired listeners.
+	// Must be called with mutex held.
+	ListenerList* CopyListeners()
+	{
+		ListenerList* result = new ListenerList();
+
+		const ListenerList* current = listeners.load(std::memory_order_relaxed);
+		if (current)
+		{
+			for (auto item : *current)
+			{
+				if (!item.expired())
+				{
+					result->push_back(item);
+				}
+			}
+		}
+
+		return result;
+	}
+
+	// Must be called with mutex held
+	void Publish(ListenerList* list)
+	{
+		lists.push_back(std::unique_ptr<ListenerList>(list));
+		listeners.store(list, std::memory_order_release);
+	}
+
 
 public:
 
+	Event()
+		: listeners(nullptr)
+	{
+	}
+
 	~Event()
 	{
 		//for (auto item : listeners)
@@ -39,15 +85,21 @@ public:
 		//}
 	}
 
+	Event(const Event&) = delete;
+	Event& operator=(const Event&) = delete;
+
+
 	void Invoke(void *sender, const T& args)
 	{
 		if (sender == nullptr)
 			throw ArgumentNullException();
 
 
-		mutex.Lock();
+		const ListenerList* current = listeners.load(std::memory_order_acquire);
+		if (!current)
+			return;
 
-		for (auto item : listeners)
+		for (auto& item : *current)
 		{
 			auto sptr = item.lock();
 			if (sptr)
@@ -56,10 +108,6 @@ public:
 			}
 			//printf("Event: Invoked a listener (%p).\n", *item);
 		}
-
-		//TODO: Clean up dead objects
-		
-		mutex.Unlock();
 	}
 
 	void AddListener(EventListenerWPTR<T> listener)
@@ -74,8 +122,10 @@ public:
 
 		mutex.Lock();
 
+		ListenerList* list = CopyListeners();
+
 		bool isDuplicate = false;
-		for (auto item : listeners)
+		for (auto item : *list)
 		{
 			auto sptr = item.lock();
 			if (sptr == listenerSPTR)
@@ -85,15 +135,25 @@ public:
 			}
 		}
 
-		if (!isDuplicate)
+		if (isDuplicate)
 		{
-			listeners.push_back(listener);
+			delete list;
+		}
+		else
+		{
+			list->push_back(listener);
+			Publish(list);
 			//printf("Event: Added a listener (%p).\n", listener);
 		}
 
 		mutex.Unlock();
 	}
 
+	// Does not wait for Invoke calls in progress: one that loaded the
+	// previous list may still call the listener after this returns.
+	// The listener is kept alive for that call, but whatever its
+	// handler uses must stay valid until the event can no longer fire
+	// (e.g. the source element has stopped).
 	void RemoveListener(EventListenerSPTR<T> listener)
 	{
 		if (listener == nullptr)
@@ -102,16 +162,29 @@ public:
 
 		mutex.Lock();
 
-		for (auto item : listeners)
+		ListenerList* list = CopyListeners();
+
+		bool isFound = false;
+		for (auto iter = list->begin(); iter != list->end(); ++iter)
 		{
-			auto sptr = item.lock();
+			auto sptr = iter->lock();
 			if (sptr == listener)
 			{
-				listeners.erase(item);
+				list->erase(iter);
+				isFound = true;
 				break;
 			}
 		}
 
+		if (isFound)
+		{
+			Publish(list);
+		}
+		else
+		{
+			delete list;
+		}
+
 		mutex.Unlock();
 	}
 };
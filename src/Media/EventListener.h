@@ -18,6 +18,9 @@
 
 //#include "Event.h"
 
+#include <functional>
+#include <memory>
+
 
 template<typename T>
 using EventFunction = std::function<void(void* sender, const T& args)>;
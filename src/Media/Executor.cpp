@@ -0,0 +1,308 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#include "Executor.h"
+
+#include "Exception.h"
+
+#include <unistd.h>
+#include <algorithm>
+
+
+// Index of the worker owning the current thread, -1 otherwise
+static thread_local int currentWorkerIndex = -1;
+static thread_local Executor* currentExecutor = nullptr;
+
+
+
+void WorkItem::Execute()
+{
+	pthread_mutex_lock(&mutex);
+
+	if (state != WorkItemStateEnum::Scheduled)
+	{
+		// Cancelled while queued
+		pthread_mutex_unlock(&mutex);
+		return;
+	}
+
+	state = WorkItemStateEnum::Running;
+	isExecuting = true;
+	executingThread = pthread_self();
+
+	pthread_mutex_unlock(&mutex);
+
+
+	function();
+
+
+	bool reschedule = false;
+
+	pthread_mutex_lock(&mutex);
+
+	switch (state)
+	{
+		case WorkItemStateEnum::Running:
+			state = WorkItemStateEnum::Idle;
+			break;
+
+		case WorkItemStateEnum::RunningScheduled:
+			state = WorkItemStateEnum::Scheduled;
+			reschedule = true;
+			break;
+
+		default:
+			break;
+	}
+
+	isExecuting = false;
+	pthread_cond_broadcast(&executedCondition);
+
+	pthread_mutex_unlock(&mutex);
+
+
+	if (reschedule)
+	{
+		executor->Submit(shared_from_this());
+	}
+}
+
+
+
+WorkItem::WorkItem(std::function<void()> function)
+	: WorkItem(function, Executor::Default())
+{
+}
+
+WorkItem::WorkItem(std::function<void()> function, Executor* executor)
+	: function(function), executor(executor)
+{
+	if (!executor)
+		throw ArgumentNullException();
+}
+
+
+
+WorkItemStateEnum WorkItem::State()
+{
+	pthread_mutex_lock(&mutex);
+	WorkItemStateEnum result = state;
+	pthread_mutex_unlock(&mutex);
+
+	return result;
+}
+
+void WorkItem::Schedule()
+{
+	bool submit = false;
+
+	pthread_mutex_lock(&mutex);
+
+	switch (state)
+	{
+		case WorkItemStateEnum::Idle:
+			state = WorkItemStateEnum::Scheduled;
+			submit = true;
+			break;
+
+		case WorkItemStateEnum::Running:
+			state = WorkItemStateEnum::RunningScheduled;
+			break;
+
+		default:
+			// Already pending or cancelled
+			break;
+	}
+
+	pthread_mutex_unlock(&mutex);
+
+
+	if (submit)
+	{
+		executor->Submit(shared_from_this());
+	}
+}
+
+void WorkItem::Cancel()
+{
+	pthread_mutex_lock(&mutex);
+
+	state = WorkItemStateEnum::Cancelled;
+
+	if (!isExecuting || !pthread_equal(executingThread, pthread_self()))
+	{
+		while (isExecuting)
+		{
+			pthread_cond_wait(&executedCondition, &mutex);
+		}
+	}
+
+	pthread_mutex_unlock(&mutex);
+}
+
+
+
+
+void Executor::WorkerThread(int index)
+{
+	currentWorkerIndex = index;
+	currentExecutor = this;
+
+	while (true)
+	{
+		WorkItemSPTR item;
+
+		if (TryTake(index, &item))
+		{
+			pending.fetch_sub(1, std::memory_order_relaxed);
+
+			item->Execute();
+			continue;
+		}
+
+
+		pthread_mutex_lock(&sleepMutex);
+
+		while (isRunning && pending.load(std::memory_order_relaxed) < 1)
+		{
+			pthread_cond_wait(&sleepCondition, &sleepMutex);
+		}
+
+		bool exit = !isRunning;
+
+		pthread_mutex_unlock(&sleepMutex);
+
+		if (exit)
+			break;
+	}
+}
+
+bool Executor::TryTake(int index, WorkItemSPTR* outValue)
+{
+	int count = workers.size();
+
+	// Own queue first (FIFO), then steal from the others
+	for (int i = 0; i < count; ++i)
+	{
+		Worker* worker = workers[(index + i) % count].get();
+		bool found = false;
+
+		worker->mutex.Lock();
+
+		if (worker->queue.size() > 0)
+		{
+			if (i == 0)
+			{
+				*outValue = worker->queue.front();
+				worker->queue.pop_front();
+			}
+			else
+			{
+				*outValue = worker->queue.back();
+				worker->queue.pop_back();
+			}
+
+			found = true;
+		}
+
+		worker->mutex.Unlock();
+
+		if (found)
+			return true;
+	}
+
+	return false;
+}
+
+
+
+Executor* Executor::Default()
+{
+	// Never destroyed so that workers outlive any static
+	// Element during process exit.
+	static Executor* executor = new Executor(
+		std::max(2, (int)sysconf(_SC_NPROCESSORS_ONLN)));
+
+	return executor;
+}
+
+
+
+Executor::Executor(int workerCount)
+	: pending(0), nextWorker(0)
+{
+	if (workerCount < 1)
+		throw ArgumentOutOfRangeException();
+
+	for (int i = 0; i < workerCount; ++i)
+	{
+		workers.push_back(std::unique_ptr<Worker>(new Worker()));
+	}
+
+	for (int i = 0; i < workerCount; ++i)
+	{
+		workers[i]->thread = std::make_shared<Thread>(
+			std::function<void()>(std::bind(&Executor::WorkerThread, this, i)));
+		workers[i]->thread->Start();
+	}
+}
+
+Executor::~Executor()
+{
+	pthread_mutex_lock(&sleepMutex);
+
+	isRunning = false;
+	pthread_cond_broadcast(&sleepCondition);
+
+	pthread_mutex_unlock(&sleepMutex);
+
+
+	for (auto& worker : workers)
+	{
+		worker->thread->Join();
+	}
+}
+
+
+
+void Executor::Submit(WorkItemSPTR item)
+{
+	if (!item)
+		throw ArgumentNullException();
+
+	int index;
+	if (currentExecutor == this)
+	{
+		index = currentWorkerIndex;
+	}
+	else
+	{
+		index = nextWorker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+	}
+
+	Worker* worker = workers[index].get();
+
+	worker->mutex.Lock();
+	worker->queue.push_back(item);
+	worker->mutex.Unlock();
+
+	pending.fetch_add(1, std::memory_order_relaxed);
+
+
+	pthread_mutex_lock(&sleepMutex);
+	pthread_cond_signal(&sleepCondition);
+	pthread_mutex_unlock(&sleepMutex);
+}
@@ -0,0 +1,134 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#pragma once
+
+#include "Mutex.h"
+#include "Thread.h"
+
+#include <pthread.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+
+class Executor;
+
+
+enum class WorkItemStateEnum
+{
+	Idle = 0,
+	Scheduled,
+	Running,
+	RunningScheduled,
+	Cancelled
+};
+
+
+// A unit of work that is run on an Executor each time it is
+// scheduled.  Scheduling is coalesced: any number of Schedule()
+// calls before the item runs result in one run, and a Schedule()
+// while it is running results in exactly one more run.  An item
+// never runs concurrently with itself.
+class WorkItem : public std::enable_shared_from_this<WorkItem>
+{
+	friend class Executor;
+
+	std::function<void()> function;
+	Executor* executor;
+	WorkItemStateEnum state = WorkItemStateEnum::Idle;
+	bool isExecuting = false;
+	pthread_t executingThread;
+	pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+	pthread_cond_t executedCondition = PTHREAD_COND_INITIALIZER;
+
+
+	void Execute();
+
+
+public:
+
+	WorkItem(std::function<void()> function);
+	WorkItem(std::function<void()> function, Executor* executor);
+
+	WorkItem(const WorkItem&) = delete;
+	WorkItem& operator=(const WorkItem&) = delete;
+
+
+	WorkItemStateEnum State();
+
+	void Schedule();
+
+	// Prevents further runs and waits for a run in progress to
+	// finish (unless called from the run itself).
+	void Cancel();
+};
+
+typedef std::shared_ptr<WorkItem> WorkItemSPTR;
+
+
+
+// Fixed pool of worker threads with per-worker queues.  Items
+// scheduled from a worker go to its own queue; idle workers steal
+// from the others before sleeping.
+//
+// Work run here must not block for long periods.  Code that waits
+// on I/O should run on a dedicated Thread instead.
+class Executor
+{
+	struct Worker
+	{
+		Mutex mutex;
+		std::deque<WorkItemSPTR> queue;
+		ThreadSPTR thread;
+	};
+
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::atomic<int> pending;
+	std::atomic<unsigned int> nextWorker;
+	bool isRunning = true;
+	pthread_mutex_t sleepMutex = PTHREAD_MUTEX_INITIALIZER;
+	pthread_cond_t sleepCondition = PTHREAD_COND_INITIALIZER;
+
+
+	void WorkerThread(int index);
+	bool TryTake(int index, WorkItemSPTR* outValue);
+
+
+public:
+
+	// Shared by all Elements and pins.  Sized to the core count.
+	static Executor* Default();
+
+
+	int WorkerCount() const
+	{
+		return workers.size();
+	}
+
+
+	Executor(int workerCount);
+	~Executor();
+
+	Executor(const Executor&) = delete;
+	Executor& operator=(const Executor&) = delete;
+
+
+	void Submit(WorkItemSPTR item);
+};
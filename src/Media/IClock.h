@@ -69,4 +69,9 @@ public:
 	{
 		sinks.clear();
 	}
+
+	bool IsEmpty() const
+	{
+		return sinks.empty();
+	}
 };
@@ -19,33 +19,20 @@
 #include "OutPin.h"
 #include "Element.h"
 
-void  InPin::WorkThread()
+void InPin::RunWork()
 {
-	//printf("InPin: WorkTread started.\n");
-
-	while (true)
-	{
-		//// Scope the shared pointer
-		//{
-		//	ElementSPTR owner = Owner().lock();
-		//	if (owner && owner->State() == MediaState::Play)
-		//	{
-		//		DoWork();
-		//	}
-		//}
-
-		DoWork();
-
-		waitCondition.WaitForSignal();
-	}
-
-	//printf("InPin: WorkTread exited.\n");
+	workMutex.Lock();
+	DoWork();
+	workMutex.Unlock();
 }
 
 	void InPin::ReturnAllBuffers()
 	{
 		ElementSPTR parent = Owner().lock();
 
+		// Pin work is the only other consumer that may still
+		// be running while the owner is idle.
+		workMutex.Lock();
 		sourceMutex.Lock();
 
 		//if (!source)
@@ -66,6 +53,7 @@ void  InPin::WorkThread()
 		}
 
 		sourceMutex.Unlock();
+		workMutex.Unlock();
 
 		parent->Log("InPin::ReturnAllBuffers completed\n");
 	}
@@ -84,6 +72,11 @@ void  InPin::WorkThread()
 
 	InPin::~InPin()
 	{
+		if (pinWork)
+		{
+			pinWork->Cancel();
+		}
+
 		if (source)
 		{
 			ReturnAllBuffers();
@@ -160,9 +153,18 @@ void  InPin::WorkThread()
 		this->source = source;
 		sourceMutex.Unlock();
 
+		const char* interned = TRACE_INTERN(parent->Name() + "." + Name());
+		if (interned)
+		{
+			traceName = interned;
+		}
 
-		pinThread = std::make_shared<Thread>(std::function<void()>(std::bind(&InPin::WorkThread, this)));
-		pinThread->Start();
+
+		if (HasWork())
+		{
+			pinWork = std::make_shared<WorkItem>(std::function<void()>(std::bind(&InPin::RunWork, this)));
+			pinWork->Schedule();
+		}
 
 		parent->Wake();
 
@@ -189,9 +191,10 @@ void  InPin::WorkThread()
 		//	throw InvalidOperationException("Can not disconnect while executing.");
 
 
-		pinThread->Cancel();
-		pinThread->Join();
-		pinThread = nullptr;
+		if (pinWork)
+		{
+			pinWork->Cancel();
+		}
 
 
 		ReturnAllBuffers();
@@ -213,8 +216,12 @@ void  InPin::WorkThread()
 		ElementSPTR parent = Owner().lock();
 
 
+		RecordBuffer(buffer);
 		filledBuffers.Push(buffer);
 
+		TRACE_INSTANT("ReceiveBuffer", buffer.get());
+		TRACE_COUNTER(traceName, filledBuffers.Count());
+
 
 		if (parent)
 		{
@@ -222,8 +229,12 @@ void  InPin::WorkThread()
 		}
 
 
-		// Wake the work thread
-		waitCondition.Signal();
+		// Schedule the pin work
+		WorkItemSPTR item = pinWork;
+		if (item)
+		{
+			item->Schedule();
+		}
 
 
 		BufferReceived.Invoke(this, EventArgs::Empty());
@@ -241,3 +252,12 @@ void  InPin::WorkThread()
 
 		parent->Log("InPin::Flush completed\n");
 	}
+
+	PinMetricsSnapshot InPin::SnapshotMetrics()
+	{
+		PinMetricsSnapshot result = Pin::SnapshotMetrics();
+		result.FilledCount = filledBuffers.Count();
+		result.ProcessedCount = processedBuffers.Count();
+
+		return result;
+	}
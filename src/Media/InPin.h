@@ -17,10 +17,11 @@
 #pragma once
 
 #include "Pin.h"
-#include "Thread.h"
-#include "WaitCondition.h"
+#include "Executor.h"
+#include "SpscQueue.h"
 #include "Event.h"
 #include "EventArgs.h"
+#include "Trace.h"
 
 
 //class OutPin;
@@ -32,20 +33,37 @@ class InPin : public Pin
 
 	OutPinSPTR source;	// TODO: WeakPointer
 	Mutex sourceMutex;
-	ThreadSafeQueue<BufferSPTR> filledBuffers;
-	ThreadSafeQueue<BufferSPTR> processedBuffers;
-	ThreadSPTR pinThread;
-	WaitCondition waitCondition;
 
+	// Producer: the source element's thread (ReceiveBuffer).
+	// Consumer: the owner's thread, or the pin work, which is
+	// serialized with ReturnAllBuffers by workMutex; ReturnAllBuffers
+	// only runs once the owner is idle.
+	SpscQueue<BufferSPTR> filledBuffers;
 
+	// Producer and consumer: the owner's thread or the pin work.
+	// ReturnAllBuffers also drains it; both drains hold sourceMutex.
+	SpscQueue<BufferSPTR> processedBuffers;
+	WorkItemSPTR pinWork;
+	Mutex workMutex;	// Serializes pin DoWork with ReturnAllBuffers
+	const char* traceName = "InPin";
 
-	void WorkThread();
+
+
+	void RunWork();
 
 
 
 protected:
 
 	void ReturnAllBuffers();
+
+	// Pins that override DoWork return true; only they get a work
+	// item, so plain pins cost nothing per buffer.
+	virtual bool HasWork() const
+	{
+		return false;
+	}
+
 	virtual void DoWork();
 
 
@@ -83,6 +101,7 @@ public:
 	void ReceiveBuffer(BufferSPTR buffer);
 	
 	virtual void Flush() override;
+	virtual PinMetricsSnapshot SnapshotMetrics() override;
 };
 
 //typedef std::shared_ptr<InPin> InPinSPTR;
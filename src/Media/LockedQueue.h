@@ -21,6 +21,8 @@
 
 #include <pthread.h>
 #include <queue>
+#include <time.h>
+#include <errno.h>
 #include <unistd.h>
 
 
@@ -29,13 +31,17 @@ template <typename T>
 class ThreadSafeQueue
 {
 	std::queue<T> queue;
-	Mutex mutex;
+	mutable Mutex mutex;
 
 
 public:
 	int Count() const
 	{
-		return queue.size();
+		mutex.Lock();
+		int result = queue.size();
+		mutex.Unlock();
+
+		return result;
 	}
 
 
@@ -110,12 +116,135 @@ public:
 
 
 
+struct QueueWaitStats
+{
+	unsigned long PushWaitCount = 0;	// Pushes that had to wait for space
+	double PushWaitSeconds = 0;
+	unsigned long PopWaitCount = 0;		// Pops that had to wait for a value
+	double PopWaitSeconds = 0;
+};
+
+
+// Bounded queue with blocking Push/Pop.
+//
+// Waiting is done on condition variables (CLOCK_MONOTONIC) rather
+// than polling.  Cancel() wakes every waiter and makes calls that
+// would have to wait fail instead; calls that can complete right
+// away still do, so buffers handed back during a flush are not lost.
 template <typename T>
 class LockedQueue
 {
-	const int limit = 0x7fffffff;
+	int limit = 0x7fffffff;
 	std::queue<T> queue;
 	pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+	pthread_cond_t notFull;
+	pthread_cond_t notEmpty;
+	bool isCancelled = false;
+	QueueWaitStats stats;
+
+
+	static double Now()
+	{
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+
+		return ts.tv_sec + ts.tv_nsec * 1e-9;
+	}
+
+	static timespec Deadline(double timeoutSeconds)
+	{
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+
+		long long nsec = ts.tv_nsec + (long long)(timeoutSeconds * 1e9);
+		ts.tv_sec += nsec / 1000000000LL;
+		ts.tv_nsec = nsec % 1000000000LL;
+
+		return ts;
+	}
+
+	void InitConditions()
+	{
+		pthread_condattr_t attr;
+		pthread_condattr_init(&attr);
+		pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+		if (pthread_cond_init(&notFull, &attr) != 0 ||
+			pthread_cond_init(&notEmpty, &attr) != 0)
+		{
+			pthread_condattr_destroy(&attr);
+			throw Exception("LockedQueue: pthread_cond_init failed.");
+		}
+
+		pthread_condattr_destroy(&attr);
+	}
+
+	bool CanComplete(bool isPush) const
+	{
+		return isPush ? (int)queue.size() < limit : queue.size() > 0;
+	}
+
+	// Must be called with mutex held.  A negative timeout waits forever.
+	// Returns false on timeout or cancellation.
+	bool Wait(bool isPush, double timeoutSeconds)
+	{
+		if (CanComplete(isPush))
+			return true;
+
+		if (isCancelled || timeoutSeconds == 0)
+			return false;
+
+
+		pthread_cond_t* condition = isPush ? &notFull : &notEmpty;
+
+		timespec deadline;
+		if (timeoutSeconds > 0)
+		{
+			deadline = Deadline(timeoutSeconds);
+		}
+
+		double start = Now();
+		bool result = true;
+
+		while (!CanComplete(isPush))
+		{
+			if (isCancelled)
+			{
+				result = false;
+				break;
+			}
+
+			if (timeoutSeconds > 0)
+			{
+				if (pthread_cond_timedwait(condition, &mutex, &deadline) == ETIMEDOUT)
+				{
+					// The state may have changed right at the deadline
+					result = CanComplete(isPush);
+					break;
+				}
+			}
+			else
+			{
+				pthread_cond_wait(condition, &mutex);
+			}
+		}
+
+		double elapsed = Now() - start;
+
+		if (isPush)
+		{
+			++stats.PushWaitCount;
+			stats.PushWaitSeconds += elapsed;
+		}
+		else
+		{
+			++stats.PopWaitCount;
+			stats.PopWaitSeconds += elapsed;
+		}
+
+		return result;
+	}
+
 
 public:
 
@@ -130,7 +259,7 @@ public:
 
 		pthread_mutex_lock(&mutex);
 
-		if (queue.size() > value)
+		if ((int)queue.size() > value)
 		{
 			pthread_mutex_unlock(&mutex);
 			throw InvalidOperationException("The queue has more entries than the limit.");
@@ -138,12 +267,44 @@ public:
 		else
 		{
 			limit = value;
+
+			pthread_cond_broadcast(&notFull);
 			pthread_mutex_unlock(&mutex);
 		}
 	}
 
+	int Count()
+	{
+		pthread_mutex_lock(&mutex);
+		int result = queue.size();
+		pthread_mutex_unlock(&mutex);
+
+		return result;
+	}
+
+	bool IsCancelled()
+	{
+		pthread_mutex_lock(&mutex);
+		bool result = isCancelled;
+		pthread_mutex_unlock(&mutex);
+
+		return result;
+	}
+
+	QueueWaitStats Stats()
+	{
+		pthread_mutex_lock(&mutex);
+		QueueWaitStats result = stats;
+		pthread_mutex_unlock(&mutex);
+
+		return result;
+	}
+
+
+
 	LockedQueue()
 	{
+		InitConditions();
 	}
 
 	LockedQueue(int limit)
@@ -153,39 +314,41 @@ public:
 		{
 			throw ArgumentOutOfRangeException();
 		}
+
+		InitConditions();
 	}
 
+	LockedQueue(const LockedQueue&) = delete;
+	LockedQueue& operator=(const LockedQueue&) = delete;
 
-	void Push(T value)
+	~LockedQueue()
 	{
-		pthread_mutex_lock(&mutex);
+		pthread_cond_destroy(&notFull);
+		pthread_cond_destroy(&notEmpty);
+	}
 
-		while (queue.size() >= limit)
-		{
-			pthread_mutex_unlock(&mutex);
-			usleep(1);
-			pthread_mutex_lock(&mutex);
-		}
 
-		queue.push(value);
 
-		pthread_mutex_unlock(&mutex);
+	// Blocks while the queue is full.  Returns false if cancelled.
+	bool Push(T value)
+	{
+		return TryPush(value, -1);
 	}
 
 	bool TryPush(T value)
 	{
-		bool result;
+		return TryPush(value, 0);
+	}
 
+	bool TryPush(T value, double timeoutSeconds)
+	{
 		pthread_mutex_lock(&mutex);
 
-		if (queue.size() >= limit)
-		{
-			result = false;
-		}
-		else
+		bool result = Wait(true, timeoutSeconds);
+		if (result)
 		{
 			queue.push(value);
-			result = true;
+			pthread_cond_signal(&notEmpty);
 		}
 
 		pthread_mutex_unlock(&mutex);
@@ -193,39 +356,41 @@ public:
 		return result;
 	}
 
+	// Blocks while the queue is empty.
 	T Pop()
 	{
-		pthread_mutex_lock(&mutex);
+		T result;
 
-		while (queue.size() < 1)
+		if (!TryPop(&result, -1))
 		{
-			pthread_mutex_unlock(&mutex);
-			usleep(1);
-			pthread_mutex_lock(&mutex);
+			throw InvalidOperationException("The queue was cancelled.");
 		}
 
-		T result = queue.front();
-		queue.pop();
+		return result;
+	}
 
-		pthread_mutex_unlock(&mutex);
+	// Blocks while the queue is empty.  Returns false if cancelled.
+	bool Pop(T* outValue)
+	{
+		return TryPop(outValue, -1);
 	}
 
 	bool TryPop(T* outValue)
 	{
-		bool result;
+		return TryPop(outValue, 0);
+	}
 
+	bool TryPop(T* outValue, double timeoutSeconds)
+	{
 		pthread_mutex_lock(&mutex);
 
-		if (queue.size() < 1)
-		{
-			//memset(outValue, 0, sizeof(*outValue));
-			result = false;
-		}
-		else
+		bool result = Wait(false, timeoutSeconds);
+		if (result)
 		{
 			*outValue = queue.front();
 			queue.pop();
-			result = true;
+
+			pthread_cond_signal(&notFull);
 		}
 
 		pthread_mutex_unlock(&mutex);
@@ -242,6 +407,27 @@ public:
 			queue.pop();
 		}
 
+		pthread_cond_broadcast(&notFull);
+
+		pthread_mutex_unlock(&mutex);
+	}
+
+	// Wakes all waiters; waiting calls fail until Reset()
+	void Cancel()
+	{
+		pthread_mutex_lock(&mutex);
+
+		isCancelled = true;
+		pthread_cond_broadcast(&notFull);
+		pthread_cond_broadcast(&notEmpty);
+
+		pthread_mutex_unlock(&mutex);
+	}
+
+	void Reset()
+	{
+		pthread_mutex_lock(&mutex);
+		isCancelled = false;
 		pthread_mutex_unlock(&mutex);
 	}
 };
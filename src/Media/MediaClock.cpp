@@ -0,0 +1,244 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#include "MediaClock.h"
+
+#include "Exception.h"
+
+#include <time.h>
+
+
+
+IMediaClockSPTR MediaClock::current = std::make_shared<RealTimeClock>();
+
+// Set while a VirtualClock callback runs on this thread
+static thread_local bool isCallbackThread = false;
+
+
+
+double RealTimeClock::Now()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+void RealTimeClock::StartTimer(TimerEntry* entry, double delay, double period)
+{
+	TimerService::Default()->Start(entry, delay, period);
+}
+
+void RealTimeClock::CancelTimer(TimerEntry* entry)
+{
+	TimerService::Default()->Cancel(entry);
+}
+
+bool RealTimeClock::IsTimerActive(TimerEntry* entry)
+{
+	return TimerService::Default()->IsActive(entry);
+}
+
+TimerStats RealTimeClock::TimerStatistics(TimerEntry* entry)
+{
+	return TimerService::Default()->Stats(entry);
+}
+
+
+
+// TimerEntry::level doubles as the "in timers" flag (0 or -1)
+void VirtualClock::Unlink(TimerEntry* entry)
+{
+	if (entry->level < 0)
+		return;
+
+	auto range = timers.equal_range(entry->deadline);
+	for (auto iter = range.first; iter != range.second; ++iter)
+	{
+		if (iter->second == entry)
+		{
+			timers.erase(iter);
+			break;
+		}
+	}
+
+	entry->level = -1;
+}
+
+double VirtualClock::Now()
+{
+	pthread_mutex_lock(&mutex);
+	double result = now;
+	pthread_mutex_unlock(&mutex);
+
+	return result;
+}
+
+void VirtualClock::Advance(double seconds)
+{
+	if (seconds < 0)
+		throw ArgumentOutOfRangeException();
+
+	// A callback advancing the clock would fire itself again
+	if (isCallbackThread)
+		return;
+
+
+	// Concurrent callers advance one after the other
+	advanceMutex.Lock();
+	pthread_mutex_lock(&mutex);
+
+	double target = now + seconds;
+
+	while (timers.size() > 0 &&
+		timers.begin()->first <= target)
+	{
+		TimerEntry* entry = timers.begin()->second;
+		timers.erase(timers.begin());
+		entry->level = -1;
+
+		now = entry->deadline;
+
+		++entry->expirations;
+		++totalExpirations;
+
+		if (entry->period <= 0)
+		{
+			entry->isActive = false;
+		}
+
+		runningEntry = entry;
+		std::function<void()> callback = entry->Callback;
+
+		pthread_mutex_unlock(&mutex);
+
+		if (callback)
+		{
+			isCallbackThread = true;
+			callback();
+			isCallbackThread = false;
+		}
+
+		pthread_mutex_lock(&mutex);
+
+		runningEntry = nullptr;
+		pthread_cond_broadcast(&callbackDone);
+
+
+		// Cancelled, restarted or one-shot entries are left alone
+		if (entry->isActive && entry->level < 0 && entry->period > 0)
+		{
+			entry->deadline += entry->period;
+			entry->level = 0;
+			timers.insert(std::make_pair(entry->deadline, entry));
+		}
+	}
+
+	now = target;
+
+	pthread_mutex_unlock(&mutex);
+	advanceMutex.Unlock();
+}
+
+void VirtualClock::StartTimer(TimerEntry* entry, double delay, double period)
+{
+	if (!entry)
+		throw ArgumentNullException();
+
+	if (delay < 0 || period < 0)
+		throw ArgumentOutOfRangeException();
+
+
+	pthread_mutex_lock(&mutex);
+
+	Unlink(entry);
+
+	entry->deadline = now + delay;
+	entry->period = period;
+	entry->isActive = true;
+	entry->level = 0;
+
+	timers.insert(std::make_pair(entry->deadline, entry));
+
+	pthread_mutex_unlock(&mutex);
+}
+
+void VirtualClock::CancelTimer(TimerEntry* entry)
+{
+	if (!entry)
+		throw ArgumentNullException();
+
+
+	pthread_mutex_lock(&mutex);
+
+	Unlink(entry);
+	entry->isActive = false;
+
+	if (!isCallbackThread)
+	{
+		while (runningEntry == entry)
+		{
+			pthread_cond_wait(&callbackDone, &mutex);
+		}
+	}
+
+	pthread_mutex_unlock(&mutex);
+}
+
+bool VirtualClock::IsTimerActive(TimerEntry* entry)
+{
+	pthread_mutex_lock(&mutex);
+	bool result = entry->isActive;
+	pthread_mutex_unlock(&mutex);
+
+	return result;
+}
+
+// Virtual timers are never late
+TimerStats VirtualClock::TimerStatistics(TimerEntry* entry)
+{
+	TimerStats result;
+
+	pthread_mutex_lock(&mutex);
+	result.Expirations = entry->expirations;
+	pthread_mutex_unlock(&mutex);
+
+	return result;
+}
+
+unsigned long VirtualClock::TotalExpirations()
+{
+	pthread_mutex_lock(&mutex);
+	unsigned long result = totalExpirations;
+	pthread_mutex_unlock(&mutex);
+
+	return result;
+}
+
+
+
+IMediaClockSPTR MediaClock::Default()
+{
+	return current;
+}
+
+void MediaClock::SetDefault(IMediaClockSPTR value)
+{
+	if (!value)
+		throw ArgumentNullException();
+
+	current = value;
+}
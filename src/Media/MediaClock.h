@@ -0,0 +1,153 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#pragma once
+
+#include "Mutex.h"
+#include "TimerService.h"
+
+#include <pthread.h>
+#include <map>
+#include <memory>
+
+
+
+// Time base that paces the sinks and drives Timers.
+//
+// With the real time clock the devices pace the pipeline: ALSA blocks
+// while its ring is full and Timers run on the TimerService.  A
+// virtual clock lets sinks consume buffers as soon as they arrive;
+// each sink that would have blocked reports how much media it
+// consumed through Advance() instead, and Timers expire when the
+// simulated time passes their deadline.
+class IMediaClock
+{
+public:
+	virtual ~IMediaClock() {}
+
+
+	virtual bool IsVirtual() const = 0;
+
+	// Seconds.  Only differences are meaningful.
+	virtual double Now() = 0;
+
+	// Called by the sink that paces playback (normally the audio
+	// sink) after consuming 'seconds' of media.
+	virtual void Advance(double seconds) = 0;
+
+
+	// See TimerService for the semantics
+	virtual void StartTimer(TimerEntry* entry, double delay, double period) = 0;
+	virtual void CancelTimer(TimerEntry* entry) = 0;
+	virtual bool IsTimerActive(TimerEntry* entry) = 0;
+	virtual TimerStats TimerStatistics(TimerEntry* entry) = 0;
+};
+
+typedef std::shared_ptr<IMediaClock> IMediaClockSPTR;
+
+
+
+// CLOCK_MONOTONIC and the shared TimerService
+class RealTimeClock : public IMediaClock
+{
+public:
+
+	virtual bool IsVirtual() const override
+	{
+		return false;
+	}
+
+	virtual double Now() override;
+
+	// The device has already waited
+	virtual void Advance(double seconds) override
+	{
+	}
+
+
+	virtual void StartTimer(TimerEntry* entry, double delay, double period) override;
+	virtual void CancelTimer(TimerEntry* entry) override;
+	virtual bool IsTimerActive(TimerEntry* entry) override;
+	virtual TimerStats TimerStatistics(TimerEntry* entry) override;
+};
+
+
+
+// Simulated time starting at zero.
+//
+// Advance() runs every Timer callback that falls due, in deadline
+// order, on the calling thread.  Now() reads the deadline of the
+// running callback, so a run driven by the same sequence of Advance()
+// calls sees the same timing every time.  Periodic timers fire once
+// for every period that elapses; none are skipped.
+class VirtualClock : public IMediaClock
+{
+	pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+	pthread_cond_t callbackDone = PTHREAD_COND_INITIALIZER;
+	Mutex advanceMutex;
+	double now = 0;
+	std::multimap<double, TimerEntry*> timers;	// by deadline, FIFO for equal deadlines
+	TimerEntry* runningEntry = nullptr;
+	unsigned long totalExpirations = 0;
+
+
+	// Must be called with mutex held
+	void Unlink(TimerEntry* entry);
+
+
+public:
+
+	VirtualClock() {}
+
+	VirtualClock(const VirtualClock&) = delete;
+	VirtualClock& operator=(const VirtualClock&) = delete;
+
+
+	virtual bool IsVirtual() const override
+	{
+		return true;
+	}
+
+	virtual double Now() override;
+
+	// Ignored when called from a timer callback
+	virtual void Advance(double seconds) override;
+
+
+	virtual void StartTimer(TimerEntry* entry, double delay, double period) override;
+	virtual void CancelTimer(TimerEntry* entry) override;
+	virtual bool IsTimerActive(TimerEntry* entry) override;
+	virtual TimerStats TimerStatistics(TimerEntry* entry) override;
+
+	unsigned long TotalExpirations();
+};
+
+typedef std::shared_ptr<VirtualClock> VirtualClockSPTR;
+
+
+
+// The clock used by sinks and by Timers created afterwards.
+// Select it before building the pipeline.
+class MediaClock
+{
+	static IMediaClockSPTR current;
+
+
+public:
+
+	static IMediaClockSPTR Default();
+	static void SetDefault(IMediaClockSPTR value);
+};
@@ -18,24 +18,122 @@
 
 
 
-double MediaPlayer::Position() const
+SystemClockAnchor::SystemClockAnchor(PublishedClockSPTR clock)
+	: clock(clock)
 {
-	double result;
+	if (!clock)
+		throw ArgumentNullException();
 
-	if (audioSink)
+	timerExpiredListener = std::make_shared<EventListener<EventArgs>>(
+		std::bind(&SystemClockAnchor::timer_Expired, this, std::placeholders::_1, std::placeholders::_2));
+	timer.Expired.AddListener(timerExpiredListener);
+	timer.SetInterval(POLL_INTERVAL);
+
+	mutex.Lock();
+	Arm();
+	mutex.Unlock();
+}
+
+
+void SystemClockAnchor::timer_Expired(void* sender, const EventArgs& args)
+{
+	mutex.Lock();
+
+	if (isArmed)
 	{
-		result = audioSink->Clock();
+		for (auto& source : sources)
+		{
+			double time;
+			if (source.Clock->Stats().Publishes != source.Publishes &&
+				source.Clock->TryGetTime(&time))
+			{
+				isArmed = false;
+				clock->Publish(time, isPlaying ? 1.0 : 0.0);
+				break;
+			}
+		}
 	}
-	else if (videoSink)
+
+	// From its own callback this does not wait
+	if (!isArmed)
 	{
-		result = videoSink->Clock();
+		timer.Cancel();
 	}
-	else
+
+	mutex.Unlock();
+}
+
+void SystemClockAnchor::Arm()
+{
+	isArmed = true;
+
+	for (auto& source : sources)
 	{
-		result = 0;
+		source.Publishes = source.Clock->Stats().Publishes;
 	}
 
-	return result;
+	if (!timer.IsRunning())
+	{
+		timer.Start();
+	}
+}
+
+
+void SystemClockAnchor::AddSource(PublishedClockSPTR source)
+{
+	if (!source)
+		throw ArgumentNullException();
+
+
+	mutex.Lock();
+
+	Source item;
+	item.Clock = source;
+	item.Publishes = source->Stats().Publishes;
+
+	sources.push_back(item);
+
+	mutex.Unlock();
+}
+
+void SystemClockAnchor::Play()
+{
+	mutex.Lock();
+
+	isPlaying = true;
+	if (!isArmed)
+	{
+		clock->Publish(clock->Time());
+	}
+
+	mutex.Unlock();
+}
+
+void SystemClockAnchor::Pause()
+{
+	mutex.Lock();
+
+	isPlaying = false;
+	clock->Freeze();
+
+	mutex.Unlock();
+}
+
+void SystemClockAnchor::Hold(double value)
+{
+	mutex.Lock();
+
+	clock->Publish(value, 0);
+	Arm();
+
+	mutex.Unlock();
+}
+
+
+
+double MediaPlayer::Position() const
+{
+	return masterClock->Time();
 }
 
 double MediaPlayer::Duration() const
@@ -60,6 +158,23 @@ void MediaPlayer::SetState(MediaState value)
 	{
 		state = value;
 
+		// Audio and video clocks are published by their sinks
+		if (systemClockAnchor)
+		{
+			if (state == MediaState::Play)
+			{
+				systemClockAnchor->Play();
+			}
+			else
+			{
+				systemClockAnchor->Pause();
+			}
+		}
+		else if (state == MediaState::Pause)
+		{
+			masterClock->Freeze();
+		}
+
 		if (audioSink)
 		{
 			audioSink->SetState(state);
@@ -129,8 +244,9 @@ const ChapterListSPTR MediaPlayer::Chapters() const
 }
 
 
-MediaPlayer::MediaPlayer(std::string url, std::string avOptions, CompositorSPTR compositor, int videoStream, int audioStream, int subtitleStream)
-	:url(url), avOptions(avOptions), compositor(compositor)
+MediaPlayer::MediaPlayer(std::string url, std::string avOptions, CompositorSPTR compositor, int videoStream, int audioStream, int subtitleStream,
+	MasterClockEnum masterClockType)
+	:url(url), avOptions(avOptions), masterClockType(masterClockType), compositor(compositor)
 {
 	if (!compositor)
 		throw ArgumentNullException();
@@ -147,12 +263,19 @@ MediaPlayer::MediaPlayer(std::string url, std::string avOptions, CompositorSPTR
 		source->Outputs()->Find(MediaCategoryEnum::Video, videoStream));
 	if (sourceVideoPin)
 	{
+		videoFilter = std::make_shared<BitstreamFilterElement>();
+		videoFilter->SetName(std::string("VideoFilter"));
+		videoFilter->Execute();
+		videoFilter->WaitForExecutionState(ExecutionStateEnum::Idle);
+
 		videoSink = std::make_shared<AmlVideoSinkElement>();
 		videoSink->SetName(std::string("VideoSink"));
 		videoSink->Execute();
 		videoSink->WaitForExecutionState(ExecutionStateEnum::Idle);
 
-		sourceVideoPin->Connect(videoSink->Inputs()->Item(0));
+		sourceVideoPin->Connect(videoFilter->Inputs()->Item(0));
+
+		videoFilter->Outputs()->Item(0)->Connect(videoSink->Inputs()->Item(0));
 	}
 
 	OutPinSPTR sourceAudioPin = std::static_pointer_cast<OutPin>(
@@ -193,20 +316,81 @@ MediaPlayer::MediaPlayer(std::string url, std::string avOptions, CompositorSPTR
 
 		subtitleCodec->Outputs()->Item(0)->Connect(subtitleRender->Inputs()->Item(0));
 
+		printf("MediaPlayer: Connected subtitle decoder.\n");
+	}
+
+
+
+	// Clock
+	if (audioSink && videoSink)
+	{
+		// Video is slewed to audio whichever clock is master
+		videoSink->SetAudioClock(audioSink->AudioClock());
+	}
+
+	if (masterClockType == MasterClockEnum::Auto)
+	{
 		if (audioSink)
 		{
-			audioSink->ClockSinks()->Add(subtitleRender);
+			masterClockType = MasterClockEnum::Audio;
 		}
+		else if (videoSink)
+		{
+			masterClockType = MasterClockEnum::Video;
+		}
+		else
+		{
+			masterClockType = MasterClockEnum::System;
+		}
+	}
 
-		printf("MediaPlayer: Connected subtitle decoder.\n");
+	if ((masterClockType == MasterClockEnum::Audio && !audioSink) ||
+		(masterClockType == MasterClockEnum::Video && !videoSink))
+	{
+		printf("MediaPlayer: the requested master clock has no stream, using system.\n");
+		masterClockType = MasterClockEnum::System;
 	}
 
+	switch (masterClockType)
+	{
+		case MasterClockEnum::Audio:
+			masterClock = audioSink->AudioClock();
+			printf("MediaPlayer: master clock is audio.\n");
+			break;
+
+		case MasterClockEnum::Video:
+			masterClock = std::make_shared<PublishedClock>();
+			videoSink->ClockSinks()->Add(masterClock);
+			printf("MediaPlayer: master clock is video.\n");
+			break;
+
+		default:
+		{
+			masterClock = std::make_shared<PublishedClock>();
+			systemClockAnchor = std::make_shared<SystemClockAnchor>(masterClock);
 
+			// Whichever stream presents a timestamp first starts it
+			if (audioSink)
+			{
+				systemClockAnchor->AddSource(audioSink->AudioClock());
+			}
 
-	if (audioSink && videoSink)
+			if (videoSink)
+			{
+				PublishedClockSPTR videoClock = std::make_shared<PublishedClock>();
+				videoSink->ClockSinks()->Add(videoClock);
+
+				systemClockAnchor->AddSource(videoClock);
+			}
+
+			printf("MediaPlayer: master clock is system.\n");
+		}
+		break;
+	}
+
+	if (subtitleRender)
 	{
-		// Clock
-		audioSink->Outputs()->Item(0)->Connect(videoSink->Inputs()->Item(1));
+		subtitleRender->SetClock(masterClock);
 	}
 }
 MediaPlayer::~MediaPlayer()
@@ -244,6 +428,13 @@ MediaPlayer::~MediaPlayer()
 		videoSink->WaitForExecutionState(ExecutionStateEnum::WaitingForExecute);
 	}
 
+	if (videoFilter)
+	{
+		printf("MediaPlayer: terminating videoFilter.\n");
+		videoFilter->Terminate();
+		videoFilter->WaitForExecutionState(ExecutionStateEnum::WaitingForExecute);
+	}
+
 	printf("MediaPlayer: terminating source.\n");
 	source->Terminate();
 	source->WaitForExecutionState(ExecutionStateEnum::WaitingForExecute);
@@ -269,6 +460,12 @@ void MediaPlayer::Seek(double timeStamp)
 		audioSink->SetState(MediaState::Pause);
 	}
 
+	if (videoFilter)
+	{
+		//printf("Seek: videoFilter pause.\n");
+		videoFilter->SetState(MediaState::Pause);
+	}
+
 	if (videoSink)
 	{
 		//printf("Seek: videoSink pause.\n");
@@ -298,6 +495,12 @@ void MediaPlayer::Seek(double timeStamp)
 		audioSink->Flush();
 	}
 
+	if (videoFilter)
+	{
+		//printf("Seek: videoFilter flush.\n");
+		videoFilter->Flush();
+	}
+
 	if (videoSink)
 	{
 		//printf("Seek: videoSink flush.\n");
@@ -318,6 +521,16 @@ void MediaPlayer::Seek(double timeStamp)
 	//printf("Seek: source seek.\n");
 	source->Seek(timeStamp);
 
+	// Holds the target until the new stream position is published
+	if (systemClockAnchor)
+	{
+		systemClockAnchor->Hold(timeStamp);
+	}
+	else
+	{
+		masterClock->Publish(timeStamp, 0.0);
+	}
+
 
 	if (videoSink)
 	{
@@ -325,6 +538,12 @@ void MediaPlayer::Seek(double timeStamp)
 		videoSink->SetState(MediaState::Play);
 	}
 
+	if (videoFilter)
+	{
+		//printf("Seek: videoFilter play.\n");
+		videoFilter->SetState(MediaState::Play);
+	}
+
 	if (audioCodec)
 	{
 		//printf("Seek: audioCodec play.\n");
@@ -19,25 +19,93 @@
 #include "MediaSourceElement.h"
 #include "AlsaAudioSink.h"
 #include "AmlVideoSink.h"
+#include "BitstreamFilterElement.h"
 #include "AudioCodec.h"
 #include "SubtitleCodecElement.h"
 //#include "Egl.h"
 #include "Compositor.h"
+#include "PublishedClock.h"
+#include "Timer.h"
 
 #include <string>
+#include <vector>
 
 
 
+enum class MasterClockEnum
+{
+	Auto = 0,	// Audio when there is an audio stream, otherwise Video
+	Audio,		// ALSA playback position
+	Video,		// decoder VPTS
+	System		// monotonic time from the first presented PTS, held while paused
+};
+
+
+// Runs a System master clock.  The clock stays invalid, or holds a
+// seek target, until a sink presents its first timestamp; from then on
+// it runs on monotonic time and ignores the stream.
+//
+// The sinks are not called into: while armed, a timer polls the
+// clocks they publish and the first one published since arming
+// starts the clock.  Once anchored nothing runs.
+class SystemClockAnchor
+{
+	struct Source
+	{
+		PublishedClockSPTR Clock;
+		unsigned long Publishes;	// when armed; only later ones count
+	};
+
+
+	const double POLL_INTERVAL = 0.01;
+
+	PublishedClockSPTR clock;
+	Mutex mutex;
+	std::vector<Source> sources;
+	bool isArmed = true;	// the next published timestamp starts the clock
+	bool isPlaying = false;
+	EventListenerSPTR<EventArgs> timerExpiredListener;
+	Timer timer;	// after mutex: its destructor waits for a running poll
+
+
+	void timer_Expired(void* sender, const EventArgs& args);
+
+	// Must be called with mutex held
+	void Arm();
+
+
+public:
+
+	SystemClockAnchor(PublishedClockSPTR clock);
+
+
+	// A clock a sink publishes, e.g. the audio clock
+	void AddSource(PublishedClockSPTR source);
+
+	void Play();
+	void Pause();
+
+	// Holds 'value' until a source publishes again
+	void Hold(double value);
+};
+
+typedef std::shared_ptr<SystemClockAnchor> SystemClockAnchorSPTR;
+
+
 class MediaPlayer
 {
 	std::string url;
 	std::string avOptions;
 	MediaSourceElementSPTR source;
+	BitstreamFilterElementSPTR videoFilter;
 	AmlVideoSinkElementSPTR videoSink;
 	AudioCodecElementSPTR audioCodec;
 	AlsaAudioSinkElementSPTR audioSink;
 	SubtitleDecoderElementSPTR subtitleCodec;
 	SubtitleRenderElementSPTR subtitleRender;
+	MasterClockEnum masterClockType = MasterClockEnum::Auto;
+	PublishedClockSPTR masterClock;
+	SystemClockAnchorSPTR systemClockAnchor;	// System only
 
 	MediaState state = MediaState::Pause;
 	//EGLDisplay eglDisplay = nullptr;
@@ -48,6 +116,12 @@ class MediaPlayer
 public:
 
 	double Position() const;
+
+	// The clock every consumer follows; never Auto
+	MasterClockEnum MasterClockType() const
+	{
+		return masterClockType;
+	}
 	
 	double Duration() const;
 
@@ -68,7 +142,8 @@ public:
 
 
 
-	MediaPlayer(std::string url, std::string avOptions, CompositorSPTR compositor, int videoStream, int audioStream, int subtitleStream);
+	MediaPlayer(std::string url, std::string avOptions, CompositorSPTR compositor, int videoStream, int audioStream, int subtitleStream,
+		MasterClockEnum masterClockType = MasterClockEnum::Auto);
 	~MediaPlayer();
 
 
@@ -411,6 +411,9 @@ const ChapterListSPTR MediaSourceElement::Chapters() const
 MediaSourceElement::MediaSourceElement(std::string url, std::string avOptions)
 	: url(url)
 {
+	// DoWork blocks waiting for buffers to be returned
+	SetExecutionMode(ExecutionModeEnum::Dedicated);
+
 	AVDictionary* options_dict = NULL;
 
 	/*
@@ -532,7 +535,9 @@ void MediaSourceElement::DoWork()
 	//printf("MediaElement (%s) DoWork availableBuffers count=%d.\n", Name().c_str(), availableBuffers.Count());
 
 	// Process
-	if (availableBuffers.TryPop(&freeBuffer))
+	// Blocks until a downstream pin returns a buffer.  Pausing
+	// cancels the wait so the element can go Idle.
+	if (availableBuffers.Pop(&freeBuffer))
 	{
 		//printf("MediaElement (%s) DoWork availableBuffers.TryPop=true.\n", Name().c_str());
 
@@ -616,6 +621,26 @@ void MediaSourceElement::DoWork()
 }
 
 
+void MediaSourceElement::ChangeState(MediaState oldState, MediaState newState)
+{
+	switch (newState)
+	{
+		case MediaState::Pause:
+			availableBuffers.Cancel();
+			break;
+
+		case MediaState::Play:
+			availableBuffers.Reset();
+			break;
+
+		default:
+			break;
+	}
+
+	Element::ChangeState(oldState, newState);
+}
+
+
 void MediaSourceElement::Seek(double timeStamp)
 {
 	if (ExecutionState() != ExecutionStateEnum::Idle)
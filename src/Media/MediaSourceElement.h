@@ -80,7 +80,7 @@ class MediaSourceElement : public Element
 	std::string url;
 	AVFormatContext* ctx = nullptr;
 	
-	ThreadSafeQueue<BufferSPTR> availableBuffers;
+	LockedQueue<BufferSPTR> availableBuffers;
 	std::vector<OutPinSPTR> streamList;
 	std::vector<uint64_t> streamNextPts;
 
@@ -114,6 +114,12 @@ public:
 
 	virtual void Initialize() override;
 	virtual void DoWork() override;
+	virtual void ChangeState(MediaState oldState, MediaState newState) override;
+
+	QueueWaitStats BufferWaitStats()
+	{
+		return availableBuffers.Stats();
+	}
 
 	void Seek(double timeStamp);
 
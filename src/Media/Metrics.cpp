@@ -0,0 +1,288 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#include "Metrics.h"
+
+#include "Element.h"
+#include "Exception.h"
+#include "Thread.h"
+
+#include <unistd.h>
+
+
+std::atomic<const MetricsRegistry::ElementList*> MetricsRegistry::elements(nullptr);
+Mutex MetricsRegistry::mutex;
+
+// Replaced lists are kept so unlocked readers never see freed memory
+static std::vector<std::unique_ptr<std::vector<ElementWPTR>>> retiredLists;
+
+std::atomic<bool> ElementMetrics::isCpuTimeEnabled(false);
+
+static ThreadSPTR reportThread;
+static std::atomic<bool> isReporting(false);
+
+
+
+ElementMetrics::ElementMetrics()
+	: workCount(0), workNanoseconds(0), workCpuNanoseconds(0), workMaxNanoseconds(0),
+	idleTransitions(0), executeTransitions(0)
+{
+	for (int i = 0; i < HISTOGRAM_BUCKETS; ++i)
+	{
+		histogram[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+void ElementMetrics::RecordWork(uint64_t nanoseconds, uint64_t cpuNanoseconds)
+{
+	histogram[Bucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+	workCount.fetch_add(1, std::memory_order_relaxed);
+	workNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+	workCpuNanoseconds.fetch_add(cpuNanoseconds, std::memory_order_relaxed);
+
+	uint64_t max = workMaxNanoseconds.load(std::memory_order_relaxed);
+	while (nanoseconds > max &&
+		!workMaxNanoseconds.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed))
+	{
+	}
+}
+
+
+
+void ElementMetricsSnapshot::Capture(const ElementMetrics& metrics)
+{
+	for (int i = 0; i < ElementMetrics::HISTOGRAM_BUCKETS; ++i)
+	{
+		WorkHistogram[i] = metrics.histogram[i].load(std::memory_order_relaxed);
+	}
+
+	WorkCount = metrics.workCount.load(std::memory_order_relaxed);
+	WorkSeconds = metrics.workNanoseconds.load(std::memory_order_relaxed) / 1000000000.0;
+	WorkCpuSeconds = metrics.workCpuNanoseconds.load(std::memory_order_relaxed) / 1000000000.0;
+	WorkMaxSeconds = metrics.workMaxNanoseconds.load(std::memory_order_relaxed) / 1000000000.0;
+	IdleTransitions = metrics.idleTransitions.load(std::memory_order_relaxed);
+	ExecuteTransitions = metrics.executeTransitions.load(std::memory_order_relaxed);
+}
+
+double ElementMetricsSnapshot::WorkPercentile(double percentile) const
+{
+	uint64_t total = 0;
+	for (int i = 0; i < ElementMetrics::HISTOGRAM_BUCKETS; ++i)
+	{
+		total += WorkHistogram[i];
+	}
+
+	if (total == 0)
+		return 0;
+
+
+	uint64_t target = (uint64_t)(total * percentile);
+	uint64_t sum = 0;
+
+	for (int i = 0; i < ElementMetrics::HISTOGRAM_BUCKETS; ++i)
+	{
+		sum += WorkHistogram[i];
+		if (sum > target)
+		{
+			return ElementMetrics::BucketLimit(i);
+		}
+	}
+
+	return ElementMetrics::BucketLimit(ElementMetrics::HISTOGRAM_BUCKETS - 1);
+}
+
+
+
+void MetricsRegistry::Add(ElementSPTR element)
+{
+	if (!element)
+		throw ArgumentNullException();
+
+	mutex.Lock();
+
+	const ElementList* current = elements.load(std::memory_order_acquire);
+
+	ElementList* list = new ElementList();
+	if (current)
+	{
+		for (auto& item : *current)
+		{
+			if (!item.expired())
+			{
+				list->push_back(item);
+			}
+		}
+	}
+
+	list->push_back(element);
+
+	elements.store(list, std::memory_order_release);
+
+	if (current)
+	{
+		retiredLists.push_back(std::unique_ptr<ElementList>(const_cast<ElementList*>(current)));
+	}
+
+	mutex.Unlock();
+}
+
+MetricsSnapshot MetricsRegistry::Snapshot(const MetricsSnapshot* previous)
+{
+	MetricsSnapshot result;
+	result.TimeStamp = ElementMetrics::Now() / 1000000000.0;
+
+	const ElementList* list = elements.load(std::memory_order_acquire);
+	if (list)
+	{
+		for (auto& item : *list)
+		{
+			ElementSPTR element = item.lock();
+			if (element)
+			{
+				result.Elements.push_back(element->SnapshotMetrics());
+			}
+		}
+	}
+
+
+	if (previous)
+	{
+		double elapsed = result.TimeStamp - previous->TimeStamp;
+
+		for (auto& element : result.Elements)
+		{
+			for (auto& last : previous->Elements)
+			{
+				if (last.Name != element.Name ||
+					last.Pins.size() != element.Pins.size())
+				{
+					continue;
+				}
+
+				for (size_t i = 0; i < element.Pins.size() && elapsed > 0; ++i)
+				{
+					PinMetricsSnapshot& pin = element.Pins[i];
+
+					pin.BuffersPerSecond = (pin.Buffers - last.Pins[i].Buffers) / elapsed;
+					pin.BytesPerSecond = (pin.Bytes - last.Pins[i].Bytes) / elapsed;
+				}
+
+				break;
+			}
+		}
+	}
+
+	return result;
+}
+
+void MetricsRegistry::Print(FILE* file, const MetricsSnapshot& snapshot)
+{
+	fprintf(file, "Metrics: t=%.3f\n", snapshot.TimeStamp);
+
+	for (auto& element : snapshot.Elements)
+	{
+		fprintf(file, "  %s: DoWork=%llu total=%.3fs p50<%.6fs p99<%.6fs max=%.6fs idle=%llu execute=%llu\n",
+			element.Name.c_str(),
+			(unsigned long long)element.WorkCount,
+			element.WorkSeconds,
+			element.WorkPercentile(0.50),
+			element.WorkPercentile(0.99),
+			element.WorkMaxSeconds,
+			(unsigned long long)element.IdleTransitions,
+			(unsigned long long)element.ExecuteTransitions);
+
+		for (auto& pin : element.Pins)
+		{
+			if (pin.IsInput)
+			{
+				fprintf(file, "    in  %-12s filled=%d processed=%d", pin.Name.c_str(), pin.FilledCount, pin.ProcessedCount);
+			}
+			else
+			{
+				fprintf(file, "    out %-12s available=%d", pin.Name.c_str(), pin.AvailableCount);
+			}
+
+			fprintf(file, " buffers=%llu (%.1f/s) bytes=%llu (%.1f KB/s)",
+				(unsigned long long)pin.Buffers,
+				pin.BuffersPerSecond,
+				(unsigned long long)pin.Bytes,
+				pin.BytesPerSecond / 1024.0);
+
+			if (pin.Lag > 0 || pin.Dropped > 0)
+			{
+				fprintf(file, " lag=%d dropped=%llu", pin.Lag, (unsigned long long)pin.Dropped);
+			}
+
+			fprintf(file, "\n");
+		}
+	}
+}
+
+void MetricsRegistry::ReportThread(double interval)
+{
+	MetricsSnapshot previous = Snapshot();
+	double elapsed = 0;
+
+	while (isReporting.load())
+	{
+		usleep(100000);
+		elapsed += 0.1;
+
+		if (elapsed >= interval)
+		{
+			MetricsSnapshot current = Snapshot(&previous);
+			Print(stderr, current);
+
+			previous = current;
+			elapsed = 0;
+		}
+	}
+}
+
+void MetricsRegistry::StartReporting(double interval)
+{
+	if (interval <= 0)
+		throw ArgumentOutOfRangeException("interval");
+
+	mutex.Lock();
+
+	if (!reportThread)
+	{
+		isReporting.store(true);
+
+		reportThread = std::make_shared<Thread>(std::function<void()>(std::bind(&MetricsRegistry::ReportThread, interval)));
+		reportThread->Start();
+	}
+
+	mutex.Unlock();
+}
+
+void MetricsRegistry::StopReporting()
+{
+	mutex.Lock();
+
+	ThreadSPTR thread = reportThread;
+	reportThread = nullptr;
+
+	mutex.Unlock();
+
+
+	if (thread)
+	{
+		isReporting.store(false);
+		thread->Join();
+	}
+}
@@ -0,0 +1,245 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#pragma once
+
+#include "Mutex.h"
+
+#include <cstdio>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <time.h>
+
+
+class Element;
+typedef std::shared_ptr<Element> ElementSPTR;
+typedef std::weak_ptr<Element> ElementWPTR;
+
+
+
+// Counters are updated with relaxed atomics on the hot path and
+// read the same way by snapshots; no locks are taken either side.
+class PinMetrics
+{
+	std::atomic<uint64_t> buffers;
+	std::atomic<uint64_t> bytes;
+
+
+public:
+
+	uint64_t Buffers() const
+	{
+		return buffers.load(std::memory_order_relaxed);
+	}
+
+	uint64_t Bytes() const
+	{
+		return bytes.load(std::memory_order_relaxed);
+	}
+
+
+
+	PinMetrics()
+		: buffers(0), bytes(0)
+	{
+	}
+
+	PinMetrics(const PinMetrics&) = delete;
+	PinMetrics& operator=(const PinMetrics&) = delete;
+
+
+
+	void Record(int length)
+	{
+		buffers.fetch_add(1, std::memory_order_relaxed);
+
+		if (length > 0)
+		{
+			bytes.fetch_add(length, std::memory_order_relaxed);
+		}
+	}
+};
+
+
+struct PinMetricsSnapshot
+{
+	std::string Name;
+	bool IsInput = false;
+	int FilledCount = 0;		// InPin: waiting for DoWork
+	int ProcessedCount = 0;		// InPin: waiting to be returned
+	int AvailableCount = 0;		// OutPin: free for the element
+	uint64_t Buffers = 0;		// received (InPin) or sent (OutPin)
+	uint64_t Bytes = 0;
+	double BuffersPerSecond = 0;
+	double BytesPerSecond = 0;
+	int Lag = 0;				// TeeOutPin: buffers waiting or in flight
+	uint64_t Dropped = 0;		// TeeOutPin: buffers dropped by policy
+};
+
+
+
+class ElementMetrics
+{
+public:
+
+	// Bucket 0 is < 1us, bucket n is [2^(n-1), 2^n) us and the
+	// last bucket holds everything longer.
+	static const int HISTOGRAM_BUCKETS = 24;
+
+
+private:
+
+	std::atomic<uint64_t> histogram[HISTOGRAM_BUCKETS];
+	std::atomic<uint64_t> workCount;
+	std::atomic<uint64_t> workNanoseconds;
+	std::atomic<uint64_t> workCpuNanoseconds;
+	std::atomic<uint64_t> workMaxNanoseconds;
+	std::atomic<uint64_t> idleTransitions;
+	std::atomic<uint64_t> executeTransitions;
+
+	static std::atomic<bool> isCpuTimeEnabled;
+
+
+public:
+
+	ElementMetrics();
+
+	ElementMetrics(const ElementMetrics&) = delete;
+	ElementMetrics& operator=(const ElementMetrics&) = delete;
+
+
+	static uint64_t Now()
+	{
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+
+		return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	}
+
+	static int Bucket(uint64_t nanoseconds)
+	{
+		uint64_t microseconds = nanoseconds / 1000;
+		if (microseconds < 1)
+			return 0;
+
+		int result = 64 - __builtin_clzll(microseconds);
+		return (result < HISTOGRAM_BUCKETS) ? result : HISTOGRAM_BUCKETS - 1;
+	}
+
+	// Upper bound of a bucket in seconds
+	static double BucketLimit(int bucket)
+	{
+		return (double)(1ULL << bucket) / 1000000.0;
+	}
+
+
+	// Thread CPU time costs a syscall per DoWork, so it is off
+	// unless a tool (c2play-bench) asks for it.
+	static bool IsCpuTimeEnabled()
+	{
+		return isCpuTimeEnabled.load(std::memory_order_relaxed);
+	}
+	static void SetCpuTimeEnabled(bool value)
+	{
+		isCpuTimeEnabled.store(value, std::memory_order_relaxed);
+	}
+
+	static uint64_t ThreadCpuTime()
+	{
+		timespec ts;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+		return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	}
+
+
+	void RecordWork(uint64_t nanoseconds, uint64_t cpuNanoseconds);
+
+	void RecordIdle()
+	{
+		idleTransitions.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void RecordExecute()
+	{
+		executeTransitions.fetch_add(1, std::memory_order_relaxed);
+	}
+
+
+	friend struct ElementMetricsSnapshot;
+};
+
+
+struct ElementMetricsSnapshot
+{
+	std::string Name;
+	uint64_t WorkCount = 0;
+	double WorkSeconds = 0;
+	double WorkCpuSeconds = 0;		// only with ElementMetrics::SetCpuTimeEnabled
+	double WorkMaxSeconds = 0;
+	uint64_t WorkHistogram[ElementMetrics::HISTOGRAM_BUCKETS] = {};
+	uint64_t IdleTransitions = 0;
+	uint64_t ExecuteTransitions = 0;
+	std::vector<PinMetricsSnapshot> Pins;
+
+
+	void Capture(const ElementMetrics& metrics);
+
+	// Upper bound (bucket limit) of the given DoWork percentile
+	double WorkPercentile(double percentile) const;
+};
+
+
+struct MetricsSnapshot
+{
+	double TimeStamp = 0;	// CLOCK_MONOTONIC seconds
+	std::vector<ElementMetricsSnapshot> Elements;
+};
+
+
+
+class MetricsRegistry
+{
+	typedef std::vector<ElementWPTR> ElementList;
+
+
+	static std::atomic<const ElementList*> elements;
+	static Mutex mutex;	// Add and reporter start/stop only
+
+
+	static void ReportThread(double interval);
+
+
+public:
+
+	// Elements register themselves on Execute
+	static void Add(ElementSPTR element);
+
+	// Walks the element list without the registry lock, but each
+	// element briefly takes its own lock to copy its name and
+	// pins.  When previous is given, rates cover the time
+	// since it; otherwise they are zero.
+	static MetricsSnapshot Snapshot(const MetricsSnapshot* previous = nullptr);
+
+	static void Print(FILE* file, const MetricsSnapshot& snapshot);
+
+	// Periodically prints a snapshot to stderr
+	static void StartReporting(double interval);
+	static void StopReporting();
+};
@@ -43,6 +43,13 @@ public:
 		BufferSPTR buffer;
 		while (pin->TryGetFilledBuffer(&buffer))
 		{
+			if (buffer->Type() == BufferTypeEnum::Marker &&
+				std::static_pointer_cast<MarkerBuffer>(buffer)->Marker() == MarkerEnum::EndOfStream)
+			{
+				// Like the other sinks, pause at the end of the stream
+				SetState(MediaState::Pause);
+			}
+
 			pin->PushProcessedBuffer(buffer);
 		}
 
@@ -20,25 +20,13 @@
 #include "Element.h"
 
 
-void OutPin::WorkThread()
+void OutPin::RunWork()
 {
-	//printf("OutPin: WorkTread started.\n");
-
-	while (true)
+	ElementSPTR owner = Owner().lock();
+	if (owner && owner->State() == MediaState::Play)
 	{
-		// Scope the shared pointer
-		{
-			ElementSPTR owner = Owner().lock();
-			if (owner && owner->State() == MediaState::Play)
-			{
-				DoWork();
-			}
-		}
-
-		waitCondition.WaitForSignal();
+		DoWork();
 	}
-
-	//printf("OutPin: WorkTread exited.\n");
 }
 
 
@@ -85,6 +73,9 @@ void OutPin::SendBuffer(BufferSPTR buffer)
 {
 	InPinSPTR pin = sink;
 
+	TRACE_INSTANT("SendBuffer", buffer.get());
+	RecordBuffer(buffer);
+
 	if (pin)
 	{
 		auto owner = pin->Owner().lock();
@@ -113,9 +104,22 @@ void OutPin::Flush()
 	// TODO: cascade to connected pin?
 }
 
+PinMetricsSnapshot OutPin::SnapshotMetrics()
+{
+	PinMetricsSnapshot result = Pin::SnapshotMetrics();
+	result.AvailableCount = availableBuffers.Count();
+
+	return result;
+}
+
 
 OutPin::~OutPin()
 {
+	if (pinWork)
+	{
+		pinWork->Cancel();
+	}
+
 	if (sink)
 	{
 		OutPinSPTR thisPin = std::static_pointer_cast<OutPin>(shared_from_this());
@@ -126,7 +130,11 @@ OutPin::~OutPin()
 
 void OutPin::Wake()
 {
-	waitCondition.Signal();
+	WorkItemSPTR item = pinWork;
+	if (item)
+	{
+		item->Schedule();
+	}
 }
 
 
@@ -157,8 +165,17 @@ void OutPin::Connect(InPinSPTR sink)
 	this->sink->AcceptConnection(thisPin);
 
 		
-	pinThread = std::make_shared<Thread>(std::function<void()>(std::bind(&OutPin::WorkThread, this)));
-	pinThread->Start();
+	if (pinWork)
+	{
+		pinWork->Cancel();
+		pinWork.reset();
+	}
+
+	if (HasWork())
+	{
+		pinWork = std::make_shared<WorkItem>(std::function<void()>(std::bind(&OutPin::RunWork, this)));
+		pinWork->Schedule();
+	}
 
 
 	sinkMutex.Unlock();
@@ -178,8 +195,8 @@ void OutPin::AcceptProcessedBuffer(BufferSPTR buffer)
 	//availableBuffers.Push(buffer);
 	AddAvailableBuffer(buffer);
 
-	// Wake the work thread
-	waitCondition.Signal();
+	// Schedule the pin work
+	Wake();
 
 	//BufferEventArgs args(buffer);
 	BufferReturned.Invoke(this, EventArgs::Empty());
@@ -18,8 +18,8 @@
 
 
 #include "Pin.h"
-#include "Thread.h"
-#include "WaitCondition.h"
+#include "Executor.h"
+#include "LockedQueue.h"
 #include "Event.h"
 #include "EventArgs.h"
 
@@ -55,17 +55,31 @@ class OutPin : public Pin
 	InPinSPTR sink;
 	Mutex sinkMutex;
 	//ThreadSafeQueue<BufferSPTR> filledBuffers;
+
+	// Multi-producer, multi-consumer.  Buffers come back from the
+	// sink's thread (ReturnProcessedBuffers), from whichever thread
+	// flushes or disconnects the sink (ReturnAllBuffers) and from
+	// this element's own thread when SendBuffer cannot deliver.
+	// They are taken by the owner's thread and by BufferReturned
+	// listeners, which run on the returning thread.
 	ThreadSafeQueue<BufferSPTR> availableBuffers;
-	ThreadSPTR pinThread;
-	WaitCondition waitCondition;
+	WorkItemSPTR pinWork;
 
 
-	void WorkThread();
+	void RunWork();
 
 
 protected:
 
 	void AddAvailableBuffer(BufferSPTR buffer);
+
+	// Pins that override DoWork return true; only they get a work
+	// item, so plain pins cost nothing per buffer.
+	virtual bool HasWork() const
+	{
+		return false;
+	}
+
 	virtual void DoWork();
 
 
@@ -84,10 +98,11 @@ public:
 	bool TryPeekAvailableBuffer(BufferSPTR* buffer);
 	void SendBuffer(BufferSPTR buffer);
 	virtual void Flush() override;
+	virtual PinMetricsSnapshot SnapshotMetrics() override;
 
 
 	void Connect(InPinSPTR sink);
-	void AcceptProcessedBuffer(BufferSPTR buffer);
+	virtual void AcceptProcessedBuffer(BufferSPTR buffer);
 };
 
 //typedef std::shared_ptr<OutPin> OutPinSPTR;
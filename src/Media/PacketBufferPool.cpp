@@ -0,0 +1,121 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#include "PacketBufferPool.h"
+
+#include "Exception.h"
+
+#include <cstring>
+
+
+int PacketBufferPool::BucketIndex(int size)
+{
+	int shift = MIN_BUCKET_SHIFT;
+	while ((1 << shift) < size)
+	{
+		++shift;
+	}
+
+	return shift - MIN_BUCKET_SHIFT;
+}
+
+
+
+PacketBufferPool::PacketBufferPool()
+	: packets(0), pooledPackets(0), allocations(0)
+{
+}
+
+PacketBufferPool::~PacketBufferPool()
+{
+	// Buffers still referenced are freed when they are released
+	for (int i = 0; i < BUCKET_COUNT; ++i)
+	{
+		if (pools[i])
+		{
+			av_buffer_pool_uninit(&pools[i]);
+		}
+	}
+}
+
+
+
+void PacketBufferPool::NewPacket(AVPacket* pkt, int size)
+{
+	if (!pkt)
+		throw ArgumentNullException();
+
+	if (size < 0)
+		throw ArgumentOutOfRangeException();
+
+	if (pkt->buf)
+		throw InvalidOperationException("The packet already has a payload.");
+
+
+	packets.fetch_add(1, std::memory_order_relaxed);
+
+	int required = size + AV_INPUT_BUFFER_PADDING_SIZE;
+	AVBufferRef* buf = nullptr;
+
+	if (required <= (1 << MAX_BUCKET_SHIFT))
+	{
+		int index = BucketIndex(required);
+		if (!pools[index])
+		{
+			pools[index] = av_buffer_pool_init(1 << (MIN_BUCKET_SHIFT + index), av_buffer_alloc);
+		}
+
+		if (pools[index])
+		{
+			buf = av_buffer_pool_get(pools[index]);
+		}
+	}
+
+	if (!buf)
+	{
+		if (av_new_packet(pkt, size) < 0)
+		{
+			throw Exception("PacketBufferPool: av_new_packet failed.");
+		}
+
+		return;
+	}
+
+	// A pool keeps the buffers it allocates until it is destroyed,
+	// so a payload not seen before is one it had to allocate.
+	if (pooledData.insert(buf->data).second)
+	{
+		allocations.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	memset(buf->data + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+
+	pkt->buf = buf;
+	pkt->data = buf->data;
+	pkt->size = size;
+
+	pooledPackets.fetch_add(1, std::memory_order_relaxed);
+}
+
+PacketBufferPoolStats PacketBufferPool::Stats() const
+{
+	PacketBufferPoolStats result;
+	result.Packets = packets.load(std::memory_order_relaxed);
+	result.PooledPackets = pooledPackets.load(std::memory_order_relaxed);
+	result.Allocations = allocations.load(std::memory_order_relaxed);
+
+	return result;
+}
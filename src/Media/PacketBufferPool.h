@@ -0,0 +1,79 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#pragma once
+
+#include <atomic>
+#include <unordered_set>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavutil/buffer.h>
+}
+
+
+#ifndef AV_INPUT_BUFFER_PADDING_SIZE
+#define AV_INPUT_BUFFER_PADDING_SIZE FF_INPUT_BUFFER_PADDING_SIZE
+#endif
+
+
+struct PacketBufferPoolStats
+{
+	unsigned long Packets = 0;			// Packets given a payload by NewPacket
+	unsigned long PooledPackets = 0;	// Payloads taken from a pool
+	unsigned long Allocations = 0;		// Pool buffers allocated from the heap
+};
+
+
+// Size bucketed AVBufferPools for packets an element builds itself.
+//
+// NewPacket() hands out a recycled buffer from the smallest fitting
+// power-of-two bucket in place of av_new_packet, so steady state
+// output costs no heap allocation.  A bucket's pool is created on
+// first use; only the sizes a stream actually needs hold memory.
+class PacketBufferPool
+{
+	static const int MIN_BUCKET_SHIFT = 12;	// 4 KB
+	static const int MAX_BUCKET_SHIFT = 25;	// 32 MB
+	static const int BUCKET_COUNT = MAX_BUCKET_SHIFT - MIN_BUCKET_SHIFT + 1;
+
+	AVBufferPool* pools[BUCKET_COUNT] = { 0 };
+	std::unordered_set<const void*> pooledData;	// every payload the pools have allocated
+	std::atomic<unsigned long> packets;
+	std::atomic<unsigned long> pooledPackets;
+	std::atomic<unsigned long> allocations;
+
+
+	static int BucketIndex(int size);
+
+
+public:
+
+	PacketBufferPool();
+	~PacketBufferPool();
+
+	PacketBufferPool(const PacketBufferPool&) = delete;
+	PacketBufferPool& operator=(const PacketBufferPool&) = delete;
+
+
+	// Gives an empty packet a pooled payload of 'size' bytes with
+	// zeroed padding, as av_new_packet does.  Must be called from
+	// a single thread.
+	void NewPacket(AVPacket* pkt, int size);
+
+	PacketBufferPoolStats Stats() const;
+};
@@ -18,6 +18,7 @@
 
 #include "Codec.h"
 #include "Buffer.h"
+#include "Metrics.h"
 
 
 #include <memory>
@@ -125,6 +126,7 @@ public:
 	double FrameRate = 0;
 	ExtraDataSPTR ExtraData;
 	bool HasEstimatedPts = false;
+	bool IsDecoderReady = false;	// Annex-B access units with headers inserted
 };
 typedef std::shared_ptr<VideoPinInfo> VideoPinInfoSPTR;
 
@@ -185,6 +187,7 @@ class Pin : public std::enable_shared_from_this<Pin>
 	ElementWPTR owner;
 	PinInfoSPTR info;
 	std::string name;
+	PinMetrics metrics;
 
 
 protected:
@@ -203,6 +206,12 @@ protected:
 	}
 
 
+	void RecordBuffer(BufferSPTR buffer)
+	{
+		metrics.Record(buffer->DataLength());
+	}
+
+
 public:
 
 	PinDirectionEnum Direction() const
@@ -239,6 +248,19 @@ public:
 	virtual void Flush()
 	{
 	}
+
+	// Queue depths are approximate; overrides may briefly take
+	// the lock of a queue they report on.
+	virtual PinMetricsSnapshot SnapshotMetrics()
+	{
+		PinMetricsSnapshot result;
+		result.Name = name;
+		result.IsInput = (direction == PinDirectionEnum::In);
+		result.Buffers = metrics.Buffers();
+		result.Bytes = metrics.Bytes();
+
+		return result;
+	}
 };
 
 
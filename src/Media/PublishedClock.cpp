@@ -0,0 +1,156 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#include "PublishedClock.h"
+
+#include "Exception.h"
+
+
+
+PublishedClock::PublishedClock()
+	: PublishedClock(MediaClock::Default())
+{
+}
+
+PublishedClock::PublishedClock(IMediaClockSPTR mediaClock)
+	: mediaClock(mediaClock),
+	sequence(0), timeStamp(0), captureTime(0), rate(0), isValid(false),
+	publishes(0), retries(0)
+{
+	if (!mediaClock)
+		throw ArgumentNullException();
+}
+
+
+void PublishedClock::Store(double timeStampValue, double captureTimeValue, double rateValue, bool isValidValue)
+{
+	// An odd sequence marks the fields as being written
+	unsigned int start = sequence.load(std::memory_order_relaxed);
+	sequence.store(start + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	timeStamp.store(timeStampValue, std::memory_order_relaxed);
+	captureTime.store(captureTimeValue, std::memory_order_relaxed);
+	rate.store(rateValue, std::memory_order_relaxed);
+	isValid.store(isValidValue, std::memory_order_relaxed);
+
+	sequence.store(start + 2, std::memory_order_release);
+
+	publishes.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PublishedClock::Publish(double value, double rate)
+{
+	if (rate < 0)
+		throw ArgumentOutOfRangeException();
+
+	publishMutex.Lock();
+	Store(value, mediaClock->Now(), rate, true);
+	publishMutex.Unlock();
+}
+
+void PublishedClock::Freeze()
+{
+	publishMutex.Lock();
+
+	ClockSample sample = Read();
+	if (sample.IsValid && sample.Rate != 0)
+	{
+		double now = mediaClock->Now();
+		Store(sample.Extrapolate(now), now, 0, true);
+	}
+
+	publishMutex.Unlock();
+}
+
+void PublishedClock::Invalidate()
+{
+	publishMutex.Lock();
+	Store(0, mediaClock->Now(), 0, false);
+	publishMutex.Unlock();
+}
+
+
+ClockSample PublishedClock::Read()
+{
+	ClockSample result;
+
+	while (true)
+	{
+		unsigned int start = sequence.load(std::memory_order_acquire);
+		if ((start & 1) == 0)
+		{
+			result.TimeStamp = timeStamp.load(std::memory_order_relaxed);
+			result.CaptureTime = captureTime.load(std::memory_order_relaxed);
+			result.Rate = rate.load(std::memory_order_relaxed);
+			result.IsValid = isValid.load(std::memory_order_relaxed);
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (sequence.load(std::memory_order_relaxed) == start)
+			{
+				break;
+			}
+		}
+
+		retries.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	return result;
+}
+
+bool PublishedClock::TryGetTime(double* outValue)
+{
+	if (outValue == nullptr)
+		throw ArgumentNullException();
+
+
+	ClockSample sample = Read();
+	if (!sample.IsValid)
+	{
+		return false;
+	}
+
+	*outValue = sample.Extrapolate(mediaClock->Now());
+
+	return true;
+}
+
+double PublishedClock::Time()
+{
+	double result;
+	if (!TryGetTime(&result))
+	{
+		result = 0;
+	}
+
+	return result;
+}
+
+PublishedClockStats PublishedClock::Stats() const
+{
+	PublishedClockStats result;
+
+	result.Publishes = publishes.load(std::memory_order_relaxed);
+	result.Retries = retries.load(std::memory_order_relaxed);
+
+	return result;
+}
+
+
+void PublishedClock::SetTimeStamp(double value)
+{
+	Publish(value, 1.0);
+}
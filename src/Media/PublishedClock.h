@@ -0,0 +1,115 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#pragma once
+
+#include "Mutex.h"
+#include "MediaClock.h"
+#include "IClock.h"
+
+#include <atomic>
+#include <memory>
+
+
+
+// One consistent reading of a PublishedClock
+struct ClockSample
+{
+	double TimeStamp = 0;	// media seconds at CaptureTime
+	double CaptureTime = 0;	// IMediaClock::Now() when published
+	double Rate = 0;		// media seconds per clock second, 0 while paused
+	bool IsValid = false;	// false until the first Publish
+
+
+	double Extrapolate(double now) const
+	{
+		return TimeStamp + (now - CaptureTime) * Rate;
+	}
+};
+
+
+struct PublishedClockStats
+{
+	unsigned long Publishes = 0;
+	unsigned long Retries = 0;	// reads repeated because a publish overlapped
+};
+
+
+// A media clock any thread can read without locking.
+//
+// The owner publishes a timestamp, the capture time and the rate;
+// readers extrapolate from that.  The fields are guarded by a
+// sequence lock: publishers serialize on a mutex and bump the
+// sequence around the update, readers retry only while a publish is
+// in progress.  Neither side ever waits on the other, so a reader on
+// the render or UI thread cannot stall the thread that owns the clock.
+//
+// As an IClockSink it can be fed by any element that pushes time.
+class PublishedClock : public virtual IClockSink
+{
+	IMediaClockSPTR mediaClock;
+	Mutex publishMutex;
+
+	std::atomic<unsigned int> sequence;
+	std::atomic<double> timeStamp;
+	std::atomic<double> captureTime;
+	std::atomic<double> rate;
+	std::atomic<bool> isValid;
+
+	std::atomic<unsigned long> publishes;
+	std::atomic<unsigned long> retries;
+
+
+	// Must be called with publishMutex held
+	void Store(double timeStampValue, double captureTimeValue, double rateValue, bool isValidValue);
+
+
+public:
+
+	// Uses the MediaClock default at the time of construction
+	PublishedClock();
+	PublishedClock(IMediaClockSPTR mediaClock);
+
+	PublishedClock(const PublishedClock&) = delete;
+	PublishedClock& operator=(const PublishedClock&) = delete;
+
+
+	// 'value' is the media time playing now
+	void Publish(double value, double rate = 1.0);
+
+	// Holds the extrapolated time, e.g. while paused
+	void Freeze();
+
+	// Readers see IsValid == false until the next Publish
+	void Invalidate();
+
+
+	ClockSample Read();
+
+	// False until the first Publish
+	bool TryGetTime(double* outValue);
+
+	// The extrapolated time, or 0 before the first Publish
+	double Time();
+
+	PublishedClockStats Stats() const;
+
+
+	// Inherited via IClockSink.  Publishes 'value' as playing.
+	virtual void SetTimeStamp(double value) override;
+};
+
+typedef std::shared_ptr<PublishedClock> PublishedClockSPTR;
@@ -0,0 +1,286 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#pragma once
+
+#include "Mutex.h"
+#include "Exception.h"
+
+#include <atomic>
+#include <queue>
+#include <vector>
+#include <cstddef>
+
+
+// Lock-free single-producer/single-consumer ring with an unbounded
+// overflow.
+//
+// Push/TryPush must only be called from one thread at a time and
+// TryPop/TryPeek/Clear from one (possibly different) thread at a time.
+// Handing a role to another thread is allowed as long as the hand-off
+// is ordered by some other synchronization (e.g. an element going Idle).
+//
+// The ring itself is bounded: TryPush fails when it is full.  It
+// ignores the overflow, so a queue is filled with TryPush or with
+// Push, not both.  Push never blocks the producer; values that do not
+// fit spill into a locked std::queue with no limit until the consumer
+// catches up, and FIFO order is preserved across the spill.
+//
+// Each group of fields starts its own cache line so the producer and
+// consumer do not false share.  Heap objects are not over-aligned
+// before C++17, but the groups still land on different lines.
+template <typename T>
+class SpscQueue
+{
+	static const size_t CACHE_LINE_SIZE = 64;
+
+
+	// Consumer owned
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> head;
+	size_t cachedTail = 0;
+
+	// Producer owned
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail;
+	size_t cachedHead = 0;
+
+	// Shared, read-only after construction
+	alignas(CACHE_LINE_SIZE) std::vector<T> slots;
+	size_t mask;
+
+	// Overflow (slow path)
+	alignas(CACHE_LINE_SIZE) std::atomic<int> spillCount;
+	Mutex spillMutex;
+	std::queue<T> spill;
+	std::atomic<unsigned long> spillTotal;
+
+
+	static size_t RoundUpPowerOfTwo(size_t value)
+	{
+		size_t result = 1;
+		while (result < value)
+		{
+			result <<= 1;
+		}
+
+		return result;
+	}
+
+	bool TryPopRing(T* outValue)
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+
+		if (h == cachedTail)
+		{
+			cachedTail = tail.load(std::memory_order_acquire);
+			if (h == cachedTail)
+			{
+				return false;
+			}
+		}
+
+		T& slot = slots[h & mask];
+		*outValue = std::move(slot);
+		slot = T();
+
+		head.store(h + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	bool TryPeekRing(T* outValue)
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+
+		if (h == cachedTail)
+		{
+			cachedTail = tail.load(std::memory_order_acquire);
+			if (h == cachedTail)
+			{
+				return false;
+			}
+		}
+
+		*outValue = slots[h & mask];
+
+		return true;
+	}
+
+	bool TryPopSpill(T* outValue)
+	{
+		bool result;
+
+		spillMutex.Lock();
+
+		if (spill.size() < 1)
+		{
+			result = false;
+		}
+		else
+		{
+			*outValue = spill.front();
+			spill.pop();
+
+			spillCount.fetch_sub(1, std::memory_order_release);
+			result = true;
+		}
+
+		spillMutex.Unlock();
+
+		return result;
+	}
+
+
+public:
+
+	static const int DEFAULT_CAPACITY = 256;
+
+
+	// Approximate when called concurrently with Push/TryPop
+	int Count() const
+	{
+		size_t t = tail.load(std::memory_order_acquire);
+		size_t h = head.load(std::memory_order_acquire);
+
+		return (int)(t - h) + spillCount.load(std::memory_order_acquire);
+	}
+
+	int Capacity() const
+	{
+		return (int)slots.size();
+	}
+
+	// Number of values that did not fit in the ring
+	unsigned long SpillTotal() const
+	{
+		return spillTotal.load(std::memory_order_relaxed);
+	}
+
+
+
+	SpscQueue()
+		: SpscQueue(DEFAULT_CAPACITY)
+	{
+	}
+
+	SpscQueue(int capacity)
+		: head(0), tail(0), spillCount(0), spillTotal(0)
+	{
+		if (capacity < 1)
+			throw ArgumentOutOfRangeException();
+
+		slots.resize(RoundUpPowerOfTwo(capacity));
+		mask = slots.size() - 1;
+	}
+
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+
+
+	bool TryPush(T value)
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+
+		if (t - cachedHead >= slots.size())
+		{
+			cachedHead = head.load(std::memory_order_acquire);
+			if (t - cachedHead >= slots.size())
+			{
+				return false;
+			}
+		}
+
+		slots[t & mask] = std::move(value);
+		tail.store(t + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	void Push(T value)
+	{
+		// Once anything has spilled, keep spilling until the
+		// consumer drains it so ordering is preserved.
+		if (spillCount.load(std::memory_order_acquire) < 1)
+		{
+			if (TryPush(value))
+				return;
+		}
+
+		spillMutex.Lock();
+
+		spill.push(value);
+		spillTotal.fetch_add(1, std::memory_order_relaxed);
+		spillCount.fetch_add(1, std::memory_order_release);
+
+		spillMutex.Unlock();
+	}
+
+	bool TryPop(T* outValue)
+	{
+		if (TryPopRing(outValue))
+			return true;
+
+		if (spillCount.load(std::memory_order_acquire) < 1)
+			return false;
+
+		// Ring entries always precede spilled entries.  The acquire
+		// above makes every ring push that happened before the spill
+		// visible, so look at the ring once more first.
+		if (TryPopRing(outValue))
+			return true;
+
+		return TryPopSpill(outValue);
+	}
+
+	bool TryPeek(T* outValue)
+	{
+		if (TryPeekRing(outValue))
+			return true;
+
+		if (spillCount.load(std::memory_order_acquire) < 1)
+			return false;
+
+		if (TryPeekRing(outValue))
+			return true;
+
+
+		bool result;
+
+		spillMutex.Lock();
+
+		if (spill.size() < 1)
+		{
+			result = false;
+		}
+		else
+		{
+			*outValue = spill.front();
+			result = true;
+		}
+
+		spillMutex.Unlock();
+
+		return result;
+	}
+
+	void Clear()
+	{
+		T value;
+		while (TryPop(&value))
+		{
+		}
+	}
+};
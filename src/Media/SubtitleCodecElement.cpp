@@ -698,6 +698,12 @@ void SubtitleRenderElement::timer_Expired(void* sender, const EventArgs& args)
 	if (State() == MediaState::Play)
 	{
 		entriesMutex.Lock();
+
+		double clockTime;
+		if (clock && clock->TryGetTime(&clockTime))
+		{
+			currentTime = clockTime;
+		}
 		
 		//printf("SubtitleRenderElement::timer_Expired currentTime=%f\n", currentTime);
 
@@ -802,7 +808,10 @@ void SubtitleRenderElement::timer_Expired(void* sender, const EventArgs& args)
 				compositor->AddSprites(additions);
 		}
 
-		currentTime += timer.Interval();
+		if (!clock)
+		{
+			currentTime += timer.Interval();
+		}
 
 		entriesMutex.Unlock();
 	}
@@ -886,6 +895,12 @@ SubtitleRenderElement::SubtitleRenderElement(CompositorSPTR compositor)
 }
 SubtitleRenderElement::~SubtitleRenderElement()
 {
+	// Stop callbacks before any member is destroyed
+	timer.Stop();
+
+	TimerStats stats = timer.Stats();
+	printf("SubtitleRenderElement: timer expirations=%lu overruns=%lu drift=%f max=%f jitter=%f\n",
+		stats.Expirations, stats.Overruns, stats.MeanLateness, stats.MaxLateness, stats.Jitter);
 }
 
 
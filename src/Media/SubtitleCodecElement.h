@@ -33,6 +33,7 @@ extern "C"
 #include "Compositor.h"
 #include "Timer.h"
 #include "IClock.h"
+#include "PublishedClock.h"
 
 
 
@@ -121,6 +122,7 @@ class SubtitleRenderElement : public Element, public virtual IClockSink
 	Timer timer;
 	EventListenerSPTR<EventArgs> timerExpiredListener;
 	double currentTime = 0;
+	PublishedClockSPTR clock;
 
 
 	void timer_Expired(void* sender, const EventArgs& args);		
@@ -141,6 +143,17 @@ public:
 	virtual void Flush() override;
 
 
+	// Polled on every frame.  Without one the time advances by
+	// the frame interval from the last SetTimeStamp.
+	PublishedClockSPTR Clock() const
+	{
+		return clock;
+	}
+	void SetClock(PublishedClockSPTR value)
+	{
+		clock = value;
+	}
+
 	// Inherited via IClockSink
 	virtual void SetTimeStamp(double value) override;
 };
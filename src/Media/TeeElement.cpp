@@ -0,0 +1,268 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#include "TeeElement.h"
+
+
+
+TeeOutPin::TeeOutPin(ElementWPTR owner, PinInfoSPTR info, TeeBranchOptions options)
+	: OutPin(owner, info),
+	options(options),
+	lag(0),
+	dropped(0)
+{
+	if (options.Capacity < 1)
+		throw ArgumentOutOfRangeException("options");
+
+	sendWindow = (options.Capacity + 1) / 2;
+}
+
+void TeeOutPin::AcceptProcessedBuffer(BufferSPTR buffer)
+{
+	if (!buffer)
+		throw ArgumentNullException();
+
+	returnedBuffers.Push(buffer);
+
+	ElementSPTR element = Owner().lock();
+	if (element)
+	{
+		element->Wake();
+	}
+
+	BufferReturned.Invoke(this, EventArgs::Empty());
+}
+
+PinMetricsSnapshot TeeOutPin::SnapshotMetrics()
+{
+	PinMetricsSnapshot result = OutPin::SnapshotMetrics();
+	result.Lag = lag.load(std::memory_order_relaxed);
+	result.Dropped = dropped.load(std::memory_order_relaxed);
+
+	return result;
+}
+
+
+
+TeeElement::TeeElement(PinInfoSPTR info, int branchCount)
+	: info(info)
+{
+	if (!info)
+		throw ArgumentNullException("info");
+
+	if (branchCount < 1)
+		throw ArgumentOutOfRangeException("branchCount");
+
+	branchOptions.resize(branchCount);
+}
+
+void TeeElement::SetBranchOptions(int index, TeeBranchOptions options)
+{
+	if (index < 0 || index >= (int)branchOptions.size())
+		throw ArgumentOutOfRangeException("index");
+
+	if (options.Capacity < 1)
+		throw ArgumentOutOfRangeException("options");
+
+	if (ExecutionState() != ExecutionStateEnum::WaitingForExecute)
+		throw InvalidOperationException();
+
+	branchOptions[index] = options;
+}
+
+
+
+void TeeElement::Initialize()
+{
+	ClearOutputPins();
+	ClearInputPins();
+
+	ElementWPTR weakPtr = shared_from_this();
+
+	inPin = std::make_shared<InPin>(weakPtr, info);
+	AddInputPin(inPin);
+
+	branches.clear();
+	for (size_t i = 0; i < branchOptions.size(); ++i)
+	{
+		TeeOutPinSPTR branch = std::make_shared<TeeOutPin>(weakPtr, info, branchOptions[i]);
+		branch->SetName(std::string("Branch") + std::to_string(i));
+
+		AddOutputPin(branch);
+		branches.push_back(branch);
+	}
+}
+
+// A full Block branch stops the tee from taking more input
+bool TeeElement::IsBlocked() const
+{
+	for (auto& branch : branches)
+	{
+		if (branch->options.Policy == TeePolicyEnum::Block &&
+			branch->HeldCount() >= branch->options.Capacity)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Drops one branch's reference; the last one goes upstream
+void TeeElement::Release(BufferSPTR buffer)
+{
+	auto iter = entries.find(buffer.get());
+	if (iter == entries.end())
+	{
+		throw InvalidOperationException("TeeElement: released an unknown buffer.");
+	}
+
+	if (--iter->second.Outstanding == 0)
+	{
+		buffer->SetReadOnly(iter->second.WasReadOnly);
+
+		entries.erase(iter);
+		inPin->PushProcessedBuffer(buffer);
+	}
+}
+
+void TeeElement::Enqueue(TeeOutPinSPTR branch, BufferSPTR buffer, bool isMarker)
+{
+	// Markers (end of stream) are never dropped
+	if (!isMarker &&
+		branch->HeldCount() >= branch->options.Capacity)
+	{
+		TeePolicyEnum policy = branch->options.Policy;
+
+		// Everything is downstream already (Capacity 1)
+		if (policy == TeePolicyEnum::DropOldest &&
+			branch->waitingBuffers.size() < 1)
+		{
+			policy = TeePolicyEnum::DropNew;
+		}
+
+		switch (policy)
+		{
+			case TeePolicyEnum::DropNew:
+				branch->dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+
+			case TeePolicyEnum::DropOldest:
+			{
+				BufferSPTR oldest = branch->waitingBuffers.front();
+				branch->waitingBuffers.pop_front();
+				branch->dropped.fetch_add(1, std::memory_order_relaxed);
+
+				Release(oldest);
+				break;
+			}
+
+			case TeePolicyEnum::Block:
+			default:
+				// IsBlocked is checked before taking input
+				break;
+		}
+	}
+
+	branch->waitingBuffers.push_back(buffer);
+	++entries[buffer.get()].Outstanding;
+}
+
+void TeeElement::CollectReturnedBuffers()
+{
+	for (auto& branch : branches)
+	{
+		BufferSPTR buffer;
+		while (branch->returnedBuffers.TryPop(&buffer))
+		{
+			--branch->inFlightCount;
+			Release(buffer);
+		}
+	}
+}
+
+void TeeElement::DoWork()
+{
+	CollectReturnedBuffers();
+
+
+	BufferSPTR buffer;
+	while (!IsBlocked() && inPin->TryGetFilledBuffer(&buffer))
+	{
+		Entry& entry = entries[buffer.get()];
+		entry.Buffer = buffer;
+		entry.Outstanding = 1;	// held until every branch has it queued
+		entry.WasReadOnly = buffer->IsReadOnly();
+
+		if (branches.size() > 1)
+		{
+			buffer->SetReadOnly(true);
+		}
+
+		bool isMarker = (buffer->Type() == BufferTypeEnum::Marker);
+
+		for (auto& branch : branches)
+		{
+			Enqueue(branch, buffer, isMarker);
+		}
+
+		Release(buffer);
+	}
+
+
+	for (auto& branch : branches)
+	{
+		while (branch->inFlightCount < branch->sendWindow &&
+			branch->waitingBuffers.size() > 0)
+		{
+			BufferSPTR next = branch->waitingBuffers.front();
+			branch->waitingBuffers.pop_front();
+
+			// May come straight back through AcceptProcessedBuffer
+			++branch->inFlightCount;
+			branch->SendBuffer(next);
+		}
+
+		branch->lag.store(branch->inFlightCount + (int)branch->waitingBuffers.size(),
+			std::memory_order_relaxed);
+	}
+
+
+	inPin->ReturnProcessedBuffers();
+}
+
+void TeeElement::Flush()
+{
+	Element::Flush();
+
+	// Idle and paused, so DoWork is not running
+	CollectReturnedBuffers();
+
+	for (auto& branch : branches)
+	{
+		while (branch->waitingBuffers.size() > 0)
+		{
+			BufferSPTR buffer = branch->waitingBuffers.front();
+			branch->waitingBuffers.pop_front();
+
+			Release(buffer);
+		}
+
+		branch->lag.store(branch->inFlightCount, std::memory_order_relaxed);
+	}
+
+	inPin->ReturnProcessedBuffers();
+}
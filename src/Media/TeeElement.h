@@ -0,0 +1,147 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#pragma once
+
+#include "Element.h"
+#include "InPin.h"
+#include "LockedQueue.h"
+#include "OutPin.h"
+
+#include <atomic>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+
+// What a branch does with a new buffer when it already holds
+// Capacity buffers.
+enum class TeePolicyEnum
+{
+	Block = 0,		// stall the tee (and every branch) until it catches up
+	DropOldest,		// discard the oldest buffer not yet sent to the branch
+	DropNew			// do not give the new buffer to this branch
+};
+
+
+struct TeeBranchOptions
+{
+	TeePolicyEnum Policy = TeePolicyEnum::Block;
+	// Most buffers the branch may hold, waiting plus in flight.
+	// At most half are sent downstream at once so DropOldest has
+	// something to drop.  Keep it below the upstream pool size.
+	int Capacity = 16;
+};
+
+
+// One output of a TeeElement.  Buffers sent from here belong to
+// the upstream element, so returns are handed to the tee instead
+// of the available queue.
+class TeeOutPin : public OutPin
+{
+	friend class TeeElement;
+
+	TeeBranchOptions options;
+
+	// Pushed by the branch sink (AcceptProcessedBuffer) and by the
+	// tee itself when SendBuffer cannot deliver; taken by the tee.
+	ThreadSafeQueue<BufferSPTR> returnedBuffers;
+	std::deque<BufferSPTR> waitingBuffers;	// tee thread only
+	int inFlightCount = 0;					// tee thread only
+	int sendWindow;
+
+
+	int HeldCount() const
+	{
+		return inFlightCount + (int)waitingBuffers.size();
+	}
+
+	// Mirrors for metrics
+	std::atomic<int> lag;
+	std::atomic<uint64_t> dropped;
+
+
+public:
+
+	TeeOutPin(ElementWPTR owner, PinInfoSPTR info, TeeBranchOptions options);
+
+
+	TeeBranchOptions Options() const
+	{
+		return options;
+	}
+
+
+	virtual void AcceptProcessedBuffer(BufferSPTR buffer) override;
+	virtual PinMetricsSnapshot SnapshotMetrics() override;
+};
+
+typedef std::shared_ptr<TeeOutPin> TeeOutPinSPTR;
+
+
+
+// Fans one input out to several outputs without copying.  Every
+// branch receives the same buffer object; it is returned upstream
+// once all branches that took it have returned it.  With more than
+// one branch the buffer is marked read-only while it is shared, so
+// branches that rewrite payloads copy them first.
+class TeeElement : public Element
+{
+	struct Entry
+	{
+		BufferSPTR Buffer;
+		int Outstanding;
+		bool WasReadOnly;	// restored before it goes upstream
+	};
+
+
+	PinInfoSPTR info;
+	std::vector<TeeBranchOptions> branchOptions;
+	InPinSPTR inPin;
+	std::vector<TeeOutPinSPTR> branches;
+	std::unordered_map<Buffer*, Entry> entries;
+
+
+	bool IsBlocked() const;
+	void Release(BufferSPTR buffer);
+	void Enqueue(TeeOutPinSPTR branch, BufferSPTR buffer, bool isMarker);
+	void CollectReturnedBuffers();
+
+
+protected:
+
+	virtual void Initialize() override;
+	virtual void DoWork() override;
+
+
+public:
+
+	TeeElement(PinInfoSPTR info, int branchCount);
+
+
+	int BranchCount() const
+	{
+		return (int)branchOptions.size();
+	}
+
+	// Must be called before Execute
+	void SetBranchOptions(int index, TeeBranchOptions options);
+
+
+	virtual void Flush() override;
+};
+
+typedef std::shared_ptr<TeeElement> TeeElementSPTR;
@@ -65,6 +65,9 @@ void Thread::Cancel()
 void Thread::Join()
 {
 	pthread_join(thread, NULL);
+
+	// A joined thread must not be detached by the destructor
+	isCreated = false;
 }
 
 
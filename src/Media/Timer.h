@@ -1,27 +1,21 @@
-#pragma once
-
-#include <signal.h>
-#include <time.h>
-#include <math.h>
+#pragma once
 
+#include "Event.h"
+#include "EventArgs.h"
+#include "Exception.h"
+#include "MediaClock.h"
 
 
+
+// Expired is invoked on the shared TimerService thread, or with a
+// virtual clock on the thread that advances it.
 class Timer
 {
-	timer_t timer_id;
-
-
+	IMediaClockSPTR clock;
+	TimerEntry entry;
 	double interval = 0;
-	bool isRunning = false;
-
+	bool isPeriodic = true;
 
-	static void timer_thread(sigval arg)
-	{
-		Timer* timerPtr = (Timer*)arg.sival_ptr;
-		timerPtr->Expired.Invoke(timerPtr, EventArgs::Empty());
-
-		//printf("Timer: expired arg=%p.\n", arg.sival_ptr);
-	}
 
 public:
 	Event<EventArgs> Expired;
@@ -36,70 +30,73 @@ public:
 		interval = value;
 	}
 
+	bool IsPeriodic() const
+	{
+		return isPeriodic;
+	}
+	void SetIsPeriodic(bool value)
+	{
+		isPeriodic = value;
+	}
 
+	// A one-shot timer stops running once it expires
+	bool IsRunning()
+	{
+		return clock->IsTimerActive(&entry);
+	}
 
-	Timer()
+	TimerStats Stats()
 	{
-		sigevent se = { 0 };
+		return clock->TimerStatistics(&entry);
+	}
+
 
-		se.sigev_notify = SIGEV_THREAD;
-		se.sigev_value.sival_ptr = &timer_id;
-		se.sigev_notify_function = &Timer::timer_thread;
-		se.sigev_notify_attributes = NULL;
-		se.sigev_value.sival_ptr = this;
 
-		int ret = timer_create(CLOCK_REALTIME, &se, &timer_id);
-		if (ret != 0)
+	// Uses the MediaClock default at the time of construction
+	Timer()
+		: clock(MediaClock::Default())
+	{
+		entry.Callback = [this]()
 		{
-			throw Exception("Timer creation failed.");
-		}
+			Expired.Invoke(this, EventArgs::Empty());
+		};
 	}
 
 	~Timer()
 	{
-		timer_delete(timer_id);
+		clock->CancelTimer(&entry);
 	}
 
+	Timer(const Timer&) = delete;
+	Timer& operator=(const Timer&) = delete;
+
 
 	void Start()
 	{
-		if (isRunning)
+		if (IsRunning())
 			throw InvalidOperationException();
 
+		if (interval <= 0)
+			throw InvalidOperationException("Timer interval must be positive.");
 
-		itimerspec ts = { 0 };
-
-		// arm value
-		ts.it_value.tv_sec = floor(interval);
-		ts.it_value.tv_nsec = floor((interval - floor(interval)) * 1e9);
-
-		// re-arm value
-		ts.it_interval.tv_sec = ts.it_value.tv_sec;
-		ts.it_interval.tv_nsec = ts.it_value.tv_nsec;
 
-		int ret = timer_settime(timer_id, 0, &ts, 0);
-		if (ret != 0)
-		{
-			throw Exception("timer_settime failed.");
-		}
-
-		isRunning = true;
+		clock->StartTimer(&entry, interval, isPeriodic ? interval : 0);
 	}
 
+	// Waits for a running Expired handler unless called from one
 	void Stop()
 	{
-		if (!isRunning)
+		if (!IsRunning())
 			throw InvalidOperationException();
 
 
-		itimerspec ts = { 0 };
-
-		int ret = timer_settime(timer_id, 0, &ts, 0);
-		if (ret != 0)
-		{
-			throw Exception("timer_settime failed.");
-		}
+		clock->CancelTimer(&entry);
+	}
 
-		isRunning = false;
+	// Stop that also accepts a timer that is not running, e.g. a
+	// one-shot that may expire concurrently.
+	void Cancel()
+	{
+		clock->CancelTimer(&entry);
 	}
 };
@@ -0,0 +1,420 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#include "TimerService.h"
+
+#include "Exception.h"
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cmath>
+#include <cstdio>
+
+
+static thread_local bool isServiceThread = false;
+
+
+double TimerService::Now()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+uint64_t TimerService::TickFromTime(double time) const
+{
+	double ticks = ceil((time - origin) / tickSeconds);
+	return (ticks > 0) ? (uint64_t)ticks : 0;
+}
+
+double TimerService::TimeFromTick(uint64_t tick) const
+{
+	return origin + tick * tickSeconds;
+}
+
+
+
+// Places the entry on the lowest level whose span covers it.
+// The slot for currentTick has already run, except while
+// cascading, which happens just before it runs.
+void TimerService::Link(TimerEntry* entry, bool isCascade)
+{
+	uint64_t earliest = isCascade ? currentTick : currentTick + 1;
+	if (entry->expiryTick < earliest)
+	{
+		entry->expiryTick = earliest;
+	}
+
+	uint64_t delta = entry->expiryTick - currentTick;
+
+	int level = 0;
+	while (level < LEVELS - 1 &&
+		delta >= (1ULL << (SLOT_BITS * (level + 1))))
+	{
+		++level;
+	}
+
+	uint64_t maxDelta = (1ULL << (SLOT_BITS * LEVELS)) - 1;
+	if (delta > maxDelta)
+	{
+		// Beyond the wheel; cascades back down until due
+		entry->expiryTick = currentTick + maxDelta;
+	}
+
+	int slot = (int)((entry->expiryTick >> (SLOT_BITS * level)) & SLOT_MASK);
+
+	entry->level = level;
+	entry->previous = nullptr;
+	entry->next = slots[level][slot];
+
+	if (entry->next)
+	{
+		entry->next->previous = entry;
+	}
+
+	slots[level][slot] = entry;
+	++entryCount;
+}
+
+void TimerService::Unlink(TimerEntry* entry)
+{
+	if (entry->level < 0)
+		return;
+
+	int slot = (int)((entry->expiryTick >> (SLOT_BITS * entry->level)) & SLOT_MASK);
+
+	if (entry->previous)
+	{
+		entry->previous->next = entry->next;
+	}
+	else
+	{
+		slots[entry->level][slot] = entry->next;
+	}
+
+	if (entry->next)
+	{
+		entry->next->previous = entry->previous;
+	}
+
+	entry->previous = nullptr;
+	entry->next = nullptr;
+	entry->level = -1;
+	--entryCount;
+}
+
+// Redistributes the slot of 'level' that currentTick just reached
+void TimerService::Cascade(int level)
+{
+	int slot = (int)((currentTick >> (SLOT_BITS * level)) & SLOT_MASK);
+
+	TimerEntry* entry = slots[level][slot];
+	slots[level][slot] = nullptr;
+
+	while (entry)
+	{
+		TimerEntry* next = entry->next;
+
+		// Clamped entries are not due yet; Link handles both cases
+		if (entry->deadline > TimeFromTick(entry->expiryTick))
+		{
+			entry->expiryTick = TickFromTime(entry->deadline);
+		}
+
+		--entryCount;
+		Link(entry, true);
+		entry = next;
+	}
+}
+
+// Called locked; unlocks around the callback
+void TimerService::Fire(TimerEntry* entry)
+{
+	Unlink(entry);
+
+	double now = Now();
+	double lateness = now - entry->deadline;
+	if (lateness < 0)
+	{
+		lateness = 0;
+	}
+
+	++entry->expirations;
+	++totalExpirations;
+	entry->latenessSum += lateness;
+	entry->latenessSquaredSum += lateness * lateness;
+	if (lateness > entry->latenessMax)
+	{
+		entry->latenessMax = lateness;
+	}
+
+	if (entry->period <= 0)
+	{
+		entry->isActive = false;
+	}
+
+	runningEntry = entry;
+	std::function<void()> callback = entry->Callback;
+
+	pthread_mutex_unlock(&mutex);
+
+	if (callback)
+	{
+		callback();
+	}
+
+	pthread_mutex_lock(&mutex);
+
+	runningEntry = nullptr;
+	pthread_cond_broadcast(&callbackDone);
+
+
+	// Cancelled, restarted or one-shot entries are left alone
+	if (entry->isActive && entry->level < 0 && entry->period > 0)
+	{
+		// Next deadline follows the schedule, not the callback,
+		// so periodic timers do not drift.
+		entry->deadline += entry->period;
+
+		double now = Now();
+		if (entry->deadline <= now)
+		{
+			unsigned long missed = (unsigned long)floor((now - entry->deadline) / entry->period) + 1;
+
+			entry->overruns += missed;
+			entry->deadline += missed * entry->period;
+		}
+
+		entry->expiryTick = TickFromTime(entry->deadline);
+		Link(entry, false);
+	}
+}
+
+// Sets the timerfd for the next due slot or cascade point
+void TimerService::Arm()
+{
+	uint64_t nextTick = 0;
+
+	for (int level = 0; level < LEVELS; ++level)
+	{
+		uint64_t base = currentTick >> (SLOT_BITS * level);
+
+		for (int i = 1; i <= SLOTS; ++i)
+		{
+			if (slots[level][(base + i) & SLOT_MASK])
+			{
+				uint64_t tick = (base + i) << (SLOT_BITS * level);
+				if (nextTick == 0 || tick < nextTick)
+				{
+					nextTick = tick;
+				}
+				break;
+			}
+		}
+	}
+
+
+	itimerspec spec = { };
+
+	if (nextTick != 0)
+	{
+		double time = TimeFromTick(nextTick);
+
+		spec.it_value.tv_sec = (time_t)time;
+		spec.it_value.tv_nsec = (long)((time - floor(time)) * 1000000000.0);
+
+		if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0)
+		{
+			spec.it_value.tv_nsec = 1;
+		}
+	}
+
+	if (timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, nullptr) != 0)
+	{
+		throw Exception("TimerService: timerfd_settime failed.");
+	}
+}
+
+void TimerService::WorkThread()
+{
+	isServiceThread = true;
+
+	while (true)
+	{
+		uint64_t count;
+		read(timerFd, &count, sizeof(count));
+
+
+		pthread_mutex_lock(&mutex);
+
+		uint64_t nowTick = TickFromTime(Now());
+
+		if (entryCount == 0)
+		{
+			currentTick = nowTick;
+		}
+
+		while (currentTick < nowTick)
+		{
+			++currentTick;
+
+			for (int level = 1; level < LEVELS; ++level)
+			{
+				uint64_t mask = (1ULL << (SLOT_BITS * level)) - 1;
+				if ((currentTick & mask) != 0)
+					break;
+
+				Cascade(level);
+			}
+
+			TimerEntry** slot = &slots[0][currentTick & SLOT_MASK];
+			while (*slot)
+			{
+				Fire(*slot);
+			}
+		}
+
+		Arm();
+
+		pthread_mutex_unlock(&mutex);
+	}
+}
+
+
+
+TimerService::TimerService()
+	: thread(std::function<void()>(std::bind(&TimerService::WorkThread, this))),
+	origin(Now())
+{
+	timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	if (timerFd < 0)
+	{
+		throw Exception("TimerService: timerfd_create failed.");
+	}
+
+	thread.Start();
+}
+
+TimerService* TimerService::Default()
+{
+	// Never destroyed, like Executor::Default()
+	static TimerService* service = new TimerService();
+
+	return service;
+}
+
+
+
+void TimerService::Start(TimerEntry* entry, double delay, double period)
+{
+	if (!entry)
+		throw ArgumentNullException();
+
+	if (delay < 0 || period < 0)
+		throw ArgumentOutOfRangeException();
+
+
+	pthread_mutex_lock(&mutex);
+
+	Unlink(entry);
+
+	double now = Now();
+
+	// An empty wheel is not ticked, so catch up first
+	if (entryCount == 0)
+	{
+		uint64_t nowTick = TickFromTime(now);
+		if (nowTick > currentTick)
+		{
+			currentTick = nowTick;
+		}
+	}
+
+	entry->deadline = now + delay;
+	entry->period = period;
+	entry->expiryTick = TickFromTime(entry->deadline);
+	entry->isActive = true;
+
+	Link(entry, false);
+	Arm();
+
+	pthread_mutex_unlock(&mutex);
+}
+
+void TimerService::Cancel(TimerEntry* entry)
+{
+	if (!entry)
+		throw ArgumentNullException();
+
+
+	pthread_mutex_lock(&mutex);
+
+	Unlink(entry);
+	entry->isActive = false;
+
+	if (!isServiceThread)
+	{
+		while (runningEntry == entry)
+		{
+			pthread_cond_wait(&callbackDone, &mutex);
+		}
+	}
+
+	pthread_mutex_unlock(&mutex);
+}
+
+bool TimerService::IsActive(TimerEntry* entry)
+{
+	pthread_mutex_lock(&mutex);
+	bool result = entry->isActive;
+	pthread_mutex_unlock(&mutex);
+
+	return result;
+}
+
+TimerStats TimerService::Stats(TimerEntry* entry)
+{
+	TimerStats result;
+
+	pthread_mutex_lock(&mutex);
+
+	result.Expirations = entry->expirations;
+	result.Overruns = entry->overruns;
+	result.MaxLateness = entry->latenessMax;
+
+	if (entry->expirations > 0)
+	{
+		result.MeanLateness = entry->latenessSum / entry->expirations;
+
+		double variance = entry->latenessSquaredSum / entry->expirations -
+			result.MeanLateness * result.MeanLateness;
+		result.Jitter = (variance > 0) ? sqrt(variance) : 0;
+	}
+
+	pthread_mutex_unlock(&mutex);
+
+	return result;
+}
+
+unsigned long TimerService::TotalExpirations()
+{
+	pthread_mutex_lock(&mutex);
+	unsigned long result = totalExpirations;
+	pthread_mutex_unlock(&mutex);
+
+	return result;
+}
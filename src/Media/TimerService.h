@@ -0,0 +1,121 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#pragma once
+
+#include "Thread.h"
+
+#include <pthread.h>
+#include <functional>
+#include <stdint.h>
+
+
+struct TimerStats
+{
+	unsigned long Expirations = 0;
+	unsigned long Overruns = 0;		// periods skipped because a callback ran late
+	double MeanLateness = 0;		// drift: seconds after the scheduled time
+	double MaxLateness = 0;
+	double Jitter = 0;				// standard deviation of lateness
+};
+
+
+// One scheduled callback.  Owned by the caller (see Timer); the
+// service only links it into its wheel.
+class TimerEntry
+{
+	friend class TimerService;
+	friend class VirtualClock;
+
+	TimerEntry* previous = nullptr;
+	TimerEntry* next = nullptr;
+	int level = -1;					// -1 when not in the wheel
+	uint64_t expiryTick = 0;
+	double deadline = 0;			// CLOCK_MONOTONIC seconds
+	double period = 0;				// 0 for one-shot
+	bool isActive = false;
+
+	unsigned long expirations = 0;
+	unsigned long overruns = 0;
+	double latenessSum = 0;
+	double latenessSquaredSum = 0;
+	double latenessMax = 0;
+
+
+public:
+	std::function<void()> Callback;
+};
+
+
+// A single thread driving every timer from one timerfd.
+//
+// Timers are kept in a hierarchical timing wheel (4 levels of 64
+// slots, 1ms ticks) so Start/Cancel are O(1) and the thread only
+// wakes for the next due slot or cascade.  Callbacks run on the
+// service thread one at a time and should be short.
+class TimerService
+{
+	static const int LEVELS = 4;
+	static const int SLOT_BITS = 6;
+	static const int SLOTS = 1 << SLOT_BITS;
+	static const int SLOT_MASK = SLOTS - 1;
+
+
+	pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+	pthread_cond_t callbackDone = PTHREAD_COND_INITIALIZER;
+	int timerFd = -1;
+	Thread thread;
+	double origin;
+	double tickSeconds = 0.001;
+	uint64_t currentTick = 0;
+	TimerEntry* slots[LEVELS][SLOTS] = {};
+	TimerEntry* runningEntry = nullptr;
+	int entryCount = 0;
+	unsigned long totalExpirations = 0;
+
+
+	static double Now();
+
+	uint64_t TickFromTime(double time) const;
+	double TimeFromTick(uint64_t tick) const;
+	void Link(TimerEntry* entry, bool isCascade);
+	void Unlink(TimerEntry* entry);
+	void Cascade(int level);
+	void Fire(TimerEntry* entry);
+	void Arm();
+	void WorkThread();
+
+
+	TimerService();
+
+
+public:
+
+	static TimerService* Default();
+
+
+	// First expiry after 'delay' seconds, then every 'period'
+	// seconds unless period is 0.
+	void Start(TimerEntry* entry, double delay, double period);
+
+	// Safe from any thread, including the entry's own callback.
+	// From other threads, waits for a running callback to finish.
+	void Cancel(TimerEntry* entry);
+
+	bool IsActive(TimerEntry* entry);
+	TimerStats Stats(TimerEntry* entry);
+	unsigned long TotalExpirations();
+};
@@ -0,0 +1,214 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#include "Trace.h"
+
+#include "Mutex.h"
+
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <cstdio>
+#include <set>
+#include <vector>
+
+
+std::atomic<bool> Trace::isEnabled(false);
+thread_local TraceRing* Trace::ring = nullptr;
+
+
+// Rings are never freed so events from exited threads can be dumped
+static Mutex registryMutex;
+static std::vector<TraceRing*> rings;
+static std::set<std::string> names;
+
+
+
+static void WriteJsonString(FILE* file, const char* value)
+{
+	fputc('"', file);
+
+	for (const char* ptr = value; *ptr; ++ptr)
+	{
+		switch (*ptr)
+		{
+			case '"':
+			case '\\':
+				fputc('\\', file);
+				fputc(*ptr, file);
+				break;
+
+			default:
+				if ((unsigned char)*ptr >= 0x20)
+				{
+					fputc(*ptr, file);
+				}
+				break;
+		}
+	}
+
+	fputc('"', file);
+}
+
+
+
+TraceRing* Trace::CreateRing()
+{
+	TraceRing* result = new TraceRing();
+	result->Count.store(0, std::memory_order_relaxed);
+	result->ThreadId = (int)syscall(SYS_gettid);
+
+	registryMutex.Lock();
+	rings.push_back(result);
+	registryMutex.Unlock();
+
+	ring = result;
+
+	return result;
+}
+
+void Trace::SetEnabled(bool value)
+{
+	isEnabled.store(value, std::memory_order_relaxed);
+}
+
+const char* Trace::Intern(const std::string& name)
+{
+	registryMutex.Lock();
+
+	// std::set nodes do not move, so c_str() stays valid
+	const char* result = names.insert(name).first->c_str();
+
+	registryMutex.Unlock();
+
+	return result;
+}
+
+bool Trace::WriteChromeJson(const char* path)
+{
+	struct RingCopy
+	{
+		int ThreadId;
+		std::vector<TraceEvent> Events;
+	};
+
+
+	bool wasEnabled = isEnabled.exchange(false);
+
+	std::vector<RingCopy> copies;
+	uint64_t start = UINT64_MAX;
+
+	registryMutex.Lock();
+
+	for (TraceRing* item : rings)
+	{
+		uint64_t count = item->Count.load(std::memory_order_acquire);
+		uint64_t first = (count > (uint64_t)TraceRing::CAPACITY) ? count - TraceRing::CAPACITY : 0;
+
+		RingCopy copy;
+		copy.ThreadId = item->ThreadId;
+
+		for (uint64_t i = first; i < count; ++i)
+		{
+			copy.Events.push_back(item->Events[i & (TraceRing::CAPACITY - 1)]);
+		}
+
+		if (copy.Events.size() > 0 && copy.Events[0].TimeStamp < start)
+		{
+			start = copy.Events[0].TimeStamp;
+		}
+
+		copies.push_back(copy);
+	}
+
+	registryMutex.Unlock();
+
+	isEnabled.store(wasEnabled);
+
+
+	FILE* file = fopen(path, "w");
+	if (!file)
+	{
+		printf("Trace: could not open '%s'.\n", path);
+		return false;
+	}
+
+	int pid = (int)getpid();
+	bool isFirst = true;
+
+	fprintf(file, "{\"traceEvents\":[\n");
+
+	for (RingCopy& copy : copies)
+	{
+		for (TraceEvent& event : copy.Events)
+		{
+			const char* phase;
+			const char* argumentName;
+
+			switch (event.Type)
+			{
+				case TraceEventTypeEnum::Begin:
+					phase = "B";
+					argumentName = nullptr;
+					break;
+
+				case TraceEventTypeEnum::End:
+					phase = "E";
+					argumentName = nullptr;
+					break;
+
+				case TraceEventTypeEnum::Instant:
+					phase = "i";
+					argumentName = "id";
+					break;
+
+				case TraceEventTypeEnum::Counter:
+				default:
+					phase = "C";
+					argumentName = "value";
+					break;
+			}
+
+			fprintf(file, "%s{\"name\":", isFirst ? "" : ",\n");
+			WriteJsonString(file, event.Name ? event.Name : "?");
+			fprintf(file, ",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d",
+				phase,
+				(event.TimeStamp - start) / 1000.0,
+				pid,
+				copy.ThreadId);
+
+			if (event.Type == TraceEventTypeEnum::Instant)
+			{
+				fprintf(file, ",\"s\":\"t\"");
+			}
+
+			if (argumentName)
+			{
+				fprintf(file, ",\"args\":{\"%s\":%llu}", argumentName, (unsigned long long)event.Argument);
+			}
+
+			fprintf(file, "}");
+
+			isFirst = false;
+		}
+	}
+
+	fprintf(file, "\n]}\n");
+	fclose(file);
+
+	printf("Trace: wrote '%s'.\n", path);
+
+	return true;
+}
@@ -0,0 +1,154 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <stdint.h>
+#include <time.h>
+
+
+// Tracing is compiled in only when C2PLAY_TRACE is defined
+// (premake4 --trace).  Otherwise the TRACE_* macros expand to
+// nothing and their arguments are not evaluated.
+//
+// Each thread writes fixed size binary events into its own ring,
+// overwriting the oldest.  Names must be string literals or come
+// from Trace::Intern so they outlive the ring.
+
+
+enum class TraceEventTypeEnum : uint8_t
+{
+	Begin = 0,
+	End,
+	Instant,
+	Counter
+};
+
+
+struct TraceEvent
+{
+	uint64_t TimeStamp;		// CLOCK_MONOTONIC nanoseconds
+	const char* Name;
+	uint64_t Argument;
+	TraceEventTypeEnum Type;
+};
+
+
+struct TraceRing
+{
+	static const int CAPACITY = 1 << 15;	// events, power of two
+
+	TraceEvent Events[CAPACITY];
+	std::atomic<uint64_t> Count;	// total events written
+	int ThreadId;
+};
+
+
+class Trace
+{
+	static std::atomic<bool> isEnabled;
+	static thread_local TraceRing* ring;
+
+
+	static TraceRing* CreateRing();
+
+
+public:
+
+	static bool IsEnabled()
+	{
+		return isEnabled.load(std::memory_order_relaxed);
+	}
+	static void SetEnabled(bool value);
+
+
+	// Returns a copy of name that lives for the rest of the process
+	static const char* Intern(const std::string& name);
+
+	static void Write(TraceEventTypeEnum type, const char* name, uint64_t argument)
+	{
+		if (!isEnabled.load(std::memory_order_relaxed))
+			return;
+
+		TraceRing* target = ring;
+		if (!target)
+		{
+			target = CreateRing();
+		}
+
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+
+		uint64_t index = target->Count.load(std::memory_order_relaxed);
+
+		TraceEvent& event = target->Events[index & (TraceRing::CAPACITY - 1)];
+		event.TimeStamp = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+		event.Name = name;
+		event.Argument = argument;
+		event.Type = type;
+
+		target->Count.store(index + 1, std::memory_order_release);
+	}
+
+	// Writes every ring as Chrome trace_event JSON (chrome://tracing).
+	// Tracing is paused while the rings are copied.
+	static bool WriteChromeJson(const char* path);
+};
+
+
+class TraceScope
+{
+	const char* name;
+
+public:
+
+	TraceScope(const char* name)
+		: name(name)
+	{
+		Trace::Write(TraceEventTypeEnum::Begin, name, 0);
+	}
+
+	~TraceScope()
+	{
+		Trace::Write(TraceEventTypeEnum::End, name, 0);
+	}
+};
+
+
+#ifdef C2PLAY_TRACE
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+
+#define TRACE_BEGIN(name) Trace::Write(TraceEventTypeEnum::Begin, (name), 0)
+#define TRACE_END(name) Trace::Write(TraceEventTypeEnum::End, (name), 0)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_INSTANT(name, argument) Trace::Write(TraceEventTypeEnum::Instant, (name), (uint64_t)(argument))
+#define TRACE_COUNTER(name, value) Trace::Write(TraceEventTypeEnum::Counter, (name), (uint64_t)(value))
+#define TRACE_INTERN(text) Trace::Intern(text)
+
+#else
+
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_INSTANT(name, argument) ((void)0)
+#define TRACE_COUNTER(name, value) ((void)0)
+#define TRACE_INTERN(text) nullptr
+
+#endif
@@ -0,0 +1,149 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#include "VptsSampler.h"
+
+#include "Exception.h"
+
+
+
+VptsSampler::VptsSampler(AmlCodec* codecPTR, IMediaClockSPTR mediaClock)
+	: codecPTR(codecPTR),
+	mediaClock(mediaClock),
+	cache(mediaClock),
+	isSampling(false), rate(1.0),
+	queries(0), samples(0)
+{
+	if (codecPTR == nullptr)
+		throw ArgumentNullException();
+}
+
+
+void VptsSampler::SetRate(double value)
+{
+	if (value < 0)
+		throw ArgumentOutOfRangeException();
+
+	rate.store(value, std::memory_order_relaxed);
+
+	// The cached sample keeps its time but extrapolates at the new
+	// rate.  A sample being taken is published at the new rate.
+	sampleMutex.Lock();
+
+	double time;
+	if (cache.TryGetTime(&time))
+	{
+		cache.Publish(time, value);
+	}
+
+	sampleMutex.Unlock();
+}
+
+// Returns the VPTS sampled, which is also the time now
+double VptsSampler::Sample()
+{
+	double vpts = codecPTR->GetCurrentPts();
+	cache.Publish(vpts, rate.load(std::memory_order_relaxed));
+
+	samples.fetch_add(1, std::memory_order_relaxed);
+
+	return vpts;
+}
+
+void VptsSampler::Invalidate()
+{
+	cache.Invalidate();
+}
+
+double VptsSampler::Time()
+{
+	queries.fetch_add(1, std::memory_order_relaxed);
+
+
+	double now = mediaClock->Now();
+	ClockSample sample = cache.Read();
+
+	bool isStale = !sample.IsValid ||
+		now - sample.CaptureTime >= SAMPLE_INTERVAL;
+
+	if (isStale && !isSampling.exchange(true, std::memory_order_acquire))
+	{
+		double result;
+
+		sampleMutex.Lock();
+
+		try
+		{
+			result = Sample();
+		}
+		catch (...)
+		{
+			sampleMutex.Unlock();
+			isSampling.store(false, std::memory_order_release);
+			throw;
+		}
+
+		sampleMutex.Unlock();
+		isSampling.store(false, std::memory_order_release);
+
+		return result;
+	}
+
+	if (!sample.IsValid)
+	{
+		// Another caller is sampling and there is nothing to
+		// extrapolate meanwhile: wait for its sample, or take one
+		// if it failed or was invalidated again.
+		sampleMutex.Lock();
+
+		sample = cache.Read();
+		if (!sample.IsValid)
+		{
+			double result;
+
+			try
+			{
+				result = Sample();
+			}
+			catch (...)
+			{
+				sampleMutex.Unlock();
+				throw;
+			}
+
+			sampleMutex.Unlock();
+
+			return result;
+		}
+
+		sampleMutex.Unlock();
+
+		now = mediaClock->Now();
+	}
+
+
+	return sample.Extrapolate(now);
+}
+
+VptsSamplerStats VptsSampler::Stats() const
+{
+	VptsSamplerStats result;
+
+	result.Queries = queries.load(std::memory_order_relaxed);
+	result.Samples = samples.load(std::memory_order_relaxed);
+
+	return result;
+}
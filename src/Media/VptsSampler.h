@@ -0,0 +1,86 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+#pragma once
+
+#include "AmlCodec.h"
+#include "MediaClock.h"
+#include "Mutex.h"
+#include "PublishedClock.h"
+
+#include <atomic>
+#include <memory>
+
+
+
+struct VptsSamplerStats
+{
+	unsigned long Queries = 0;
+	unsigned long Samples = 0;	// GetCurrentPts ioctls
+};
+
+
+// Serves the codec's VPTS from a cached sample.
+//
+// A query older than SAMPLE_INTERVAL refreshes the sample from the
+// device; one caller does so while the rest extrapolate from the
+// previous sample, so queries never queue on the codec mutex.  Only
+// when there is no sample to extrapolate from, e.g. after Invalidate,
+// do the others wait for it.
+// Samples are taken on the media clock and extrapolated at the
+// playback rate, which is 0 while paused.
+class VptsSampler
+{
+	const double SAMPLE_INTERVAL = 0.05;
+
+	AmlCodec* codecPTR;
+	IMediaClockSPTR mediaClock;
+	PublishedClock cache;
+	std::atomic<bool> isSampling;
+	Mutex sampleMutex;	// serializes device samples
+	std::atomic<double> rate;
+
+	std::atomic<unsigned long> queries;
+	std::atomic<unsigned long> samples;
+
+
+	// Must be called with sampleMutex held
+	double Sample();
+
+
+public:
+
+	VptsSampler(AmlCodec* codecPTR, IMediaClockSPTR mediaClock);
+
+	VptsSampler(const VptsSampler&) = delete;
+	VptsSampler& operator=(const VptsSampler&) = delete;
+
+
+	// 1 while playing, 0 while paused
+	double Rate() const
+	{
+		return rate.load(std::memory_order_relaxed);
+	}
+	void SetRate(double value);
+
+	// Forces the next query to sample, e.g. after a flush
+	void Invalidate();
+
+	// The codec must be open
+	double Time();
+
+	VptsSamplerStats Stats() const;
+};
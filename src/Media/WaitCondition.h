@@ -16,62 +16,125 @@
 
 #pragma once
 
-#include <pthread.h>
-
-
+#include <atomic>
+#include <climits>
+#include <ctime>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+
+// Auto-reset event on a single atomic word.
+//
+// Signals coalesce: any number of Signal calls before a waiter
+// runs satisfy one wait.  Signal only makes a syscall when a
+// waiter is actually blocked in the kernel; waiting only makes
+// one when no signal is pending.
 class WaitCondition
 {
-	pthread_cond_t waitCondition = PTHREAD_COND_INITIALIZER;
-	pthread_mutex_t waitMutex = PTHREAD_MUTEX_INITIALIZER;
-	bool flag = false;
+	static const int STATE_CLEAR = 0;
+	static const int STATE_SIGNALED = 1;
+	static const int STATE_SLEEPING = -1;	// at least one waiter in futex_wait
 
 
-public:
+	std::atomic<int> state;
 
-	void Lock()
+
+	static void FutexWait(std::atomic<int>* address, int value, const timespec* timeout)
 	{
-		pthread_mutex_lock(&waitMutex);
+		syscall(SYS_futex, (int*)address, FUTEX_WAIT_PRIVATE, value, timeout, nullptr, 0);
 	}
 
-	void Unlock()
+	static void FutexWake(std::atomic<int>* address)
 	{
-		pthread_mutex_unlock(&waitMutex);
+		syscall(SYS_futex, (int*)address, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
 	}
 
-	void Signal()
+	static double Now()
 	{
-		pthread_mutex_lock(&waitMutex);
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
 
-		flag = true;
-		pthread_cond_broadcast(&waitCondition);
+		return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+	}
+
+	// Returns false if the wait should block
+	bool PrepareWait()
+	{
+		int expected = STATE_SIGNALED;
+		if (state.compare_exchange_strong(expected, STATE_CLEAR, std::memory_order_acquire))
+			return true;
 
-		pthread_mutex_unlock(&waitMutex);
+		// expected is now CLEAR or SLEEPING
+		if (expected == STATE_CLEAR)
+		{
+			state.compare_exchange_strong(expected, STATE_SLEEPING, std::memory_order_relaxed);
+		}
+
+		return false;
 	}
 
-	void WaitForSignal()
+
+public:
+
+	WaitCondition()
+		: state(STATE_CLEAR)
 	{
-		pthread_mutex_lock(&waitMutex);
+	}
+
+	WaitCondition(const WaitCondition&) = delete;
+	WaitCondition& operator=(const WaitCondition&) = delete;
+
+
 
-		while (flag == false)
+	bool IsSignaled() const
+	{
+		return state.load(std::memory_order_acquire) == STATE_SIGNALED;
+	}
+
+	void Signal()
+	{
+		int previous = state.exchange(STATE_SIGNALED, std::memory_order_release);
+		if (previous == STATE_SLEEPING)
 		{
-			pthread_cond_wait(&waitCondition, &waitMutex);
+			FutexWake(&state);
 		}
+	}
 
-		flag = false;
+	// Consumes a pending signal without blocking
+	bool TryWait()
+	{
+		int expected = STATE_SIGNALED;
+		return state.compare_exchange_strong(expected, STATE_CLEAR, std::memory_order_acquire);
+	}
 
-		pthread_mutex_unlock(&waitMutex);
+	void WaitForSignal()
+	{
+		while (!PrepareWait())
+		{
+			// Returns immediately if a signal raced the state change
+			FutexWait(&state, STATE_SLEEPING, nullptr);
+		}
 	}
 
-	//bool WaitTimeout(double seconds)
-	//{
-	//	pthread_timestruc_t absoluteTime;
-	//	absoluteTime.tv_sec = time(NULL) + TIMEOUT;
-	//	absoluteTime.tv_nsec = 0;
+	// Returns false on timeout
+	bool WaitForSignal(double seconds)
+	{
+		double deadline = Now() + seconds;
 
-	//	pthread_mutex_lock(&waitMutex);
-	//	pthread_cond_timedwait(&waitCondition, &waitMutex, &abstime);
-	//	pthread_mutex_unlock(&waitMutex);
-	//}
+		while (!PrepareWait())
+		{
+			double remaining = deadline - Now();
+			if (remaining <= 0)
+				return false;
 
-	//TODO: WaitPredicate
+			timespec timeout;
+			timeout.tv_sec = (time_t)remaining;
+			timeout.tv_nsec = (long)((remaining - timeout.tv_sec) * 1000000000.0);
+
+			FutexWait(&state, STATE_SLEEPING, &timeout);
+		}
+
+		return true;
+	}
 };
@@ -37,6 +37,10 @@ extern "C"
 
 #include "InputDevice.h"
 #include "MediaPlayer.h"
+#include "Trace.h"
+#include "Metrics.h"
+#include "MediaClock.h"
+#include "AmlEmulator.h"
 
 #ifdef X11
 #include "X11Window.h"
@@ -201,6 +205,11 @@ void DisplayHelp()
 		printf("      --audio n\t\tIndex of audio stream to play\n");
 		printf("      --subtitle n\tIndex of subtitle stream to play\n");
 		printf("      --avdict 'opts'\tOptions to pass to libav\n");
+		printf("      --trace file\tWrite a Chrome trace (chrome://tracing) to file\n");
+		printf("      --metrics n\tPrint pipeline metrics to stderr every n seconds\n");
+		printf("      --virtual-time\tRun on a simulated clock as fast as possible (emulates the codec)\n");
+		printf("      --codec-emulator file\tEmulate the video decoder, logging its input to file\n");
+		printf("      --clock name\tMaster clock: auto, audio, video or system\n");
 }
 
 struct option longopts[] = {
@@ -211,6 +220,11 @@ struct option longopts[] = {
 	{ "audio",			required_argument,  NULL,          'a' },
 	{ "subtitle",		required_argument,  NULL,          's' },
 	{ "avdict",			required_argument,  NULL,          'A' },
+	{ "trace",			required_argument,  NULL,          'T' },
+	{ "metrics",		required_argument,  NULL,          'M' },
+	{ "virtual-time",	no_argument,        NULL,          'V' },
+	{ "codec-emulator",	required_argument,  NULL,          'E' },
+	{ "clock",			required_argument,  NULL,          'C' },
 	{ 0, 0, 0, 0 }
 };
 
@@ -236,6 +250,11 @@ int main(int argc, char** argv)
 	int optionAudioIndex = 0;
 	int optionSubtitleIndex = -1;	//disabled by default
 	std::string avOptions;
+	std::string optionTracePath;
+	double optionMetricsInterval = 0;
+	VirtualClockSPTR virtualClock;
+	AmlEmulatorDeviceSPTR codecEmulator;
+	MasterClockEnum optionMasterClock = MasterClockEnum::Auto;
 
 	while ((c = getopt_long(argc, argv, "t:c:", longopts, NULL)) != -1)
 	{
@@ -249,6 +268,59 @@ int main(int argc, char** argv)
 				avOptions = optarg;
 				break;
 
+			case 'T':
+#ifdef C2PLAY_TRACE
+				optionTracePath = optarg;
+				Trace::SetEnabled(true);
+#else
+				printf("Tracing is not available (build with premake4 --trace).\n");
+#endif
+				break;
+
+			case 'M':
+				optionMetricsInterval = atof(optarg);
+				printf("optionMetricsInterval=%f\n", optionMetricsInterval);
+				break;
+
+			case 'V':
+				// Must be selected before any element or Timer exists
+				virtualClock = std::make_shared<VirtualClock>();
+				MediaClock::SetDefault(virtualClock);
+				printf("Using a virtual clock.\n");
+				break;
+
+			case 'E':
+				// Must be selected before the video sink is created
+				codecEmulator = std::make_shared<AmlEmulatorDevice>(optarg);
+				AmlDevice::SetDefault(codecEmulator);
+				printf("Using the codec emulator (%s).\n", optarg);
+				break;
+
+			case 'C':
+				if (strcmp(optarg, "auto") == 0)
+				{
+					optionMasterClock = MasterClockEnum::Auto;
+				}
+				else if (strcmp(optarg, "audio") == 0)
+				{
+					optionMasterClock = MasterClockEnum::Audio;
+				}
+				else if (strcmp(optarg, "video") == 0)
+				{
+					optionMasterClock = MasterClockEnum::Video;
+				}
+				else if (strcmp(optarg, "system") == 0)
+				{
+					optionMasterClock = MasterClockEnum::System;
+				}
+				else
+				{
+					printf("Unknown clock '%s'.\n", optarg);
+					DisplayHelp();
+					exit(EXIT_FAILURE);
+				}
+				break;
+
 			case 't':
 			{
 				if (strchr(optarg, ':'))
@@ -305,6 +377,21 @@ int main(int argc, char** argv)
 	}
 
 
+	if (virtualClock)
+	{
+		// The video sink still drives a codec, so the sync code runs;
+		// the emulated decoder keeps time with the virtual clock.
+		if (!codecEmulator)
+		{
+			codecEmulator = std::make_shared<AmlEmulatorDevice>();
+			AmlDevice::SetDefault(codecEmulator);
+			printf("Using the codec emulator.\n");
+		}
+
+		codecEmulator->SetClock(virtualClock);
+	}
+
+
 	const char* url = nullptr;
 	if (optind < argc)
 	{
@@ -376,7 +463,8 @@ int main(int argc, char** argv)
 		compositor,
 		optionVideoIndex,
 		optionAudioIndex,
-		optionSubtitleIndex);
+		optionSubtitleIndex,
+		optionMasterClock);
 
 
 	if (optionChapter > -1)
@@ -390,6 +478,14 @@ int main(int argc, char** argv)
 
 
 	mediaPlayer->Seek(optionStartPosition);
+
+	if (optionMetricsInterval > 0)
+	{
+		MetricsRegistry::StartReporting(optionMetricsInterval);
+	}
+	RealTimeClock wallClock;
+	double playStart = wallClock.Now();
+
 	mediaPlayer->SetState(MediaState::Play);
 
 	
@@ -537,5 +633,38 @@ seek:
 
 	printf("MAIN: Playback finished.\n");
 
+	if (virtualClock)
+	{
+		printf("MAIN: Simulated %f seconds in %f seconds (%lu timer expirations).\n",
+			virtualClock->Now(),
+			wallClock.Now() - playStart,
+			virtualClock->TotalExpirations());
+	}
+
+	if (codecEmulator)
+	{
+		AmlEmulatorStats stats = codecEmulator->Stats();
+		printf("MAIN: Codec emulator - frames=%lu bytes=%llu writes=%lu blocked=%lu (%f s) full=%lu polls=%lu underruns=%lu\n",
+			stats.FramesDecoded,
+			stats.BytesWritten,
+			stats.Writes,
+			stats.BlockedWrites,
+			stats.BlockedSeconds,
+			stats.FullWrites,
+			stats.Polls,
+			stats.Underruns);
+	}
+
+	if (optionMetricsInterval > 0)
+	{
+		MetricsRegistry::StopReporting();
+		MetricsRegistry::Print(stderr, MetricsRegistry::Snapshot());
+	}
+
+	if (!optionTracePath.empty())
+	{
+		Trace::WriteChromeJson(optionTracePath.c_str());
+	}
+
 	return 0;
 }
@@ -0,0 +1,189 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+
+#include "Bitstream.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+
+// Fuzz target for the parsers that see untrusted packets.  Built with
+// clang -fsanitize=fuzzer it is a libFuzzer binary; with
+// BITSTREAM_FUZZER_MAIN it runs each file named on the command line
+// (or stdin) once, which is what AFL and crash reproduction need.
+//
+// The first byte picks the length prefix size and the video format,
+// the rest is the packet.  It is also parsed as avcC and hvcC.
+
+
+static const VideoFormatEnum formats[] =
+{
+	VideoFormatEnum::Avc,
+	VideoFormatEnum::Hevc,
+	VideoFormatEnum::Mpeg2,
+	VideoFormatEnum::VC1
+};
+
+
+static void Verify(bool condition)
+{
+	if (!condition)
+	{
+		abort();
+	}
+}
+
+static void ParseUnit(VideoFormatEnum format, const unsigned char* data, int length)
+{
+	SequenceInfo info;
+	if (Bitstream::ParseSequenceHeader(format, data, length, &info))
+	{
+		Verify(info.Width > 0 && info.Width <= 65536);
+		Verify(info.Height > 0 && info.Height <= 65536);
+		Verify(info.FrameRate >= 0);
+	}
+}
+
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* input, size_t size)
+{
+	if (size < 2 || size > 1024 * 1024)
+		return 0;
+
+	int prefixLength = (input[0] & 3) + 1;
+	VideoFormatEnum format = formats[(input[0] >> 2) & 3];
+
+	// A copy of exactly the packet, so reads past it are caught
+	std::vector<unsigned char> packet(input + 1, input + size);
+	int length = (int)packet.size();
+
+
+	std::vector<NalUnit> units;
+	bool isValid = Bitstream::SplitLengthPrefixed(packet.data(), length, prefixLength, &units);
+
+	if (isValid)
+	{
+		const unsigned char* expected = packet.data();
+		for (auto& unit : units)
+		{
+			Verify(unit.Data == expected + prefixLength);
+			Verify(unit.Length >= 0 && unit.Data + unit.Length <= packet.data() + length);
+			expected = unit.Data + unit.Length;
+
+			ParseUnit(format, unit.Data, unit.Length);
+		}
+
+		Verify(expected == packet.data() + length);
+	}
+	else
+	{
+		Verify(units.empty());
+	}
+
+
+	if (prefixLength >= 3)
+	{
+		std::vector<unsigned char> converted(packet);
+		bool isConverted = Bitstream::LengthPrefixedToAnnexB(converted.data(), length, prefixLength, nullptr);
+
+		Verify(isConverted == isValid);
+		if (!isConverted)
+		{
+			Verify(converted == packet);
+		}
+	}
+
+
+	// The packet as avcC and hvcC extra data
+	for (int i = 0; i < 2; ++i)
+	{
+		VideoFormatEnum configFormat = formats[i];
+
+		int configPrefixLength = 0;
+		std::vector<NalUnit> configUnits;
+		if (Bitstream::ParseDecoderConfiguration(configFormat, packet.data(), length, &configPrefixLength, &configUnits))
+		{
+			Verify(configPrefixLength >= 1 && configPrefixLength <= 4);
+
+			for (auto& unit : configUnits)
+			{
+				Verify(unit.Data >= packet.data() && unit.Length >= 0 &&
+					unit.Data + unit.Length <= packet.data() + length);
+
+				ParseUnit(configFormat, unit.Data, unit.Length);
+			}
+		}
+		else
+		{
+			Verify(configPrefixLength == 0 && configUnits.empty());
+		}
+	}
+
+
+	// The whole packet as a single unit, for every format
+	for (auto parseFormat : formats)
+	{
+		ParseUnit(parseFormat, packet.data(), length);
+	}
+
+	return 0;
+}
+
+
+#if defined(BITSTREAM_FUZZER_MAIN)
+
+static void RunFile(FILE* file)
+{
+	std::vector<unsigned char> data;
+
+	unsigned char chunk[4096];
+	size_t count;
+	while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0)
+	{
+		data.insert(data.end(), chunk, chunk + count);
+	}
+
+	LLVMFuzzerTestOneInput(data.data(), data.size());
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		RunFile(stdin);
+		return 0;
+	}
+
+	for (int i = 1; i < argc; ++i)
+	{
+		FILE* file = fopen(argv[i], "rb");
+		if (file == nullptr)
+		{
+			printf("Can not open %s\n", argv[i]);
+			return 1;
+		}
+
+		RunFile(file);
+		fclose(file);
+	}
+
+	return 0;
+}
+
+#endif
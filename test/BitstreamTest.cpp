@@ -0,0 +1,613 @@
+/*
+*
+* Copyright (C) 2016 OtherCrashOverride@users.noreply.github.com.
+* All rights reserved.
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 2, as
+* published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+* more details.
+*
+*/
+
+
+#include "Bitstream.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+
+static int checks = 0;
+static int failures = 0;
+
+
+static void Check(bool condition, const char* what)
+{
+	++checks;
+
+	if (!condition)
+	{
+		++failures;
+		printf("FAIL: %s\n", what);
+	}
+}
+
+
+// MSB first, the way the parsers read
+class BitWriter
+{
+	std::vector<unsigned char> data;
+	int bitCount = 0;
+
+
+public:
+
+	void WriteBits(unsigned int value, int count)
+	{
+		for (int i = count - 1; i >= 0; --i)
+		{
+			if (bitCount % 8 == 0)
+			{
+				data.push_back(0);
+			}
+
+			if ((value >> i) & 1)
+			{
+				data.back() |= 0x80 >> (bitCount % 8);
+			}
+
+			++bitCount;
+		}
+	}
+
+	void WriteUE(unsigned int value)
+	{
+		uint64_t coded = (uint64_t)value + 1;
+
+		int length = 0;
+		while ((coded >> (length + 1)) != 0)
+		{
+			++length;
+		}
+
+		WriteBits(0, length);
+		WriteBits(1, 1);
+		WriteBits((unsigned int)(coded & ((1ULL << length) - 1)), length);
+	}
+
+	// rbsp_trailing_bits.  Ones are written as padding so no emulation
+	// prevention is needed.
+	std::vector<unsigned char> Finish()
+	{
+		WriteBits(1, 1);
+		while (bitCount % 8 != 0)
+		{
+			WriteBits(0, 1);
+		}
+
+		WriteBits(0xff, 8);
+
+		return data;
+	}
+};
+
+
+
+// Every offset into every position of a lone start code, across the
+// edges of the 16 byte blocks the vector scan works in.
+static void TestFindStartCodeBlockEdges()
+{
+	const int size = 64;
+
+	bool isMatch = true;
+	for (int position = 0; position + 3 <= size; ++position)
+	{
+		for (int length = position; length <= size; ++length)
+		{
+			std::vector<unsigned char> data(size, 0xff);
+			data[position] = 0;
+			data[position + 1] = 0;
+			data[position + 2] = 1;
+
+			for (int offset = 0; offset <= length; ++offset)
+			{
+				if (Bitstream::FindStartCode(data.data(), length, offset) !=
+					Bitstream::FindStartCodeScalar(data.data(), length, offset))
+				{
+					isMatch = false;
+				}
+			}
+		}
+	}
+
+	Check(isMatch, "FindStartCode matches FindStartCodeScalar at every block edge");
+
+
+	// Runs of zeros that straddle a block and only complete a start
+	// code in the two bytes read past it
+	isMatch = true;
+	for (int position = 0; position + 3 <= size; ++position)
+	{
+		for (int zeros = 1; zeros <= 5 && position + zeros < size; ++zeros)
+		{
+			std::vector<unsigned char> data(size, 0x80);
+			memset(data.data() + position, 0, zeros);
+			data[position + zeros] = 1;
+
+			for (int offset = 0; offset <= position; ++offset)
+			{
+				if (Bitstream::FindStartCode(data.data(), size, offset) !=
+					Bitstream::FindStartCodeScalar(data.data(), size, offset))
+				{
+					isMatch = false;
+				}
+			}
+		}
+	}
+
+	Check(isMatch, "FindStartCode matches FindStartCodeScalar for zero runs");
+}
+
+// Random data dense in zeros and ones finds every candidate the same
+// way from every offset.
+static void TestFindStartCodeRandom()
+{
+	srand(1);
+
+	bool isMatch = true;
+	for (int pass = 0; pass < 200; ++pass)
+	{
+		std::vector<unsigned char> data(1 + rand() % 300);
+		for (auto& value : data)
+		{
+			value = rand() % 3;
+		}
+
+		for (int offset = 0; offset <= (int)data.size(); ++offset)
+		{
+			if (Bitstream::FindStartCode(data.data(), data.size(), offset) !=
+				Bitstream::FindStartCodeScalar(data.data(), data.size(), offset))
+			{
+				isMatch = false;
+			}
+		}
+	}
+
+	Check(isMatch, "FindStartCode matches FindStartCodeScalar on random data");
+}
+
+
+static void TestSplitLengthPrefixed()
+{
+	const unsigned char valid[] = { 0, 0, 0, 2, 0x65, 0xaa, 0, 0, 0, 1, 0x41 };
+
+	std::vector<NalUnit> units;
+	Check(Bitstream::SplitLengthPrefixed(valid, sizeof(valid), 4, &units) &&
+		units.size() == 2 &&
+		units[0].Data == valid + 4 && units[0].Length == 2 &&
+		units[1].Data == valid + 10 && units[1].Length == 1,
+		"SplitLengthPrefixed splits a valid packet");
+
+	units.clear();
+	Check(Bitstream::SplitLengthPrefixed(valid, 0, 4, &units) && units.empty(),
+		"SplitLengthPrefixed accepts an empty packet");
+
+
+	// Anything already in the output survives a failed split
+	NalUnit existing;
+	existing.Data = valid;
+	existing.Length = 1;
+
+	for (int length = 1; length < (int)sizeof(valid); ++length)
+	{
+		if (length == 6)
+			continue;	// ends between the units
+
+		units.clear();
+		units.push_back(existing);
+
+		bool isSplit = Bitstream::SplitLengthPrefixed(valid, length, 4, &units);
+
+		char what[80];
+		snprintf(what, sizeof(what), "SplitLengthPrefixed rejects a packet truncated to %d bytes", length);
+		Check(!isSplit && units.size() == 1 && units[0].Data == valid, what);
+	}
+
+	const unsigned char oversized[] = { 0xff, 0xff, 0xff, 0xff, 0x65, 0xaa };
+	units.clear();
+	Check(!Bitstream::SplitLengthPrefixed(oversized, sizeof(oversized), 4, &units) && units.empty(),
+		"SplitLengthPrefixed rejects a length past the end");
+
+	const unsigned char overrun[] = { 0, 0, 0, 1, 0x65, 0x7f, 0xff, 0xff, 0xff, 0x41 };
+	units.clear();
+	Check(!Bitstream::SplitLengthPrefixed(overrun, sizeof(overrun), 4, &units) && units.empty(),
+		"SplitLengthPrefixed rejects a second length past the end");
+
+	const unsigned char shortPrefix[] = { 0, 2, 0x65, 0xaa, 0, 3, 0x41 };
+	units.clear();
+	Check(!Bitstream::SplitLengthPrefixed(shortPrefix, sizeof(shortPrefix), 2, &units) && units.empty(),
+		"SplitLengthPrefixed rejects a two byte length past the end");
+
+	const unsigned char onePrefix[] = { 2, 0x65, 0xaa, 1, 0x41 };
+	units.clear();
+	Check(Bitstream::SplitLengthPrefixed(onePrefix, sizeof(onePrefix), 1, &units) && units.size() == 2,
+		"SplitLengthPrefixed splits one byte lengths");
+}
+
+static void TestLengthPrefixedToAnnexB()
+{
+	unsigned char data[] = { 0, 0, 0, 2, 0x65, 0xaa, 0, 0, 0, 1, 0x41 };
+	const unsigned char annexB[] = { 0, 0, 0, 1, 0x65, 0xaa, 0, 0, 0, 1, 0x41 };
+
+	std::vector<NalUnit> units;
+	Check(Bitstream::LengthPrefixedToAnnexB(data, sizeof(data), 4, &units) &&
+		memcmp(data, annexB, sizeof(data)) == 0 &&
+		units.size() == 2,
+		"LengthPrefixedToAnnexB converts in place");
+
+	unsigned char three[] = { 0, 0, 2, 0x65, 0xaa, 0, 0, 1, 0x41 };
+	const unsigned char threeAnnexB[] = { 0, 0, 1, 0x65, 0xaa, 0, 0, 1, 0x41 };
+	Check(Bitstream::LengthPrefixedToAnnexB(three, sizeof(three), 3, nullptr) &&
+		memcmp(three, threeAnnexB, sizeof(three)) == 0,
+		"LengthPrefixedToAnnexB converts three byte lengths");
+
+
+	// A rejected packet is left exactly as it was
+	unsigned char truncated[] = { 0, 0, 0, 2, 0x65, 0xaa, 0, 0, 0, 9, 0x41 };
+	const unsigned char original[] = { 0, 0, 0, 2, 0x65, 0xaa, 0, 0, 0, 9, 0x41 };
+	units.clear();
+	Check(!Bitstream::LengthPrefixedToAnnexB(truncated, sizeof(truncated), 4, &units) &&
+		memcmp(truncated, original, sizeof(truncated)) == 0 &&
+		units.empty(),
+		"LengthPrefixedToAnnexB leaves an oversized packet untouched");
+
+	unsigned char partial[] = { 0, 0, 0, 2, 0x65, 0xaa, 0, 0 };
+	const unsigned char partialOriginal[] = { 0, 0, 0, 2, 0x65, 0xaa, 0, 0 };
+	Check(!Bitstream::LengthPrefixedToAnnexB(partial, sizeof(partial), 4, nullptr) &&
+		memcmp(partial, partialOriginal, sizeof(partial)) == 0,
+		"LengthPrefixedToAnnexB leaves a truncated prefix untouched");
+}
+
+
+static void TestParseDecoderConfiguration()
+{
+	// Two SPS and two PPS, four byte lengths
+	const unsigned char avcC[] =
+	{
+		1, 0x64, 0, 0x28, 0xff, 0xe2,
+		0, 2, 0x67, 0x64,
+		0, 3, 0x67, 0x64, 0x01,
+		2,
+		0, 1, 0x68,
+		0, 2, 0x68, 0xee,
+		0xfd, 0xf8, 0xf8, 0	// high profile fields
+	};
+
+	int prefixLength = 0;
+	std::vector<NalUnit> units;
+	Check(Bitstream::ParseDecoderConfiguration(VideoFormatEnum::Avc, avcC, sizeof(avcC), &prefixLength, &units) &&
+		prefixLength == 4 &&
+		units.size() == 4 &&
+		units[0].Data == avcC + 8 && units[0].Length == 2 &&
+		units[1].Data == avcC + 12 && units[1].Length == 3 &&
+		units[2].Data == avcC + 18 && units[2].Length == 1 &&
+		units[3].Data == avcC + 21 && units[3].Length == 2,
+		"ParseDecoderConfiguration reads every avcC parameter set");
+
+	// Every truncation ends inside a length or unit or before the
+	// PPS count.  Anything already in the output survives.
+	NalUnit existing;
+	existing.Data = avcC;
+	existing.Length = 1;
+
+	for (int length = 0; length < 23; ++length)
+	{
+		prefixLength = 0;
+		units.clear();
+		units.push_back(existing);
+
+		bool isParsed = Bitstream::ParseDecoderConfiguration(VideoFormatEnum::Avc, avcC, length, &prefixLength, &units);
+
+		char what[80];
+		snprintf(what, sizeof(what), "ParseDecoderConfiguration rejects avcC truncated to %d bytes", length);
+		Check(!isParsed && prefixLength == 0 && units.size() == 1, what);
+	}
+
+	const unsigned char avcCOversized[] = { 1, 0x64, 0, 0x28, 0xff, 0xe1, 0xff, 0xff, 0x67, 0, 0 };
+	units.clear();
+	Check(!Bitstream::ParseDecoderConfiguration(VideoFormatEnum::Avc, avcCOversized, sizeof(avcCOversized), &prefixLength, &units) &&
+		units.empty(),
+		"ParseDecoderConfiguration rejects an avcC SPS length past the end");
+
+	const unsigned char avcCVersion[] = { 0, 0x64, 0, 0x28, 0xff, 0xe0, 0 };
+	Check(!Bitstream::ParseDecoderConfiguration(VideoFormatEnum::Avc, avcCVersion, sizeof(avcCVersion), &prefixLength, &units),
+		"ParseDecoderConfiguration rejects an avcC version other than 1");
+
+	const unsigned char avcCEmpty[] = { 1, 0x64, 0, 0x28, 0xfd, 0xe0, 0 };
+	Check(Bitstream::ParseDecoderConfiguration(VideoFormatEnum::Avc, avcCEmpty, sizeof(avcCEmpty), &prefixLength, &units) &&
+		prefixLength == 2 && units.empty(),
+		"ParseDecoderConfiguration accepts avcC without parameter sets");
+
+
+	// VPS, SPS and two PPS in three arrays
+	unsigned char hvcC[23 + 5 + 3 + 6 + 5 + 3] = { 1 };
+	hvcC[21] = 0xf3;
+	hvcC[22] = 3;
+
+	const unsigned char arrays[] =
+	{
+		0x20, 0, 1, 0, 0,
+		0x21, 0, 1, 0, 1, 0x42,
+		0x22, 0, 2, 0, 1, 0x44, 0, 2, 0x44, 0x01
+	};
+	memcpy(hvcC + 23, arrays, sizeof(arrays));
+	int hvcCLength = 23 + (int)sizeof(arrays);
+
+	units.clear();
+	Check(Bitstream::ParseDecoderConfiguration(VideoFormatEnum::Hevc, hvcC, hvcCLength, &prefixLength, &units) &&
+		prefixLength == 4 &&
+		units.size() == 4 &&
+		units[0].Length == 0 &&
+		units[1].Data == hvcC + 33 && units[1].Length == 1 &&
+		units[2].Data == hvcC + 39 && units[2].Length == 1 &&
+		units[3].Data == hvcC + 42 && units[3].Length == 2,
+		"ParseDecoderConfiguration reads every hvcC array");
+
+	for (int length = 0; length < hvcCLength; ++length)
+	{
+		prefixLength = 0;
+		units.clear();
+
+		bool isParsed = Bitstream::ParseDecoderConfiguration(VideoFormatEnum::Hevc, hvcC, length, &prefixLength, &units);
+
+		char what[80];
+		snprintf(what, sizeof(what), "ParseDecoderConfiguration rejects hvcC truncated to %d bytes", length);
+		Check(!isParsed && prefixLength == 0 && units.empty(), what);
+	}
+
+	hvcC[22] = 4;
+	Check(!Bitstream::ParseDecoderConfiguration(VideoFormatEnum::Hevc, hvcC, hvcCLength, &prefixLength, &units),
+		"ParseDecoderConfiguration rejects an hvcC array count past the end");
+}
+
+
+static void CheckSequence(const char* name, VideoFormatEnum format, const unsigned char* data, int length,
+	int width, int height, double frameRate, int profile, int level)
+{
+	SequenceInfo info;
+	bool isParsed = Bitstream::ParseSequenceHeader(format, data, length, &info);
+
+	char what[120];
+	snprintf(what, sizeof(what), "ParseSequenceHeader reads %s", name);
+
+	Check(isParsed &&
+		info.Width == width &&
+		info.Height == height &&
+		fabs(info.FrameRate - frameRate) < 0.001 &&
+		info.Profile == profile &&
+		info.Level == level,
+		what);
+
+	if (isParsed)
+	{
+		printf("  %s: %dx%d %.3f fps profile %d level %d\n",
+			name, info.Width, info.Height, info.FrameRate, info.Profile, info.Level);
+	}
+}
+
+// Headers taken from streams written by x264, x265 and ffmpeg's
+// MPEG-2 encoder, and an advanced profile VC-1 header checked
+// against ffmpeg's decoder.
+static void TestParseSequenceHeader()
+{
+	// High profile 1920x1088 cropped to 1080, VUI timing for 30 fps
+	static const unsigned char h264Cropped[] =
+	{
+		0x67, 0x64, 0x00, 0x28, 0xac, 0xd9, 0x40, 0x78, 0x02, 0x27, 0xe5, 0xc0, 0x44, 0x00,
+		0x00, 0x03, 0x00, 0x04, 0x00, 0x00, 0x03, 0x00, 0xf0, 0x3c, 0x60, 0xc6, 0x58
+	};
+	CheckSequence("H.264 1080p", VideoFormatEnum::Avc, h264Cropped, sizeof(h264Cropped),
+		1920, 1080, 30, 100, 40);
+
+	// High profile 1280x720 at 50 fps
+	static const unsigned char h264[] =
+	{
+		0x67, 0x64, 0x00, 0x20, 0xac, 0xd9, 0x40, 0x50, 0x05, 0xba, 0x10, 0x00,
+		0x00, 0x03, 0x00, 0x10, 0x00, 0x00, 0x06, 0x40, 0xf1, 0x83, 0x19, 0x60
+	};
+	CheckSequence("H.264 720p", VideoFormatEnum::Avc, h264, sizeof(h264),
+		1280, 720, 50, 100, 32);
+
+	// Main profile 1920x1088 with a conformance window down to 1080
+	static const unsigned char hevc[] =
+	{
+		0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03, 0x00,
+		0x00, 0x03, 0x00, 0x78, 0xa0, 0x03, 0xc0, 0x80, 0x10, 0xe5, 0x96, 0x56, 0x69, 0x24,
+		0xca, 0xe6, 0x80, 0x80, 0x00, 0x01, 0xf4, 0x80, 0x00, 0x3a, 0x98, 0x04
+	};
+	CheckSequence("HEVC 1080p", VideoFormatEnum::Hevc, hevc, sizeof(hevc),
+		1920, 1080, 0, 1, 120);
+
+	// 720x576 at 25 fps
+	static const unsigned char mpeg2[] =
+	{
+		0xb3, 0x2d, 0x02, 0x40, 0x13, 0xff, 0xff, 0xe0, 0x18
+	};
+	CheckSequence("MPEG-2 576i", VideoFormatEnum::Mpeg2, mpeg2, sizeof(mpeg2),
+		720, 576, 25, 0, 0);
+
+	// Advanced profile level 3, 1920x1080 at 24000/1001 fps
+	static const unsigned char vc1[] =
+	{
+		0x0f, 0xdb, 0xfe, 0x3b, 0xf2, 0x1b, 0x02, 0x3b, 0xf8, 0x86, 0xe8, 0x04, 0x88
+	};
+	CheckSequence("VC-1 1080p", VideoFormatEnum::VC1, vc1, sizeof(vc1),
+		1920, 1080, 24000.0 / 1001.0, 3, 3);
+
+
+	SequenceInfo info;
+	for (int length = 0; length < (int)sizeof(h264Cropped) - 4; ++length)
+	{
+		if (Bitstream::ParseSequenceHeader(VideoFormatEnum::Avc, h264Cropped, length, &info))
+		{
+			char what[80];
+			snprintf(what, sizeof(what), "ParseSequenceHeader rejects an SPS truncated to %d bytes", length);
+			Check(false, what);
+		}
+	}
+}
+
+
+// Baseline SPS carrying the given size fields
+static std::vector<unsigned char> BuildH264Sps(unsigned int widthInMbsMinus1, unsigned int heightInMapUnitsMinus1,
+	bool isFrameMbsOnly, bool isCropped, unsigned int cropLeft, unsigned int cropBottom)
+{
+	BitWriter writer;
+	writer.WriteBits(0x67, 8);
+	writer.WriteBits(66, 8);	// profile_idc
+	writer.WriteBits(0, 8);
+	writer.WriteBits(30, 8);	// level_idc
+	writer.WriteUE(0);			// seq_parameter_set_id
+	writer.WriteUE(0);			// log2_max_frame_num_minus4
+	writer.WriteUE(2);			// pic_order_cnt_type
+	writer.WriteUE(1);			// max_num_ref_frames
+	writer.WriteBits(0, 1);
+	writer.WriteUE(widthInMbsMinus1);
+	writer.WriteUE(heightInMapUnitsMinus1);
+	writer.WriteBits(isFrameMbsOnly, 1);
+
+	if (!isFrameMbsOnly)
+	{
+		writer.WriteBits(0, 1);	// mb_adaptive_frame_field_flag
+	}
+
+	writer.WriteBits(1, 1);		// direct_8x8_inference_flag
+	writer.WriteBits(isCropped, 1);
+
+	if (isCropped)
+	{
+		writer.WriteUE(cropLeft);
+		writer.WriteUE(0);
+		writer.WriteUE(0);
+		writer.WriteUE(cropBottom);
+	}
+
+	writer.WriteBits(0, 1);		// vui_parameters_present_flag
+
+	return writer.Finish();
+}
+
+// Main profile SPS carrying the given size fields
+static std::vector<unsigned char> BuildHevcSps(unsigned int width, unsigned int height,
+	bool isCropped, unsigned int cropRight, unsigned int cropBottom)
+{
+	BitWriter writer;
+	writer.WriteBits(0x4201, 16);
+	writer.WriteBits(0, 4);		// sps_video_parameter_set_id
+	writer.WriteBits(0, 3);		// sps_max_sub_layers_minus1
+	writer.WriteBits(1, 1);
+	writer.WriteBits(1, 8);		// general_profile_idc
+	writer.WriteBits(0x60000000, 32);
+	writer.WriteBits(0xffffff, 24);	// flags, kept free of 00 00 0x
+	writer.WriteBits(0xffffff, 24);
+	writer.WriteBits(93, 8);	// general_level_idc
+	writer.WriteUE(0);			// sps_seq_parameter_set_id
+	writer.WriteUE(1);			// chroma_format_idc
+	writer.WriteUE(width);
+	writer.WriteUE(height);
+	writer.WriteBits(isCropped, 1);
+
+	if (isCropped)
+	{
+		writer.WriteUE(0);
+		writer.WriteUE(cropRight);
+		writer.WriteUE(0);
+		writer.WriteUE(cropBottom);
+	}
+
+	return writer.Finish();
+}
+
+// Size fields near 2^32 used to overflow the multiplications
+static void TestParseSequenceHeaderLimits()
+{
+	SequenceInfo info;
+	std::vector<unsigned char> sps;
+
+	sps = BuildH264Sps(79, 44, true, false, 0, 0);
+	Check(Bitstream::ParseSequenceHeader(VideoFormatEnum::Avc, sps.data(), sps.size(), &info) &&
+		info.Width == 1280 && info.Height == 720,
+		"ParseSequenceHeader reads a built H.264 SPS");
+
+	sps = BuildH264Sps(0xfffffffe, 44, true, false, 0, 0);
+	Check(!Bitstream::ParseSequenceHeader(VideoFormatEnum::Avc, sps.data(), sps.size(), &info),
+		"ParseSequenceHeader rejects a huge H.264 width");
+
+	sps = BuildH264Sps(0x7fffffff, 0x7fffffff, true, false, 0, 0);
+	Check(!Bitstream::ParseSequenceHeader(VideoFormatEnum::Avc, sps.data(), sps.size(), &info),
+		"ParseSequenceHeader rejects a huge H.264 height");
+
+	// Field coding doubles the height, which must not wrap either
+	sps = BuildH264Sps(79, 0x7fffffff, false, false, 0, 0);
+	Check(!Bitstream::ParseSequenceHeader(VideoFormatEnum::Avc, sps.data(), sps.size(), &info),
+		"ParseSequenceHeader rejects a huge H.264 field height");
+
+	sps = BuildH264Sps(119, 33, false, true, 0, 2);
+	Check(Bitstream::ParseSequenceHeader(VideoFormatEnum::Avc, sps.data(), sps.size(), &info) &&
+		info.Width == 1920 && info.Height == 1080,
+		"ParseSequenceHeader reads a built field coded H.264 SPS");
+
+	sps = BuildH264Sps(79, 44, true, true, 0xfffffffe, 0);
+	Check(!Bitstream::ParseSequenceHeader(VideoFormatEnum::Avc, sps.data(), sps.size(), &info),
+		"ParseSequenceHeader rejects a huge H.264 crop");
+
+	sps = BuildH264Sps(79, 44, true, true, 0, 0x80000000);
+	Check(!Bitstream::ParseSequenceHeader(VideoFormatEnum::Avc, sps.data(), sps.size(), &info),
+		"ParseSequenceHeader rejects a negative H.264 crop");
+
+	sps = BuildH264Sps(79, 44, true, true, 640, 0);
+	Check(!Bitstream::ParseSequenceHeader(VideoFormatEnum::Avc, sps.data(), sps.size(), &info),
+		"ParseSequenceHeader rejects an H.264 crop of the whole frame");
+
+
+	sps = BuildHevcSps(1920, 1088, true, 0, 4);
+	Check(Bitstream::ParseSequenceHeader(VideoFormatEnum::Hevc, sps.data(), sps.size(), &info) &&
+		info.Width == 1920 && info.Height == 1080,
+		"ParseSequenceHeader reads a built HEVC SPS");
+
+	sps = BuildHevcSps(0xfffffffe, 1088, false, 0, 0);
+	Check(!Bitstream::ParseSequenceHeader(VideoFormatEnum::Hevc, sps.data(), sps.size(), &info),
+		"ParseSequenceHeader rejects a huge HEVC width");
+
+	sps = BuildHevcSps(1920, 0x80000000, false, 0, 0);
+	Check(!Bitstream::ParseSequenceHeader(VideoFormatEnum::Hevc, sps.data(), sps.size(), &info),
+		"ParseSequenceHeader rejects a negative HEVC height");
+
+	sps = BuildHevcSps(1920, 1088, true, 0x7fffffff, 0x7fffffff);
+	Check(!Bitstream::ParseSequenceHeader(VideoFormatEnum::Hevc, sps.data(), sps.size(), &info),
+		"ParseSequenceHeader rejects a huge HEVC conformance window");
+}
+
+
+
+int main(int argc, char** argv)
+{
+	TestFindStartCodeBlockEdges();
+	TestFindStartCodeRandom();
+	TestSplitLengthPrefixed();
+	TestLengthPrefixedToAnnexB();
+	TestParseDecoderConfiguration();
+	TestParseSequenceHeader();
+	TestParseSequenceHeaderLimits();
+
+	printf("%d checks, %d failed\n", checks, failures);
+
+	return (failures == 0) ? 0 : 1;
+}